@@ -152,6 +152,8 @@ function execute_target {
     # using the ``S2E_SYM_ARGS`` environment variable as required
     #S2E_SYM_ARGS="" LD_PRELOAD="${S2E_SO}" "${TARGET}" "$@" > /dev/null 2> /dev/null
 
+    # To symbolize the pages of ./poc lazily as the target reads them:
+    # ./sym_file --lazy ./poc ./target ./poc
     ./sym_file -- ./target < ./poc #>/dev/null 2>&1
 }
 
@@ -205,6 +207,7 @@ target_init
 
 # Download the target file to analyze
 ${S2EGET} "sym_file"
+${S2EGET} "sym_file_lazy.so" > /dev/null
 ${S2EGET} "target"
 ${S2EGET} "poc"
 
@@ -21,7 +21,9 @@
 #include <s2e/s2e.h>
 
 #include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,24 +33,107 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#define POC_NAME_MAX_SIZE 64
+#define SYM_FILE_LAZY_SO "./sym_file_lazy.so"
+
+// Keep these in sync with src/CRAX.h
+enum S2E_CRAX_COMMANDS {
+    CRAX_BATCH_FORK,
+    CRAX_BATCH_BEGIN,
+    CRAX_SYM_WINDOW,
+};
+
+struct S2E_CRAX_COMMAND {
+    enum S2E_CRAX_COMMANDS Command;
+    union {
+        struct {
+            char PocName[POC_NAME_MAX_SIZE];
+        } BatchBegin;
+
+        struct {
+            uint64_t Buffer;
+            uint64_t Size;
+            uint64_t Begin;
+            uint64_t Result;
+        } SymWindow;
+    };
+};
+
+const char *sym_ranges = NULL;
+
 void usage(const char *prog_name) {
     printf("Usage: %s sym_file [options...] binary [binary_args...]\n", prog_name);
     printf("\n");
+    printf("Options:\n");
+    printf("  --sym-ranges <f> Only symbolize the input bytes spanned by the ranges in <f>,\n");
+    printf("                   which is written by CRAX's InputTaint module.\n");
+    printf("  --lazy <file>    Run the target with %s preloaded, which\n", SYM_FILE_LAZY_SO);
+    printf("                   symbolizes each page of <file> when it's first read.\n");
+    printf("\n");
     printf("Copyright (C) 2021-2022 Software Quality Laboratory, NYCU.\n");
     printf("This is free software, see the source for copying conditions. There is no\n");
     printf("warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE\n");
 }
 
-int main(int argc, char *argv[], char *envp[]) {
-    int fd;
-    void *p;
+// Reads the "begin end" ranges in `path`, and stores the smallest
+// [begin, end) spanning all of them within [0, n) in `*begin` and `*end`.
+bool read_sym_ranges(const char *path, long n, long *begin, long *end) {
+    FILE *f = fopen(path, "r");
+    long b, e;
 
-    if (argc < 2) {
-        usage(argv[0]);
-        return EXIT_FAILURE;
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    *begin = n;
+    *end = 0;
+    while (fscanf(f, "%li %li", &b, &e) == 2) {
+        if (b < *begin) *begin = b;
+        if (e > *end) *end = e;
     }
+    fclose(f);
+
+    if (*begin < 0) *begin = 0;
+    if (*end > n) *end = n;
+    return *begin < *end;
+}
 
-    fd = open(argv[optind], O_RDWR);
+// Marks `n` bytes of `p` as symbolic, or only the part of it
+// spanned by the ranges in `ranges_path` if it's given.
+//
+// The symbolic bytes are kept in a single array, so CRAX is told where
+// they are, and fills in the rest of the input when it writes exploits.
+void make_input_symbolic(char *p, long n, const char *ranges_path, const char *name) {
+    long begin = 0;
+    long end = n;
+
+    if (ranges_path && read_sym_ranges(ranges_path, n, &begin, &end)) {
+        struct S2E_CRAX_COMMAND cmd = { .Command = CRAX_SYM_WINDOW };
+        cmd.SymWindow.Buffer = (uintptr_t) p;
+        cmd.SymWindow.Size = n;
+        cmd.SymWindow.Begin = begin;
+        s2e_invoke_plugin("CRAX", &cmd, sizeof(cmd));
+
+        if (!cmd.SymWindow.Result) {
+            fprintf(stderr, "CRAX rejected the symbolic window, symbolizing the whole input\n");
+            begin = 0;
+            end = n;
+        }
+    } else {
+        begin = 0;
+        end = n;
+    }
+
+    s2e_make_symbolic(p + begin, end - begin, name);
+}
+
+// Marks the whole file at `path` as symbolic.
+int symbolize_file(const char *path) {
+    int fd;
+    void *p;
+
+    fd = open(path, O_RDWR);
 
     if (fd < 0) {
         perror("open file error\n");
@@ -70,7 +155,42 @@ int main(int argc, char *argv[], char *envp[]) {
         return EXIT_FAILURE;
     }
     
-    s2e_make_symbolic(p, b.st_size, "CRAX");
+    make_input_symbolic(p, b.st_size, sym_ranges, "CRAX");
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[], char *envp[]) {
+    const char *prog_name = argv[0];
+    const char *lazy_file = NULL;
+    char *env[3] = { NULL };
+    char env_sym_file[PATH_MAX + 16];
+
+    while (argc >= 3) {
+        if (!strcmp(argv[1], "--sym-ranges")) {
+            sym_ranges = argv[2];
+        } else if (!strcmp(argv[1], "--lazy")) {
+            lazy_file = argv[2];
+        } else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 2) {
+        usage(prog_name);
+        return EXIT_FAILURE;
+    }
+
+    if (lazy_file) {
+        // The pages of the file are symbolized by the preloaded
+        // library as the target reads them.
+        snprintf(env_sym_file, sizeof(env_sym_file), "CRAX_SYM_FILE=%s", lazy_file);
+        env[0] = "LD_PRELOAD=" SYM_FILE_LAZY_SO;
+        env[1] = env_sym_file;
+    } else if (symbolize_file(argv[optind]) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
 
     // Prepare the argv for execve().
     char *args[argc - 1];
@@ -87,7 +207,7 @@ int main(int argc, char *argv[], char *envp[]) {
             perror("failed to fork child process");
             return EXIT_FAILURE;
         case 0:  // child
-            execve(args[0], args, NULL);
+            execve(args[0], args, env);
             break;
         default:  // parent
             wait(NULL);
@@ -0,0 +1,316 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+// Preloaded into the target by `sym_file --lazy`. Instead of symbolizing
+// the whole input file up front, each page of the file is symbolized the
+// first time the target reads it via read(), pread(), stdio or mmap().
+//
+// The pages are symbolized in a private copy of the file (the "shadow"),
+// and the target gets a copy of the shadow, so a page keeps being symbolic
+// no matter how many times it's read. Each page is an array of its own
+// named "CRAX_file_0x<offset>", so that CRAX can map the symbolic bytes
+// back to file offsets (see Memory::getInputFilePageOffset()).
+//
+// mmap() of the input file symbolizes the mapped pages right away,
+// since we can't tell when the target touches them from here.
+
+#define _GNU_SOURCE
+
+#include <s2e/s2e.h>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define PAGE_SIZE 4096
+#define MAX_FDS 1024
+#define POC_NAME_MAX_SIZE 64
+
+// Keep these in sync with src/CRAX.h
+enum S2E_CRAX_COMMANDS {
+    CRAX_BATCH_FORK,
+    CRAX_BATCH_BEGIN,
+    CRAX_SYM_WINDOW,
+};
+
+struct S2E_CRAX_COMMAND {
+    enum S2E_CRAX_COMMANDS Command;
+    union {
+        struct {
+            char PocName[POC_NAME_MAX_SIZE];
+        } BatchBegin;
+
+        struct {
+            uint64_t Buffer;
+            uint64_t Size;
+            uint64_t Begin;
+            uint64_t Result;
+        } SymWindow;
+    };
+};
+
+static int (*real_open)(const char *, int, ...);
+static int (*real_openat)(int, const char *, int, ...);
+static int (*real_close)(int);
+static ssize_t (*real_read)(int, void *, size_t);
+static ssize_t (*real_pread)(int, void *, size_t, off_t);
+static void *(*real_mmap)(void *, size_t, int, int, int, off_t);
+static FILE *(*real_fopen)(const char *, const char *);
+
+static dev_t input_dev;
+static ino_t input_ino;
+static char *shadow;
+static size_t shadow_size;
+static bool *is_page_symbolic;
+static bool is_input_fd[MAX_FDS];
+
+static bool is_input(int fd) {
+    return shadow && fd >= 0 && fd < MAX_FDS && is_input_fd[fd];
+}
+
+// Remembers `fd` if it refers to the input file.
+static int track_fd(int fd) {
+    struct stat st;
+
+    if (shadow && fd >= 0 && fd < MAX_FDS && !fstat(fd, &st)) {
+        is_input_fd[fd] = (st.st_dev == input_dev && st.st_ino == input_ino);
+    }
+    return fd;
+}
+
+// Symbolizes the pages of the shadow covering [offset, offset + n),
+// which haven't been symbolized yet.
+static void symbolize(size_t offset, size_t n) {
+    size_t end = offset + n;
+
+    if (end > shadow_size) {
+        end = shadow_size;
+    }
+
+    for (size_t page = offset / PAGE_SIZE * PAGE_SIZE; page < end; page += PAGE_SIZE) {
+        size_t size = (shadow_size - page < PAGE_SIZE) ? shadow_size - page : PAGE_SIZE;
+        char name[32];
+
+        if (is_page_symbolic[page / PAGE_SIZE]) {
+            continue;
+        }
+        is_page_symbolic[page / PAGE_SIZE] = true;
+
+        snprintf(name, sizeof(name), "CRAX_file_0x%zx", page);
+        s2e_make_symbolic(shadow + page, size, name);
+    }
+}
+
+// Replaces the `n` bytes at `buf` (read from `offset` of the input file)
+// with their symbolic counterparts.
+static void copy_from_shadow(void *buf, off_t offset, ssize_t n) {
+    if (n <= 0 || offset < 0 || (size_t) offset >= shadow_size) {
+        return;
+    }
+    if ((size_t) (offset + n) > shadow_size) {
+        n = shadow_size - offset;
+    }
+
+    symbolize(offset, n);
+    memcpy(buf, shadow + offset, n);
+}
+
+__attribute__((constructor))
+static void init(void) {
+    const char *path = getenv("CRAX_SYM_FILE");
+    struct stat st;
+
+    real_open = dlsym(RTLD_NEXT, "open");
+    real_openat = dlsym(RTLD_NEXT, "openat");
+    real_close = dlsym(RTLD_NEXT, "close");
+    real_read = dlsym(RTLD_NEXT, "read");
+    real_pread = dlsym(RTLD_NEXT, "pread");
+    real_mmap = dlsym(RTLD_NEXT, "mmap");
+    real_fopen = dlsym(RTLD_NEXT, "fopen");
+
+    // Don't let the target's children load us again.
+    unsetenv("LD_PRELOAD");
+
+    int fd = path ? real_open(path, O_RDONLY) : -1;
+
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+        if (fd >= 0) real_close(fd);
+        return;
+    }
+
+    void *p = real_mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    real_close(fd);
+
+    if (p == MAP_FAILED) {
+        perror("mmap error");
+        return;
+    }
+
+    // Let CRAX keep the whole (concrete) file before any page of it
+    // becomes symbolic, so it can fill in the pages which aren't.
+    struct S2E_CRAX_COMMAND cmd = { .Command = CRAX_SYM_WINDOW };
+    cmd.SymWindow.Buffer = (uintptr_t) p;
+    cmd.SymWindow.Size = st.st_size;
+    cmd.SymWindow.Begin = 0;
+    s2e_invoke_plugin("CRAX", &cmd, sizeof(cmd));
+
+    // Without the whole file, the exploits would miss the unread pages.
+    if (!cmd.SymWindow.Result) {
+        s2e_kill_state(0, "CRAX rejected the input file");
+    }
+
+    input_dev = st.st_dev;
+    input_ino = st.st_ino;
+    shadow = p;
+    shadow_size = st.st_size;
+    is_page_symbolic = calloc((shadow_size + PAGE_SIZE - 1) / PAGE_SIZE, sizeof(bool));
+}
+
+
+int open(const char *path, int flags, ...) {
+    mode_t mode = 0;
+
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return track_fd(real_open(path, flags, mode));
+}
+
+int open64(const char *path, int flags, ...) __attribute__((alias("open")));
+
+int openat(int dirfd, const char *path, int flags, ...) {
+    mode_t mode = 0;
+
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return track_fd(real_openat(dirfd, path, flags, mode));
+}
+
+int openat64(int dirfd, const char *path, int flags, ...) __attribute__((alias("openat")));
+
+int close(int fd) {
+    if (fd >= 0 && fd < MAX_FDS) {
+        is_input_fd[fd] = false;
+    }
+    return real_close(fd);
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    if (!is_input(fd)) {
+        return real_read(fd, buf, count);
+    }
+
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    ssize_t n = real_read(fd, buf, count);
+    copy_from_shadow(buf, offset, n);
+    return n;
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+    ssize_t n = real_pread(fd, buf, count, offset);
+
+    if (is_input(fd)) {
+        copy_from_shadow(buf, offset, n);
+    }
+    return n;
+}
+
+ssize_t pread64(int fd, void *buf, size_t count, off_t offset) __attribute__((alias("pread")));
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    if (!is_input(fd) || (flags & MAP_SHARED)) {
+        return real_mmap(addr, length, prot, flags, fd, offset);
+    }
+
+    // Map it writable first, so that we can write the symbolic pages into it.
+    void *ret = real_mmap(addr, length, prot | PROT_WRITE, flags, fd, offset);
+
+    if (ret != MAP_FAILED && (size_t) offset < shadow_size) {
+        size_t n = (shadow_size - offset < length) ? shadow_size - offset : length;
+        copy_from_shadow(ret, offset, n);
+        mprotect(ret, length, prot);
+    }
+    return ret;
+}
+
+void *mmap64(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+    __attribute__((alias("mmap")));
+
+
+// glibc's stdio doesn't call read() through the PLT, so streams
+// of the input file are backed by read() and lseek() above instead.
+static ssize_t cookie_read(void *cookie, char *buf, size_t size) {
+    return read((int) (intptr_t) cookie, buf, size);
+}
+
+static int cookie_seek(void *cookie, off64_t *offset, int whence) {
+    off_t ret = lseek((int) (intptr_t) cookie, *offset, whence);
+
+    if (ret < 0) {
+        return -1;
+    }
+    *offset = ret;
+    return 0;
+}
+
+static int cookie_close(void *cookie) {
+    return close((int) (intptr_t) cookie);
+}
+
+FILE *fopen(const char *path, const char *mode) {
+    // Streams opened for writing are left to libc.
+    if (!shadow || (strcmp(mode, "r") && strcmp(mode, "rb"))) {
+        return real_fopen(path, mode);
+    }
+
+    int fd = track_fd(real_open(path, O_RDONLY));
+
+    if (!is_input(fd)) {
+        if (fd >= 0) real_close(fd);
+        return real_fopen(path, mode);
+    }
+
+    cookie_io_functions_t io = {
+        .read = cookie_read,
+        .write = NULL,
+        .seek = cookie_seek,
+        .close = cookie_close,
+    };
+    return fopencookie((void *) (intptr_t) fd, mode, io);
+}
+
+FILE *fopen64(const char *path, const char *mode) __attribute__((alias("fopen")));
@@ -21,6 +21,8 @@
 #include <s2e/s2e.h>
 
 #include <arpa/inet.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,17 +31,99 @@
 #include <unistd.h>
 
 #define POC_BUF_SIZE 4096
+#define POC_NAME_MAX_SIZE 64
+
+// Keep these in sync with src/CRAX.h
+enum S2E_CRAX_COMMANDS {
+    CRAX_BATCH_FORK,
+    CRAX_BATCH_BEGIN,
+    CRAX_SYM_WINDOW,
+};
+
+struct S2E_CRAX_COMMAND {
+    enum S2E_CRAX_COMMANDS Command;
+    union {
+        struct {
+            char PocName[POC_NAME_MAX_SIZE];
+        } BatchBegin;
+
+        struct {
+            uint64_t Buffer;
+            uint64_t Size;
+            uint64_t Begin;
+            uint64_t Result;
+        } SymWindow;
+    };
+};
 
 char buf[POC_BUF_SIZE] = {0};
+const char *sym_ranges = NULL;
 
 void usage(const char *prog_name) {
     printf("Usage: %s [options...] binary [binary_args...]\n", prog_name);
     printf("\n");
+    printf("Options:\n");
+    printf("  --sym-ranges <f> Only symbolize the input bytes spanned by the ranges in <f>,\n");
+    printf("                   which is written by CRAX's InputTaint module.\n");
+    printf("\n");
     printf("Copyright (C) 2021-2022 Software Quality Laboratory, NYCU.\n");
     printf("This is free software, see the source for copying conditions. There is no\n");
     printf("warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE\n");
 }
 
+// Reads the "begin end" ranges in `path`, and stores the smallest
+// [begin, end) spanning all of them within [0, n) in `*begin` and `*end`.
+bool read_sym_ranges(const char *path, long n, long *begin, long *end) {
+    FILE *f = fopen(path, "r");
+    long b, e;
+
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    *begin = n;
+    *end = 0;
+    while (fscanf(f, "%li %li", &b, &e) == 2) {
+        if (b < *begin) *begin = b;
+        if (e > *end) *end = e;
+    }
+    fclose(f);
+
+    if (*begin < 0) *begin = 0;
+    if (*end > n) *end = n;
+    return *begin < *end;
+}
+
+// Marks `n` bytes of `p` as symbolic, or only the part of it
+// spanned by the ranges in `ranges_path` if it's given.
+//
+// The symbolic bytes are kept in a single array, so CRAX is told where
+// they are, and fills in the rest of the input when it writes exploits.
+void make_input_symbolic(char *p, long n, const char *ranges_path, const char *name) {
+    long begin = 0;
+    long end = n;
+
+    if (ranges_path && read_sym_ranges(ranges_path, n, &begin, &end)) {
+        struct S2E_CRAX_COMMAND cmd = { .Command = CRAX_SYM_WINDOW };
+        cmd.SymWindow.Buffer = (uintptr_t) p;
+        cmd.SymWindow.Size = n;
+        cmd.SymWindow.Begin = begin;
+        s2e_invoke_plugin("CRAX", &cmd, sizeof(cmd));
+
+        if (!cmd.SymWindow.Result) {
+            fprintf(stderr, "CRAX rejected the symbolic window, symbolizing the whole input\n");
+            begin = 0;
+            end = n;
+        }
+    } else {
+        begin = 0;
+        end = n;
+    }
+
+    s2e_make_symbolic(p + begin, end - begin, name);
+}
+
 
 // Currently, this proxy only supports IPv6.
 // TODO: Add ipv4 support.
@@ -50,6 +134,12 @@ int main(int argc, char *argv[], char *envp[]) {
     int fd = -1;
     struct sockaddr_in6 serv_addr;
 
+    while (argc >= 3 && !strcmp(argv[1], "--sym-ranges")) {
+        sym_ranges = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+
     if (argc < 3) {
         usage(argv[0]);
         return EXIT_FAILURE;
@@ -66,7 +156,7 @@ int main(int argc, char *argv[], char *envp[]) {
     puts("Give me crash input, and I'll send it to the server: ");
     n = read(0, buf, sizeof(buf));
 
-    s2e_make_symbolic(buf, n, "CRAX");
+    make_input_symbolic(buf, n, sym_ranges, "CRAX");
 
     if ((fd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
         puts("Socket init error");
@@ -157,7 +157,26 @@ function execute_target {
 
     # LD_PRELOAD="${S2E_SO}" ./sym_stdin -- ./target < ./poc >/dev/null 2>&1
     # ./sym_stdin --no-make-symbolic -- ./target < ./poc #>/dev/null 2>&1
-    ./sym_stdin ./target d < ./poc #>/dev/null 2>&1
+    # Selective symbolization: only symbolize the input bytes
+    # listed in symranges (written by CRAX's InputTaint module).
+    # In batch mode, symranges.tar holds <PoC name>/symranges instead
+    # (see proxies/README.md).
+    SYM_RANGES=""
+    if [ -f symranges.tar ]; then
+        mkdir -p symranges.d && tar -xf symranges.tar -C symranges.d
+        SYM_RANGES="--sym-ranges symranges.d"
+    elif [ -f symranges ]; then
+        SYM_RANGES="--sym-ranges symranges"
+    fi
+
+    if [ -f pocs.tar ]; then
+        # Batch mode: run the target once per PoC in pocs.tar,
+        # each in an S2E state of its own.
+        mkdir -p pocs && tar -xf pocs.tar -C pocs
+        ./sym_stdin ${SYM_RANGES} --batch pocs ./target d
+    else
+        ./sym_stdin ${SYM_RANGES} ./target d < ./poc #>/dev/null 2>&1
+    fi
 }
 
 # Nothing more to initialize on Linux
@@ -212,6 +231,9 @@ target_init
 ${S2EGET} "sym_stdin"
 ${S2EGET} "target"
 ${S2EGET} "poc"
+${S2EGET} "pocs.tar" > /dev/null
+${S2EGET} "symranges" > /dev/null
+${S2EGET} "symranges.tar" > /dev/null
 
 
 
@@ -374,6 +374,29 @@ pluginsConfig.CRAX = {
     showSyscalls = true,
     concolicMode = true,
 
+    -- Send consecutive direct-mode ROP payloads in a single write when
+    -- the read() consuming each of them requests exactly its size.
+    coalesceRopPayload = true,
+
+    -- Precompute the symbols referred to by the exploit script (e.g. target.sym['read'])
+    -- as constants, so that the script doesn't have to load ELF files at startup.
+    selfContainedScript = false,
+
+    -- The formats in which each exploit is rendered:
+    -- "pwntools" (exploit_*.py), "crax" (exploit_*.crax for crax-runner),
+    -- and "json" (exploit_*.json, for batch tools).
+    exploitFormats = { "pwntools", "crax", "json" },
+
+    -- Time budgets (in seconds) of each exploit generation stage, 0 means unlimited.
+    -- When a stage runs out of its budget, CRAX gives up on the current state.
+    timeBudgets = {
+        checkRequirements = 0,
+        initialize = 0,
+        chain = 0,
+        solveStage1 = 0,
+        emitScript = 0,
+    },
+
     -- Filenames
     elfFilename = "./target",
     libcFilename = "./libc-2.24.so",
@@ -385,6 +408,11 @@ pluginsConfig.CRAX = {
         "IOStates",
         "DynamicRop",
         --"SymbolicAddressMap",
+        --"CrashDirectedSearcher",
+        --"SavedRipWatcher",
+        --"StateSnapshot",
+        --"InputTaint",
+        --"VirtualClock",
     },
 
     -- Module config
@@ -20,7 +20,12 @@
 
 #include <s2e/s2e.h>
 
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,36 +35,53 @@
 
 #define POC_BUF_SIZE 4096
 #define LD_PRELOAD_PATH_MAX_SIZE 64
+#define POC_NAME_MAX_SIZE 64
+
+// Keep these in sync with src/CRAX.h
+enum S2E_CRAX_COMMANDS {
+    CRAX_BATCH_FORK,
+    CRAX_BATCH_BEGIN,
+    CRAX_SYM_WINDOW,
+};
+
+struct S2E_CRAX_COMMAND {
+    enum S2E_CRAX_COMMANDS Command;
+    union {
+        struct {
+            char PocName[POC_NAME_MAX_SIZE];
+        } BatchBegin;
+
+        struct {
+            uint64_t Buffer;
+            uint64_t Size;
+            uint64_t Begin;
+            uint64_t Result;
+        } SymWindow;
+    };
+};
 
 char buf[POC_BUF_SIZE];
+const char *sym_ranges = NULL;
 
 void usage(const char *prog_name) {
     printf("Usage: %s [options...] binary [binary_args...]\n", prog_name);
     printf("\n");
+    printf("Options:\n");
+    printf("  --batch <dir>    Run the target once per PoC in <dir> instead of stdin,\n");
+    printf("                   each in an S2E state of its own.\n");
+    printf("  --sym-ranges <f> Only symbolize the input bytes spanned by the ranges in <f>,\n");
+    printf("                   which is written by CRAX's InputTaint module. With --batch,\n");
+    printf("                   <f> is a directory containing <PoC name>/symranges.\n");
+    printf("\n");
     printf("Copyright (C) 2021-2022 Software Quality Laboratory, NYCU.\n");
     printf("This is free software, see the source for copying conditions. There is no\n");
     printf("warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE\n");
 }
 
-int main(int argc, char *argv[], char *envp[]) {
-    int n;
+// Feeds `n` bytes of `buf` to the target's stdin and waits for it.
+int run_target(char *args[], int n) {
     int pipe_fd[2];
 
-    if (argc < 2) {
-        usage(argv[0]);
-        return EXIT_FAILURE;
-    }
-
-    puts("Give me crash input via stdin: ");
-    n = read(0, buf, sizeof(buf));
-
-    if (n < 0) {
-        perror("payload error");
-        return EXIT_FAILURE;
-    }
-
-    s2e_make_symbolic(buf, n, "CRAX");
-
     if (pipe(pipe_fd) < 0) {
         perror("pipe error");
         return EXIT_FAILURE;
@@ -67,14 +89,6 @@ int main(int argc, char *argv[], char *envp[]) {
 
     write(pipe_fd[1], buf, n);
 
-    // Prepare the argv for execve().
-    char *args[argc - 1];
-    int i;
-    for (i = 0; i < argc - 1; i++) {
-        args[i] = argv[i + 1];
-    }
-    args[i] = NULL;
-
     // Start the target program.
     pid_t pid;
     switch (pid = fork()) {
@@ -90,10 +104,186 @@ int main(int argc, char *argv[], char *envp[]) {
         default:  // parent
             close(pipe_fd[0]);
             close(pipe_fd[1]);
-            wait(NULL);
-            s2e_kill_state(0, "program terminated");
+            waitpid(pid, NULL, 0);
             break;
     }
 
     return EXIT_SUCCESS;
 }
+
+// Reads the "begin end" ranges in `path`, and stores the smallest
+// [begin, end) spanning all of them within [0, n) in `*begin` and `*end`.
+bool read_sym_ranges(const char *path, long n, long *begin, long *end) {
+    FILE *f = fopen(path, "r");
+    long b, e;
+
+    if (!f) {
+        perror(path);
+        return false;
+    }
+
+    *begin = n;
+    *end = 0;
+    while (fscanf(f, "%li %li", &b, &e) == 2) {
+        if (b < *begin) *begin = b;
+        if (e > *end) *end = e;
+    }
+    fclose(f);
+
+    if (*begin < 0) *begin = 0;
+    if (*end > n) *end = n;
+    return *begin < *end;
+}
+
+// Marks `n` bytes of `p` as symbolic, or only the part of it
+// spanned by the ranges in `ranges_path` if it's given.
+//
+// The symbolic bytes are kept in a single array, so CRAX is told where
+// they are, and fills in the rest of the input when it writes exploits.
+void make_input_symbolic(char *p, long n, const char *ranges_path, const char *name) {
+    long begin = 0;
+    long end = n;
+
+    if (ranges_path && read_sym_ranges(ranges_path, n, &begin, &end)) {
+        struct S2E_CRAX_COMMAND cmd = { .Command = CRAX_SYM_WINDOW };
+        cmd.SymWindow.Buffer = (uintptr_t) p;
+        cmd.SymWindow.Size = n;
+        cmd.SymWindow.Begin = begin;
+        s2e_invoke_plugin("CRAX", &cmd, sizeof(cmd));
+
+        if (!cmd.SymWindow.Result) {
+            fprintf(stderr, "CRAX rejected the symbolic window, symbolizing the whole input\n");
+            begin = 0;
+            end = n;
+        }
+    } else {
+        begin = 0;
+        end = n;
+    }
+
+    s2e_make_symbolic(p + begin, end - begin, name);
+}
+
+// Forks the current S2E state. Returns true in the forked state.
+bool fork_state(void) {
+    struct S2E_CRAX_COMMAND cmd = { .Command = CRAX_BATCH_FORK };
+    volatile int x = 0;
+
+    // CRAX disallows forking in concolic mode unless it's told to.
+    s2e_invoke_plugin("CRAX", &cmd, sizeof(cmd));
+    s2e_make_symbolic((void *) &x, sizeof(x), "crax_batch_fork");
+    return x != 0;
+}
+
+int run_batch(const char *dir, char *args[]) {
+    struct dirent **entries;
+    int nr_entries = scandir(dir, &entries, NULL, alphasort);
+
+    if (nr_entries < 0) {
+        perror("scandir error");
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < nr_entries; i++) {
+        const char *name = entries[i]->d_name;
+        char path[PATH_MAX];
+
+        if (name[0] == '.' || !fork_state()) {
+            continue;
+        }
+
+        // We're in the forked state, which runs the target with this PoC.
+        struct S2E_CRAX_COMMAND cmd = { .Command = CRAX_BATCH_BEGIN };
+        strncpy(cmd.BatchBegin.PocName, name, sizeof(cmd.BatchBegin.PocName) - 1);
+
+        // CRAX names the directory of this PoC's exploits (and symranges)
+        // after it, so sanitize it the same way CRAX does.
+        for (char *c = cmd.BatchBegin.PocName; *c; c++) {
+            if (!isalnum((unsigned char) *c) && *c != '-' && *c != '_' && *c != '.') {
+                *c = '_';
+            }
+        }
+        s2e_invoke_plugin("CRAX", &cmd, sizeof(cmd));
+
+        snprintf(path, sizeof(path), "%s/%s", dir, name);
+        int fd = open(path, O_RDONLY);
+        int n = (fd < 0) ? -1 : read(fd, buf, sizeof(buf));
+
+        if (n < 0) {
+            perror(path);
+            s2e_kill_state(0, "cannot read PoC");
+            return EXIT_FAILURE;
+        }
+        close(fd);
+
+        // Each PoC is marked symbolic under a name of its own.
+        char sym_name[POC_NAME_MAX_SIZE + 8];
+        snprintf(sym_name, sizeof(sym_name), "CRAX_%s", cmd.BatchBegin.PocName);
+
+        if (sym_ranges) {
+            snprintf(path, sizeof(path), "%s/%s/symranges", sym_ranges, cmd.BatchBegin.PocName);
+            make_input_symbolic(buf, n, path, sym_name);
+        } else {
+            make_input_symbolic(buf, n, NULL, sym_name);
+        }
+
+        run_target(args, n);
+        s2e_kill_state(0, "program terminated");
+        return EXIT_SUCCESS;
+    }
+
+    s2e_kill_state(0, "all PoCs have been dispatched");
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[], char *envp[]) {
+    const char *prog_name = argv[0];
+    const char *batch_dir = NULL;
+    int n;
+
+    while (argc >= 3) {
+        if (!strcmp(argv[1], "--batch")) {
+            batch_dir = argv[2];
+        } else if (!strcmp(argv[1], "--sym-ranges")) {
+            sym_ranges = argv[2];
+        } else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc < 2) {
+        usage(prog_name);
+        return EXIT_FAILURE;
+    }
+
+    // Prepare the argv for execve().
+    char *args[argc];
+    int i;
+    for (i = 0; i < argc - 1; i++) {
+        args[i] = argv[i + 1];
+    }
+    args[i] = NULL;
+
+    if (batch_dir) {
+        return run_batch(batch_dir, args);
+    }
+
+    puts("Give me crash input via stdin: ");
+    n = read(0, buf, sizeof(buf));
+
+    if (n < 0) {
+        perror("payload error");
+        return EXIT_FAILURE;
+    }
+
+    make_input_symbolic(buf, n, sym_ranges, "CRAX");
+
+    if (run_target(args, n) != EXIT_SUCCESS) {
+        return EXIT_FAILURE;
+    }
+
+    s2e_kill_state(0, "program terminated");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,347 @@
+#!/usr/bin/env python3
+# Copyright 2021-2022 Software Quality Laboratory, NYCU.
+#
+# Runs CRAX++ over a corpus of targets, several S2E instances at a time,
+# and collects the generated exploits and logs into a results database.
+#
+# The manifest is a JSON list (or one JSON object per line), e.g.
+#   [
+#     {
+#       "name": "aslr-nx",
+#       "binary": "examples/aslr-nx/aslr-nx",
+#       "poc": "examples/aslr-nx/poc",
+#       "proxy": "sym_stdin",
+#       "techniques": ["Ret2csu", "BasicStackPivoting", "Ret2syscall"],
+#       "timeout": 1800
+#     }
+#   ]
+#
+# Optional fields: "libc", "ld" (default: examples/libc-2.24.so, examples/ld-2.24.so),
+# "modules", "template" (default: proxies/<proxy>/s2e-config.template.lua), "timeout".
+# Relative paths are relative to the manifest.
+#
+# For each entry, an S2E project directory is materialized under <workdir>/projects/
+# from the S2E project of its proxy (e.g. ~/s2e/projects/sym_stdin, created by
+# `s2e new_project` and ./setup.sh), and the results are copied to <workdir>/results/.
+#
+# Examples:
+#   ./scripts/crax-campaign.py manifest.json -j 8 --mem-limit 8192
+#   ./scripts/crax-campaign.py manifest.json --resume
+#   sqlite3 campaign/results.db 'SELECT name, status, nr_exploits FROM runs'
+
+import argparse
+import json
+import os
+import re
+import shutil
+import signal
+import sqlite3
+import subprocess
+import sys
+import threading
+import time
+
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+
+CRAX_ROOT = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
+DEFAULT_S2E_ROOT = os.path.join(os.path.expanduser('~'), 's2e')
+DEFAULT_LIB_DIR = os.path.join(CRAX_ROOT, 'examples')
+
+# These are materialized per target, everything else in the
+# proxy's project directory is shared through symlinks.
+PER_TARGET_FILES = {
+    'target', 'poc', 'libc-2.24.so', 'ld-2.24.so',
+    's2e-config.lua', 's2e-config.template.lua', 's2e-last',
+}
+
+SCHEMA = '''
+CREATE TABLE IF NOT EXISTS runs (
+    id          INTEGER PRIMARY KEY AUTOINCREMENT,
+    name        TEXT NOT NULL,
+    binary      TEXT NOT NULL,
+    poc         TEXT NOT NULL,
+    proxy       TEXT NOT NULL,
+    techniques  TEXT NOT NULL,
+    status      TEXT NOT NULL,  -- exploited, no-exploit, timeout, error
+    returncode  INTEGER,
+    started_at  REAL NOT NULL,
+    elapsed     REAL NOT NULL,
+    nr_exploits INTEGER NOT NULL,
+    result_dir  TEXT NOT NULL,
+    message     TEXT
+);
+CREATE TABLE IF NOT EXISTS exploits (
+    run_id      INTEGER NOT NULL REFERENCES runs(id),
+    path        TEXT NOT NULL,
+    format      TEXT NOT NULL
+);
+'''
+
+
+def load_manifest(path):
+    with open(path) as f:
+        content = f.read()
+    try:
+        entries = json.loads(content)
+    except json.JSONDecodeError:
+        entries = [json.loads(line) for line in content.splitlines() if line.strip()]
+
+    base = os.path.dirname(os.path.realpath(path))
+    resolve = lambda p: os.path.realpath(os.path.join(base, p))
+
+    for e in entries:
+        for key in ('binary', 'poc'):
+            if key not in e:
+                raise ValueError(f'manifest entry {e!r} has no "{key}"')
+        e.setdefault('name', os.path.basename(e['binary']))
+        e.setdefault('proxy', 'sym_stdin')
+        e.setdefault('libc', os.path.join(DEFAULT_LIB_DIR, 'libc-2.24.so'))
+        e.setdefault('ld', os.path.join(DEFAULT_LIB_DIR, 'ld-2.24.so'))
+        e.setdefault('template', os.path.join(CRAX_ROOT, 'proxies', e['proxy'],
+                                              's2e-config.template.lua'))
+        for key in ('binary', 'poc', 'libc', 'ld', 'template'):
+            e[key] = resolve(e[key])
+
+    names = [e['name'] for e in entries]
+    dups = {n for n in names if names.count(n) > 1}
+    if dups:
+        raise ValueError(f'duplicate names in manifest: {", ".join(sorted(dups))}')
+    return entries
+
+
+def lua_list(items):
+    return '{\n' + ''.join(f'        "{item}",\n' for item in items) + '    },'
+
+
+def generate_s2e_config(entry, project_dir, proxy_dir):
+    with open(entry['template']) as f:
+        config = f.read()
+
+    # The same placeholders launch-crax.sh fills in.
+    config = (config.replace('__CANARY__', '0')
+                    .replace('__ELF_BASE__', '0')
+                    .replace('__STATE_INFO_LIST__', '""'))
+
+    # HostFiles and Vmi must look at this project, not the proxy's.
+    config = config.replace('os.getenv("HOME") .. "/s2e/projects/' + entry['proxy'] + '"',
+                            json.dumps(project_dir))
+    config = config.replace(json.dumps(proxy_dir), json.dumps(project_dir))
+
+    for key in ('techniques', 'modules'):
+        if key in entry:
+            pattern = re.compile(r'^(    ' + key + r' = )\{.*?^    \},', re.M | re.S)
+            config, n = pattern.subn(lambda m: m.group(1) + lua_list(entry[key]), config, count=1)
+            if n == 0:
+                raise ValueError(f'{entry["template"]}: cannot find "{key}"')
+    return config
+
+
+def materialize_project(entry, args):
+    proxy_dir = os.path.join(args.s2e_root, 'projects', entry['proxy'])
+    if not os.path.isfile(os.path.join(proxy_dir, 'launch-s2e.sh')):
+        raise RuntimeError(f'{proxy_dir} is not an S2E project (run `s2e new_project` and ./setup.sh)')
+
+    project_dir = os.path.join(args.workdir, 'projects', entry['name'])
+    shutil.rmtree(project_dir, ignore_errors=True)
+    os.makedirs(project_dir)
+
+    for name in os.listdir(proxy_dir):
+        if name in PER_TARGET_FILES or name.startswith(('s2e-out-', 'exploit_')):
+            continue
+        os.symlink(os.path.join(proxy_dir, name), os.path.join(project_dir, name))
+
+    os.symlink(entry['binary'], os.path.join(project_dir, 'target'))
+    os.symlink(entry['poc'], os.path.join(project_dir, 'poc'))
+    os.symlink(entry['libc'], os.path.join(project_dir, 'libc-2.24.so'))
+    os.symlink(entry['ld'], os.path.join(project_dir, 'ld-2.24.so'))
+
+    with open(os.path.join(project_dir, 's2e-config.lua'), 'w') as f:
+        f.write(generate_s2e_config(entry, project_dir, proxy_dir))
+    return project_dir
+
+
+class CpuPool:
+    """Hands out disjoint sets of CPUs to the running S2E instances."""
+
+    def __init__(self, cpus_per_job):
+        self.cpus = sorted(os.sched_getaffinity(0))
+        self.cpus_per_job = max(1, cpus_per_job)
+        self.free = list(self.cpus)
+        self.cond = threading.Condition()
+
+    def acquire(self):
+        with self.cond:
+            n = min(self.cpus_per_job, len(self.cpus))
+            while len(self.free) < n:
+                self.cond.wait()
+            taken, self.free = self.free[:n], self.free[n:]
+            return taken
+
+    def release(self, cpus):
+        with self.cond:
+            self.free.extend(cpus)
+            self.cond.notify_all()
+
+
+# The CPU affinity and memory limit are applied by wrapper commands rather than
+# a preexec_fn, which isn't safe to use while other threads are running.
+# RLIMIT_DATA is used instead of RLIMIT_AS, since S2E reserves a lot of
+# address space that it never touches.
+def build_launch_command(cpus, mem_limit_mb):
+    cmd = []
+    if cpus:
+        cmd += ['taskset', '-c', ','.join(map(str, cpus))]
+    if mem_limit_mb:
+        cmd += ['prlimit', f'--data={mem_limit_mb * 1024 * 1024}']
+    return cmd + ['./launch-s2e.sh']
+
+
+def collect_results(entry, project_dir, args):
+    result_dir = os.path.join(args.workdir, 'results', entry['name'])
+    shutil.rmtree(result_dir, ignore_errors=True)
+    os.makedirs(result_dir)
+
+    exploits = []
+    for name in sorted(os.listdir(project_dir)):
+        m = re.fullmatch(r'exploit_[\d_]+\.(\w+)', name)
+        if m:
+            shutil.copy(os.path.join(project_dir, name), result_dir)
+            exploits.append((os.path.join(result_dir, name), m.group(1)))
+
+    log = os.path.join(project_dir, 'campaign.log')
+    if os.path.isfile(log):
+        shutil.copy(log, result_dir)
+
+    # s2e-last points to the output directory of this run.
+    s2e_last = os.path.join(project_dir, 's2e-last')
+    if os.path.isdir(s2e_last):
+        for name in ('debug.txt', 'info.txt', 'warnings.txt', 'run.stats'):
+            path = os.path.join(s2e_last, name)
+            if os.path.isfile(path):
+                shutil.copy(path, result_dir)
+    return result_dir, exploits
+
+
+def run_entry(entry, args, cpu_pool):
+    begin = time.time()
+    status, returncode, message = 'error', None, None
+    project_dir = None
+    cpus = cpu_pool.acquire()
+
+    try:
+        project_dir = materialize_project(entry, args)
+        timeout = entry.get('timeout', args.timeout)
+
+        with open(os.path.join(project_dir, 'campaign.log'), 'wb') as log:
+            proc = subprocess.Popen(build_launch_command(cpus, args.mem_limit),
+                                    cwd=project_dir,
+                                    stdin=subprocess.DEVNULL,
+                                    stdout=log,
+                                    stderr=subprocess.STDOUT,
+                                    start_new_session=True)
+            try:
+                returncode = proc.wait(timeout=timeout)
+            except subprocess.TimeoutExpired:
+                status = 'timeout'
+            finally:
+                try:
+                    os.killpg(proc.pid, signal.SIGKILL)
+                except ProcessLookupError:
+                    pass
+                proc.wait()
+    except Exception as e:
+        message = str(e)
+    finally:
+        cpu_pool.release(cpus)
+
+    result_dir, exploits = '', []
+    if project_dir:
+        result_dir, exploits = collect_results(entry, project_dir, args)
+        # The S2E output directories (s2e-out-*) live in the project, too.
+        if not args.keep_projects:
+            shutil.rmtree(project_dir, ignore_errors=True)
+
+    # A timed out run may still have generated some exploits.
+    if exploits:
+        status = 'exploited'
+    elif status == 'error' and returncode is not None:
+        status = 'no-exploit'
+
+    return {
+        'entry': entry,
+        'status': status,
+        'returncode': returncode,
+        'started_at': begin,
+        'elapsed': time.time() - begin,
+        'result_dir': result_dir,
+        'exploits': exploits,
+        'message': message,
+    }
+
+
+def record(db, r):
+    e = r['entry']
+    cur = db.execute(
+        'INSERT INTO runs (name, binary, poc, proxy, techniques, status, returncode,'
+        ' started_at, elapsed, nr_exploits, result_dir, message)'
+        ' VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)',
+        (e['name'], e['binary'], e['poc'], e['proxy'], json.dumps(e.get('techniques')),
+         r['status'], r['returncode'], r['started_at'], r['elapsed'],
+         len(r['exploits']), r['result_dir'], r['message']))
+    db.executemany('INSERT INTO exploits (run_id, path, format) VALUES (?, ?, ?)',
+                   [(cur.lastrowid, path, fmt) for path, fmt in r['exploits']])
+    db.commit()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run CRAX++ over a corpus of targets.')
+    parser.add_argument('manifest', help='JSON manifest of the targets')
+    parser.add_argument('-w', '--workdir', default='campaign',
+                        help='where projects, results and results.db go (default: ./campaign)')
+    parser.add_argument('-j', '--jobs', type=int, default=max(1, os.cpu_count() // 2),
+                        help='number of concurrent S2E instances (default: half the cores)')
+    parser.add_argument('--cpus-per-job', type=int, default=1,
+                        help='number of CPUs each S2E instance is pinned to (default: 1)')
+    parser.add_argument('--mem-limit', type=int, default=0,
+                        help='data size limit (RLIMIT_DATA) of each S2E instance in MiB (default: none)')
+    parser.add_argument('-t', '--timeout', type=float, default=3600.0,
+                        help='default timeout of each target in seconds (default: 3600)')
+    parser.add_argument('--s2e-root', default=DEFAULT_S2E_ROOT,
+                        help='the S2E environment (default: ~/s2e)')
+    parser.add_argument('--resume', action='store_true',
+                        help='skip the targets which have already been exploited')
+    parser.add_argument('--keep-projects', action='store_true',
+                        help="don't remove the project and S2E output directories")
+    args = parser.parse_args()
+
+    args.workdir = os.path.realpath(args.workdir)
+    os.makedirs(args.workdir, exist_ok=True)
+
+    entries = load_manifest(args.manifest)
+
+    db = sqlite3.connect(os.path.join(args.workdir, 'results.db'))
+    db.executescript(SCHEMA)
+
+    if args.resume:
+        done = {row[0] for row in db.execute("SELECT name FROM runs WHERE status = 'exploited'")}
+        entries = [e for e in entries if e['name'] not in done]
+
+    cpu_pool = CpuPool(args.cpus_per_job)
+    counts = {}
+
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as executor:
+        futures = [executor.submit(run_entry, e, args, cpu_pool) for e in entries]
+        for i, future in enumerate(as_completed(futures), 1):
+            r = future.result()
+            record(db, r)
+            counts[r['status']] = counts.get(r['status'], 0) + 1
+            print(f"[{i}/{len(entries)}] {r['entry']['name']:<40} {r['status']:<12} "
+                  f"{len(r['exploits'])} exploit(s) {r['elapsed']:.1f}s")
+
+    print(', '.join(f'{status}: {n}' for status, n in sorted(counts.items())) or 'Nothing to do.')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# Copyright 2021-2022 Software Quality Laboratory, NYCU.
+#
+# Checks that snapshot_<id>.json (see StateSnapshot) reproduces the crash, by
+# replaying its recorded I/O against the target on the host without booting
+# S2E. The input states are sent with their concolic bytes, the output states
+# are received and compared with the recorded bytes (except leaks and
+# input-dependent outputs, which differ between runs), and the target is
+# expected to be killed by a signal after the last input state.
+#
+# The path constraints can also be extracted as a KQuery file, which can be
+# re-solved with kleaver.
+#
+# This doesn't regenerate exploits: RopPayloadBuilder and the techniques
+# still need a live S2EExecutionState, so they can't run on a snapshot.
+#
+# Examples:
+#   ./scripts/crax-check-snapshot.py ~/s2e/projects/sym_stdin/s2e-last/snapshot_0.json
+#   ./scripts/crax-check-snapshot.py --target examples/aslr-nx/aslr-nx snapshot_*.json
+#   ./scripts/crax-check-snapshot.py --kquery query.kquery snapshot_0.json
+
+import argparse
+import json
+import os
+import select
+import signal
+import subprocess
+import sys
+import time
+
+
+SUPPORTED_VERSION = 2
+
+
+class Diverged(Exception):
+    pass
+
+
+def load_snapshot(path):
+    with open(path) as f:
+        snapshot = json.load(f)
+
+    if snapshot.get('version') != SUPPORTED_VERSION:
+        raise ValueError(f"{path}: unsupported snapshot version {snapshot.get('version')}")
+    if not snapshot.get('ioStates'):
+        raise ValueError(f'{path}: no I/O states recorded (IOStates was not loaded)')
+    return snapshot
+
+
+def resolve_target(snapshot_path, snapshot, args):
+    if args.target:
+        return os.path.realpath(args.target)
+
+    name = os.path.basename(snapshot['elf']['filename'])
+    candidate = os.path.join(os.path.dirname(os.path.realpath(snapshot_path)), name)
+    if os.path.isfile(candidate):
+        return candidate
+    raise FileNotFoundError(f'{snapshot_path}: cannot find {name}, use --target')
+
+
+def read_exactly(proc, n, deadline):
+    data = b''
+    fd = proc.stdout.fileno()
+
+    while len(data) < n:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            break
+        ready, _, _ = select.select([fd], [], [], remaining)
+        if not ready:
+            break
+        chunk = os.read(fd, n - len(data))
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+def replay(snapshot_path, args):
+    snapshot = load_snapshot(snapshot_path)
+    io_states = snapshot['ioStates']
+    target = resolve_target(snapshot_path, snapshot, args)
+
+    # The states after the last input state are triggered by dynamic ROP,
+    # and never happen in a plain run of the target.
+    state_info_list = io_states['stateInfoList'][:io_states['lastInputStateInfoIdx'] + 1]
+
+    proc = subprocess.Popen([target],
+                            cwd=os.path.dirname(target),
+                            stdin=subprocess.PIPE,
+                            stdout=subprocess.PIPE,
+                            stderr=subprocess.DEVNULL,
+                            start_new_session=True)
+    deadline = time.monotonic() + args.timeout
+
+    try:
+        for i, info in enumerate(state_info_list):
+            if info['kind'] == 'input':
+                proc.stdin.write(bytes.fromhex(info['bytes']))
+                proc.stdin.flush()
+
+            elif info['kind'] == 'output':
+                expected = bytes.fromhex(info['bytes'])
+                actual = read_exactly(proc, info['len'], deadline)
+
+                if len(actual) != len(expected):
+                    raise Diverged(f'state {i}: received {len(actual)} of {len(expected)} bytes')
+
+                if not info['isInteresting'] and not info['isInputDependent'] and actual != expected:
+                    raise Diverged(f'state {i}: expected {expected!r}, received {actual!r}')
+
+        proc.stdin.close()
+        proc.wait(timeout=max(0, deadline - time.monotonic()))
+
+        if proc.returncode >= 0:
+            raise Diverged(f'the target exited with {proc.returncode} instead of crashing')
+
+        return True, f'crashed with {signal.Signals(-proc.returncode).name}'
+
+    except (Diverged, BrokenPipeError) as e:
+        return False, str(e) or 'the target closed its stdin'
+    except subprocess.TimeoutExpired:
+        return False, 'timed out'
+    finally:
+        try:
+            os.killpg(proc.pid, signal.SIGKILL)
+        except ProcessLookupError:
+            pass
+        proc.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Check that CRAX++ snapshots reproduce their crashes.')
+    parser.add_argument('snapshots', nargs='+', help='snapshot_*.json files')
+    parser.add_argument('--target',
+                        help='the target binary (default: next to the snapshot)')
+    parser.add_argument('-t', '--timeout', type=float, default=10.0,
+                        help='timeout of each replay in seconds (default: 10)')
+    parser.add_argument('--kquery',
+                        help='write the path constraints of the (single) snapshot to this file')
+    args = parser.parse_args()
+
+    if args.kquery:
+        if len(args.snapshots) != 1:
+            parser.error('--kquery takes exactly one snapshot')
+        with open(args.kquery, 'w') as f:
+            f.write(load_snapshot(args.snapshots[0])['constraints'])
+
+    ok = True
+    for path in args.snapshots:
+        try:
+            reproduced, reason = replay(path, args)
+        except (OSError, ValueError) as e:
+            reproduced, reason = False, str(e)
+
+        print(f"[{'+' if reproduced else '!'}] {path}: {reason}")
+        ok &= reproduced
+
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -4,6 +4,7 @@
 CANARY="0"
 ELF_BASE="0"
 STATE_INFO_LIST="\"\""
+NR_PROCESSES=""
 
 function usage() {
     echo "CRAXplusplus, software CRash analysis for Automatic eXploit generation."
@@ -13,6 +14,7 @@ function usage() {
     echo "-c, --canary          - The canary value used during exploit time constraint solving."
     echo "-e, --elf-base        - The elf_base value used during exploit time constraint solving."
     echo "-s, --state-info-list - The I/O states info (define it to skip leak detection/verification)."
+    echo "-j, --jobs            - The number of S2E processes the states are spread across."
 }
 
 # Generate s2e-config.lua from s2e-config.template.lua,
@@ -46,6 +48,11 @@ while [[ $# -gt 0 ]]; do
             shift
             shift
             ;;
+        -j|--jobs)
+            NR_PROCESSES="$2"
+            shift
+            shift
+            ;;
         -*|--*)
             echo "Unknown option: $1"
             exit 1
@@ -60,4 +67,10 @@ done
 
 generate_s2e_config
 chmod u+x ./s2e-config.lua
+
+# launch-s2e.sh (generated by s2e-env) hardcodes the number of processes.
+if [ -n "$NR_PROCESSES" ]; then
+    sed -i -e "s/^export S2E_MAX_PROCESSES=.*/export S2E_MAX_PROCESSES=$NR_PROCESSES/" launch-s2e.sh
+fi
+
 exec ./launch-s2e.sh
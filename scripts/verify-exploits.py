@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+# Copyright 2021-2022 Software Quality Laboratory, NYCU.
+#
+# Runs generated exploits against a local target repeatedly and in parallel,
+# and reports the success rate and time-to-shell of each exploit.
+#
+# Each attempt runs in its own sandbox directory, which contains symlinks to
+# the files the exploit refers to (e.g. ./target, ./ld-2.24.so, ./libc-2.24.so).
+# An attempt succeeds if the shell spawned by the exploit evaluates our marker
+# command before the timeout.
+#
+# Examples:
+#   ./scripts/verify-exploits.py examples/aslr-nx
+#   ./scripts/verify-exploits.py -n 50 -j 8 ~/s2e/projects/sym_stdin/s2e-last/exploit_*.py
+#   ./scripts/verify-exploits.py --runner tools/crax-runner/crax-runner exploit_0.crax
+
+import argparse
+import json
+import os
+import re
+import shutil
+import signal
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+from concurrent.futures import ThreadPoolExecutor
+
+
+CRAX_ROOT = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
+DEFAULT_LIB_DIR = os.path.join(CRAX_ROOT, 'examples')
+
+# The shell has to evaluate the arithmetic, so the marker never
+# shows up in the output just because our input is echoed back.
+MARKER_CMD = b'echo CRAX_VERIFY_$((1300+37))\n'
+MARKER = b'CRAX_VERIFY_1337'
+
+
+def find_exploits(paths):
+    exploits = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                if re.fullmatch(r'exploit_[\d_]+\.(py|crax)', name):
+                    exploits.append(os.path.join(path, name))
+        elif os.path.isfile(path):
+            exploits.append(path)
+        else:
+            print(f'[!] No such file or directory: {path}', file=sys.stderr)
+    return exploits
+
+
+def find_referenced_files(exploit):
+    # e.g. process(['./ld-2.24.so', './target'], env={'LD_PRELOAD': './libc-2.24.so'})
+    #      argv ./ld-2.24.so ./target
+    with open(exploit, 'r', errors='replace') as f:
+        content = f.read()
+    names = set(re.findall(r"""['"\s]\./([\w.+-]+)""", content))
+    names.discard(os.path.basename(exploit))
+    return sorted(names)
+
+
+def resolve_file(name, exploit_dir, args):
+    candidates = [os.path.join(exploit_dir, name)]
+
+    if name == 'target':
+        if args.target:
+            candidates.insert(0, args.target)
+        # examples/<name>/<name>
+        candidates.append(os.path.join(exploit_dir, os.path.basename(exploit_dir)))
+
+    candidates.append(os.path.join(args.lib_dir, name))
+
+    for candidate in candidates:
+        if os.path.isfile(candidate):
+            return os.path.realpath(candidate)
+    return None
+
+
+def prepare_sandbox(exploit, args):
+    exploit_dir = os.path.dirname(os.path.realpath(exploit))
+    sandbox = tempfile.mkdtemp(prefix='crax-verify-')
+
+    for name in find_referenced_files(exploit):
+        src = resolve_file(name, exploit_dir, args)
+        if src:
+            os.symlink(src, os.path.join(sandbox, name))
+
+    # The exploit itself runs from the sandbox, next to the files it refers to.
+    shutil.copy(exploit, sandbox)
+    return sandbox
+
+
+def build_command(exploit, args):
+    name = os.path.basename(exploit)
+    if name.endswith('.crax'):
+        if not args.runner:
+            raise RuntimeError(f'{name}: --runner is required for .crax files')
+        return [os.path.realpath(args.runner), '-T', str(int(args.timeout * 1000)), name]
+    return [args.python, name]
+
+
+def run_attempt(exploit, args):
+    sandbox = prepare_sandbox(exploit, args)
+    cmd = build_command(exploit, args)
+    is_runner = exploit.endswith('.crax')
+    env = dict(os.environ, PWNLIB_NOTERM='1', TERM='dumb')
+
+    begin = time.monotonic()
+    proc = subprocess.Popen(cmd,
+                            cwd=sandbox,
+                            env=env,
+                            stdin=subprocess.PIPE,
+                            stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT,
+                            start_new_session=True)
+    output = b''
+    success = False
+    elapsed = None
+
+    try:
+        if is_runner:
+            output, _ = proc.communicate(timeout=args.timeout)
+            success = (proc.returncode == 0)
+        else:
+            # Feed the marker command to proc.interactive() and wait for it.
+            proc.stdin.write(MARKER_CMD * 3)
+            proc.stdin.flush()
+            os.set_blocking(proc.stdout.fileno(), False)
+
+            deadline = begin + args.timeout
+            while time.monotonic() < deadline and MARKER not in output:
+                chunk = proc.stdout.read()
+                if chunk:
+                    output += chunk
+                elif proc.poll() is not None:
+                    break
+                else:
+                    time.sleep(0.01)
+            success = MARKER in output
+    except (subprocess.TimeoutExpired, BrokenPipeError):
+        pass
+    finally:
+        if success:
+            elapsed = time.monotonic() - begin
+        try:
+            os.killpg(proc.pid, signal.SIGKILL)
+        except ProcessLookupError:
+            pass
+        proc.wait()
+        if not args.keep_sandbox:
+            shutil.rmtree(sandbox, ignore_errors=True)
+
+    return {
+        'success': success,
+        'time_to_shell': elapsed,
+        'output': output.decode(errors='replace')[-2000:] if not success else '',
+    }
+
+
+def summarize(exploit, results):
+    times = [r['time_to_shell'] for r in results if r['success']]
+    nr_success = len(times)
+
+    return {
+        'exploit': exploit,
+        'attempts': len(results),
+        'successes': nr_success,
+        'success_rate': nr_success / len(results) if results else 0.0,
+        'time_to_shell': {
+            'min': min(times) if times else None,
+            'median': statistics.median(times) if times else None,
+            'mean': statistics.mean(times) if times else None,
+            'max': max(times) if times else None,
+        },
+        'last_failure_output': next((r['output'] for r in reversed(results) if not r['success']), ''),
+    }
+
+
+def check_aslr():
+    try:
+        with open('/proc/sys/kernel/randomize_va_space') as f:
+            if f.read().strip() == '0':
+                print('[!] ASLR is disabled system-wide (randomize_va_space = 0)', file=sys.stderr)
+    except OSError:
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Verify exploits generated by CRAX++.')
+    parser.add_argument('paths', nargs='+',
+                        help='exploit_*.py / exploit_*.crax files or directories containing them')
+    parser.add_argument('-n', '--attempts', type=int, default=10,
+                        help='number of attempts per exploit (default: 10)')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                        help='number of attempts run in parallel (default: number of cores)')
+    parser.add_argument('-t', '--timeout', type=float, default=30.0,
+                        help='timeout of each attempt in seconds (default: 30)')
+    parser.add_argument('--target',
+                        help='the target binary symlinked as ./target (default: guessed)')
+    parser.add_argument('--lib-dir', default=DEFAULT_LIB_DIR,
+                        help='where to look for ld/libc (default: examples/)')
+    parser.add_argument('--runner',
+                        help='path to tools/crax-runner/crax-runner, required for .crax files')
+    parser.add_argument('--python', default=sys.executable,
+                        help='python interpreter for exploit scripts')
+    parser.add_argument('--json', help='also write the report to this file')
+    parser.add_argument('--min-success-rate', type=float, default=0.0,
+                        help='exit with 1 if any exploit has a success rate <= this (default: 0)')
+    parser.add_argument('--keep-sandbox', action='store_true',
+                        help="don't remove the sandbox directories")
+    args = parser.parse_args()
+
+    exploits = find_exploits(args.paths)
+    if not exploits:
+        print('[!] No exploits found.', file=sys.stderr)
+        return 2
+
+    check_aslr()
+
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as executor:
+        futures = {
+            exploit: [executor.submit(run_attempt, exploit, args) for _ in range(args.attempts)]
+            for exploit in exploits
+        }
+        reports = [summarize(exploit, [f.result() for f in fs]) for exploit, fs in futures.items()]
+
+    fmt = lambda t: f'{t:.3f}s' if t is not None else '-'
+    print(f"{'exploit':<60} {'success':>12} {'median':>9} {'mean':>9} {'max':>9}")
+    for r in reports:
+        t = r['time_to_shell']
+        rate = f"{r['successes']}/{r['attempts']}"
+        print(f"{r['exploit']:<60} {rate:>12} {fmt(t['median']):>9} {fmt(t['mean']):>9} {fmt(t['max']):>9}")
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(reports, f, indent=2)
+
+    ok = all(r['success_rate'] > args.min_success_rate for r in reports)
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -37,6 +37,9 @@ function install_crax_scripts_for_project() {
 
     ln -sfv "$CRAX_ROOT"/scripts/set-target.sh \
             "$S2E_ROOT"/projects/"$1"/set-target.sh
+
+    ln -sfv "$CRAX_ROOT"/tools/crax-runner/crax-runner \
+            "$S2E_ROOT"/projects/"$1"/crax-runner
 }
 
 function install_libc_and_ld_for_project() {
@@ -88,6 +91,12 @@ fi
 cp -ar "$CRAX_SRC" "$S2E_SRC"/libs2eplugins/src/s2e/Plugins/CRAX
 
 
+echo -e "[*] Building crax-runner..."
+make -C "$CRAX_ROOT"/tools/crax-runner >/dev/null || {
+    echo -e "${YELLOW}[!] Warning: failed to build crax-runner. You may ignore this message.${RESET}"
+}
+
+
 prepare_proxy sym_arg
 prepare_proxy sym_env
 prepare_proxy sym_file
@@ -0,0 +1,103 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_CALL_STACK_H
+#define S2E_PLUGINS_CRAX_CALL_STACK_H
+
+#include <s2e/Plugins/CRAX/API/Disassembler.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace s2e::plugins::crax {
+
+// The frames of the target, tracked through call/ret,
+// so that their saved return addresses can be watched.
+class CallStack {
+public:
+    struct Frame {
+        uint64_t savedRipSlot;  // where the return address is saved
+        uint64_t returnAddress;  // the return address pushed by `call`
+    };
+
+    enum class Op {
+        NONE,
+        CALL,
+        RET,
+    };
+
+    CallStack() : m_frames() {}
+
+    static Op getOp(const Instruction &i) {
+        if (i.mnemonic == "call") {
+            return Op::CALL;
+        } else if (i.mnemonic == "ret") {
+            return Op::RET;
+        }
+        return Op::NONE;
+    }
+
+    // Called before `call` with the current RSP.
+    void push(const Instruction &i, uint64_t rsp) {
+        // `call` is about to push the return address at rsp - 8.
+        m_frames.push_back(Frame { rsp - 8, i.address + i.size });
+    }
+
+    // Called before `ret` with the current RSP.
+    void pop(uint64_t rsp) {
+        // Pop the frame being returned from, as well as the frames
+        // which have been discarded without a `ret` (e.g. longjmp()).
+        while (m_frames.size() && m_frames.back().savedRipSlot <= rsp) {
+            m_frames.pop_back();
+        }
+    }
+
+    // Returns the index of the frame whose saved RIP slot
+    // overlaps [addr, addr + size), or -1.
+    int find(uint64_t addr, uint64_t size) const {
+        // Find the frame with the highest saved RIP slot below addr + size,
+        // which is the only one that can overlap [addr, addr + size) if size <= 8.
+        auto it = std::lower_bound(m_frames.begin(), m_frames.end(), addr + size,
+                                   [](const Frame &f, uint64_t end) {
+                                       return f.savedRipSlot >= end;
+                                   });
+
+        if (it == m_frames.end() || it->savedRipSlot + 8 <= addr) {
+            return -1;
+        }
+        return it - m_frames.begin();
+    }
+
+    void resize(size_t size) { m_frames.resize(size); }
+
+    size_t size() const { return m_frames.size(); }
+    bool empty() const { return m_frames.empty(); }
+    const Frame &operator[](size_t i) const { return m_frames[i]; }
+
+private:
+    // From the outermost frame to the innermost one,
+    // so the saved RIP slots are in descending order.
+    std::vector<Frame> m_frames;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_CALL_STACK_H
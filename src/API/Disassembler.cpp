@@ -48,8 +48,10 @@ std::vector<Instruction> Disassembler::disasm(const std::string &symbol) const {
     const ELF &elf = g_crax->getExploit().getElf();
     Function f = elf.functions().at(symbol);
 
-    std::vector<uint8_t> code = mem().readConcrete(elf.getBase() + f.offset, f.size);
-    std::vector<Instruction> insns = disasm(code, elf.getBase() + f.offset);
+    uint64_t addr = g_crax->getElfBase(g_crax->getCurrentState()) + f.offset;
+
+    std::vector<uint8_t> code = mem().readConcrete(addr, f.size);
+    std::vector<Instruction> insns = disasm(code, addr);
 
     assert(insns.size());
     return insns;
@@ -22,6 +22,9 @@
 
 #include <boost/algorithm/searching/knuth_morris_pratt.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+
 #include "Memory.h"
 
 using namespace klee;
@@ -47,19 +50,30 @@ std::vector<uint8_t> Memory::readConcrete(uint64_t virtAddr,
             ret.clear();
         }
     } else {
-        // XXX: The performance seems fast enough even though I bruteforce it byte by byte,
-        // but maybe we can optimize it directly in libs2ecore at some point.
-        bool ok = false;
-        for (uint64_t i = 0; i < size; i++) {
-            if (isSymbolic(virtAddr + i, 1)) {
-                // Read the underlying concrete bytes, but don't concretize them.
-                ok = m_state->mem()->read(virtAddr + i, &ret[i], VirtualAddress, false);
-            } else {
-                ok = m_state->mem()->read(virtAddr + i, &ret[i], 1);
+        // Read page by page, and only go byte by byte through
+        // the pages which actually contain symbolic data.
+        uint64_t i = 0;
+        while (i < size) {
+            uint64_t addr = virtAddr + i;
+            uint64_t n = std::min<uint64_t>(size - i, roundDownToPageBoundary(addr) + TARGET_PAGE_SIZE - addr);
+
+            if (!isSymbolic(addr, n) && m_state->mem()->read(addr, &ret[i], n)) {
+                i += n;
+                continue;
             }
 
-            if (!ok) {
-                ret[i] = 0;
+            for (uint64_t end = i + n; i < end; i++) {
+                bool ok = false;
+                if (isSymbolic(virtAddr + i, 1)) {
+                    // Read the underlying concrete bytes, but don't concretize them.
+                    ok = m_state->mem()->read(virtAddr + i, &ret[i], VirtualAddress, false);
+                } else {
+                    ok = m_state->mem()->read(virtAddr + i, &ret[i], 1);
+                }
+
+                if (!ok) {
+                    ret[i] = 0;
+                }
             }
         }
     }
@@ -167,6 +181,26 @@ std::map<uint64_t, uint64_t> Memory::getSymbolicMemory() const {
     return ret;
 }
 
+bool Memory::isInputArrayName(const std::string &arrayName) {
+    // Other arrays, e.g. sym_stdin's "crax_batch_fork", aren't input.
+    return arrayName.find("CRAX") != std::string::npos;
+}
+
+std::optional<uint64_t> Memory::getInputFilePageOffset(const std::string &arrayName) {
+    static const std::string prefix = "CRAX_file_0x";
+
+    // S2E decorates the names of symbolic arrays, e.g. "v3_CRAX_file_0x1000_3".
+    size_t i = arrayName.find(prefix);
+    if (i == std::string::npos) {
+        return std::nullopt;
+    }
+
+    const char *begin = arrayName.c_str() + i + prefix.size();
+    char *end = nullptr;
+    uint64_t ret = std::strtoull(begin, &end, 16);
+    return (end != begin) ? std::make_optional(ret) : std::nullopt;
+}
+
 const VirtualMemoryMap &Memory::vmmap() const {
     return m_vmmap.rebuild(m_state);
 }
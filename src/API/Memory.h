@@ -25,7 +25,9 @@
 #include <s2e/Plugins/CRAX/API/VirtualMemoryMap.h>
 
 #include <map>
+#include <optional>
 #include <set>
+#include <string>
 
 namespace s2e::plugins::crax {
 
@@ -69,6 +71,16 @@ public:
     [[nodiscard]]
     std::map<uint64_t, uint64_t> getSymbolicMemory() const;
 
+    // Whether `arrayName` is (a part of) the input symbolized by the proxies,
+    // i.e. "CRAX", "CRAX_<PoC name>" or "CRAX_file_0x<page offset>".
+    [[nodiscard]]
+    static bool isInputArrayName(const std::string &arrayName);
+
+    // sym_file --lazy symbolizes the input file page by page, in arrays
+    // named "CRAX_file_0x<page offset>". Returns the page offset, if any.
+    [[nodiscard]]
+    static std::optional<uint64_t> getInputFilePageOffset(const std::string &arrayName);
+
     // Get all the mapped memory region.
     [[nodiscard]]
     const VirtualMemoryMap &vmmap() const;
@@ -49,7 +49,7 @@ void VirtualMemoryMap::initialize() {
 
 
 VirtualMemoryMap &VirtualMemoryMap::rebuild(S2EExecutionState *state) {
-    uint64_t pid = g_crax->getTargetProcessPid();
+    uint64_t pid = g_crax->getTargetProcessPid(state);
     assert(pid && "Target process not running (pid hasn't been intercepted yet)! "
                   "You're probably trying to rebuild vmmap too early");
 
@@ -127,11 +127,12 @@ void VirtualMemoryMap::probeLibcRegion(S2EExecutionState *state) {
     assert(it != elf.got().end() && "__libc_start_main not present in GOT?");
 
     // Read the runtime address of __libc_start_main@libc from GOT
-    uint64_t address = elf.getBase() + it->second;
+    uint64_t elfBase = g_crax->getElfBase(state);
+    uint64_t address = elfBase + it->second;
     std::vector<uint8_t> bytes = mem(state).readConcrete(address, 8, /*concretize=*/false);
     uint64_t value = u64(bytes);
 
-    assert(getModuleBaseAddress(value) != elf.getBase() &&
+    assert(getModuleBaseAddress(value) != elfBase &&
            "__libc_start_main not resolved yet?");
 
     ELF &libc = g_crax->getExploit().getLibc();
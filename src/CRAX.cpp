@@ -20,7 +20,10 @@
 
 #include <s2e/S2E.h>
 
+#include <cctype>
+#include <cstring>
 #include <filesystem>
+#include <thread>
 
 #include "CRAX.h"
 
@@ -49,6 +52,7 @@ CRAX::CRAX(S2E *s2e)
       m_showInstructions(CRAX_CONFIG_GET_BOOL(".showInstructions", false)),
       m_showSyscalls(CRAX_CONFIG_GET_BOOL(".showSyscalls", true)),
       m_concolicMode(CRAX_CONFIG_GET_BOOL(".concolicMode", false)),
+      m_coalesceRopPayload(CRAX_CONFIG_GET_BOOL(".coalesceRopPayload", true)),
       m_exploitForm(CRAX::ExploitForm::SCRIPT),
       m_proxy(),
       m_register(),
@@ -60,7 +64,7 @@ CRAX::CRAX(S2E *s2e)
       m_exploitGenerator(),
       m_modules(),
       m_techniques(),
-      m_targetProcessPid(),
+      m_hasHookedTarget(),
       m_allowedForkingStates() {}
 
 
@@ -81,6 +85,12 @@ void CRAX::initialize() {
     s2e()->getCorePlugin()->onStateForkDecide.connect(
             sigc::mem_fun(*this, &CRAX::onStateForkDecide));
 
+    s2e()->getCorePlugin()->onProcessFork.connect(
+            sigc::mem_fun(*this, &CRAX::onProcessFork));
+
+    m_exploitGenerator.initTimeBudgets();
+    m_exploit.setSelfContained(CRAX_CONFIG_GET_BOOL(".selfContainedScript", false));
+
     // Run `ROPgadget <elf>` on the following ELF files in a worker thread
     // and cache their outputs.
     m_exploitGenerator.getRopGadgetResolver().buildCacheAsync({
@@ -99,6 +109,17 @@ void CRAX::initialize() {
         log<INFO>() << "Creating technique: " << name << '\n';
         m_techniques.push_back(Technique::create(name));
     }
+
+    // Initialize exploit renderers.
+    auto formats = CRAX_CONFIG_GET_STRING_LIST(".exploitFormats");
+    if (formats.empty()) {
+        formats = { "pwntools", "crax", "json" };
+    }
+
+    for (const auto &name : formats) {
+        log<INFO>() << "Creating exploit renderer: " << name << '\n';
+        m_exploitGenerator.addRenderer(ExploitRenderer::create(name));
+    }
 }
 
 
@@ -122,6 +143,10 @@ void CRAX::onSymbolicRip(S2EExecutionState *state,
 
     reg().setRipSymbolic(symbolicRip);
 
+    // Exploit generation resolves everything against the global ELF base,
+    // so it must be the one of this state (see getElfBase()).
+    m_exploit.getElf().setBase(getElfBase(state));
+
     // Dump CPU registers and virtual memory mappings.
     reg().showRegInfo();
     mem().showMapInfo();
@@ -149,8 +174,16 @@ void CRAX::onProcessLoad(S2EExecutionState *state,
 
     // If the user provides "./target" instead of "target" as the elf filename,
     // then we use std::filesystem::path to discard the leading "./"
-    if (imageFileName == std::filesystem::path(m_exploit.getElf().getFilename()).filename()) {
-        m_targetProcessPid = pid;
+    if (imageFileName != std::filesystem::path(m_exploit.getElf().getFilename()).filename()) {
+        return;
+    }
+
+    getPluginState(state)->m_targetProcessPid = pid;
+
+    // In batch mode, the target is loaded once per PoC,
+    // but the hooks must only be installed once.
+    if (!m_hasHookedTarget) {
+        m_hasHookedTarget = true;
 
         m_linuxMonitor->onModuleLoad.connect(
                 sigc::mem_fun(*this, &CRAX::onModuleLoad));
@@ -177,7 +210,13 @@ void CRAX::onModuleLoad(S2EExecutionState *state,
         elfBase = Memory::roundDownToPageBoundary(elfBase);
 
         log<WARN>() << "ELF loaded at: " << hexval(elfBase) << '\n';
-        m_exploit.getElf().setBase(elfBase);
+        getPluginState(state)->m_elfBase = elfBase;
+
+        // The global ELF base is only used by exploit generation, and it's
+        // switched to the base of the exploitable state in onSymbolicRip().
+        if (!m_exploit.getElf().getBase()) {
+            m_exploit.getElf().setBase(elfBase);
+        }
     }
 }
 
@@ -219,8 +258,7 @@ void CRAX::onExecuteInstructionStart(S2EExecutionState *state,
         return;
     }
 
-    auto craxState = getPluginState(state);
-    auto &pending = craxState->m_pendingOnExecuteSyscallEnd;
+    auto &pending = getPluginState(state)->m_pendingOnExecuteSyscallEnd;
 
     if (pending.size()) {
         auto it = pending.find(pc);
@@ -328,4 +366,128 @@ void CRAX::onStateForkDecide(S2EExecutionState *state,
     allowForking |= m_allowedForkingStates.erase(state) == 1;
 }
 
+void CRAX::handleOpcodeInvocation(S2EExecutionState *state,
+                                  uint64_t guestDataPtr,
+                                  uint64_t guestDataSize) {
+    S2E_CRAX_COMMAND command;
+
+    if (guestDataSize != sizeof(command)) {
+        log<WARN>() << "S2E_CRAX_COMMAND size mismatch: " << guestDataSize << '\n';
+        return;
+    }
+
+    if (!state->mem()->read(guestDataPtr, &command, guestDataSize)) {
+        log<WARN>() << "Failed to read S2E_CRAX_COMMAND from the guest\n";
+        return;
+    }
+
+    setCurrentState(state);
+
+    switch (command.Command) {
+        case CRAX_BATCH_FORK:
+            // The proxy is about to branch on a symbolic value.
+            if (m_concolicMode) {
+                m_allowedForkingStates.insert(state);
+            }
+            break;
+
+        case CRAX_BATCH_BEGIN: {
+            // The PoC name is used as the directory of the exploits,
+            // so don't let the guest escape from the current directory.
+            std::string name(command.BatchBegin.PocName,
+                             strnlen(command.BatchBegin.PocName,
+                                     sizeof(command.BatchBegin.PocName)));
+
+            for (auto &c : name) {
+                if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') {
+                    c = '_';
+                }
+            }
+
+            if (name.empty() || name == "." || name == "..") {
+                name = "poc_" + std::to_string(state->getID());
+            }
+
+            log<WARN>() << "Running PoC: " << name << " (id=" << state->getID() << ")\n";
+            getPluginState(state)->m_pocName = std::move(name);
+            break;
+        }
+
+        case CRAX_SYM_WINDOW: {
+            auto &w = command.SymWindow;
+            w.Result = handleSymWindow(state, w.Buffer, w.Size, w.Begin);
+
+            if (!state->mem()->write(guestDataPtr, &command, guestDataSize)) {
+                log<WARN>() << "Failed to write S2E_CRAX_COMMAND back to the guest\n";
+            }
+            break;
+        }
+
+        default:
+            log<WARN>() << "Unknown S2E_CRAX_COMMAND: " << command.Command << '\n';
+            break;
+    }
+}
+
+bool CRAX::handleSymWindow(S2EExecutionState *state,
+                           uint64_t buffer,
+                           uint64_t size,
+                           uint64_t begin) {
+    if (begin > size || size > CRAX_SYM_WINDOW_MAX_SIZE) {
+        log<WARN>() << "Invalid symbolic window: " << hexval(begin)
+                    << " of " << hexval(size) << " input bytes\n";
+        return false;
+    }
+
+    // This is sent before the window is made symbolic,
+    // so the whole input is still concrete here.
+    auto input = std::make_shared<std::vector<uint8_t>>(size);
+    if (!state->mem()->read(buffer, input->data(), size)) {
+        log<WARN>() << "Failed to read the input from the guest\n";
+        return false;
+    }
+
+    log<WARN>() << "Symbolic window begins at offset " << hexval(begin)
+                << " of " << hexval(size) << " input bytes\n";
+
+    CRAXState *craxState = getPluginState(state);
+    craxState->m_symWindowBegin = begin;
+    craxState->m_concreteInput = std::move(input);
+    return true;
+}
+
+void CRAX::onProcessFork(bool preFork,
+                         bool isChild,
+                         unsigned parentProcId) {
+    if (preFork) {
+        // fork() only duplicates the calling thread, so the worker threads
+        // which run ROPgadget or populate the required gadgets of techniques
+        // would be missing in the child, which then waits for them forever.
+        // Let them finish before the address space is duplicated.
+        while (!m_exploitGenerator.getRopGadgetResolver().hasBuiltCache()) {
+            std::this_thread::yield();
+        }
+
+        for (const auto &t : m_techniques) {
+            while (!t->hasPopulatedRequiredGadgets()) {
+                std::this_thread::yield();
+            }
+        }
+        return;
+    }
+
+    // After the fork, S2E kills the states which belong to the other process,
+    // so the states we've kept track of may no longer exist in this process.
+    // m_currentState is fine since every hook sets it before using it.
+    // Everything else in CRAX (incl. g_crax and the per-state plugin states)
+    // is duplicated along with the address space and remains valid.
+    m_allowedForkingStates.clear();
+
+    if (isChild) {
+        log<WARN>()
+            << "Running in S2E process " << s2e()->getCurrentProcessIndex()
+            << " (parent: " << parentProcId << ")\n";
+    }
+}
+
 }  // namespace s2e::plugins::crax
@@ -37,11 +37,11 @@
 
 #include <pybind11/embed.h>
 
+#include <array>
 #include <cassert>
 #include <map>
 #include <memory>
 #include <string>
-#include <typeindex>
 #include <unordered_set>
 #include <vector>
 
@@ -66,30 +66,79 @@
 
 namespace s2e::plugins::crax {
 
+// The commands which the guest (i.e., the proxies) can send to CRAX
+// via s2e_invoke_plugin(). Keep these in sync with proxies/*/sym_*.c
+enum S2E_CRAX_COMMANDS {
+    // Allow the next fork of the current state, so that the proxy can
+    // fork a state per PoC in batch mode even in concolic mode.
+    CRAX_BATCH_FORK,
+
+    // Tag the current state with the PoC which it is going to run.
+    CRAX_BATCH_BEGIN,
+
+    // The proxy is about to symbolize only [Begin, Begin + n) of its input
+    // (or only the pages that are read, for sym_file --lazy), so remember
+    // the whole input to fill in the rest of the exploits. CRAX sets Result
+    // to 1 if it has done so, or the proxy must symbolize the whole input.
+    CRAX_SYM_WINDOW,
+};
+
+// The largest input CRAX_SYM_WINDOW copies out of the guest.
+constexpr uint64_t CRAX_SYM_WINDOW_MAX_SIZE = 16 * 1024 * 1024;
+
+struct S2E_CRAX_COMMAND {
+    S2E_CRAX_COMMANDS Command;
+    union {
+        struct {
+            char PocName[64];
+        } BatchBegin;
+
+        struct {
+            uint64_t Buffer;  // guest address of the whole input
+            uint64_t Size;
+            uint64_t Begin;   // offset of the symbolic window
+            uint64_t Result;  // set by CRAX
+        } SymWindow;
+    };
+};
+
+
 // A plugin state contains per-state information of a plugin,
 // so CRAXState holds information specific to a particular S2EExecutionState.
 //
 // In addition, CRAX supports "modules" (or you can think of them as plugin),
 // so a CRAXState further splits the per-state information at module level.
+//
+// Module states are copy-on-write: a forked CRAXState shares the module
+// states of its parent, and a module state is only cloned when either of
+// them asks for it via getModuleState(). Read-only accessors should use
+// getConstModuleState() instead, which never clones. As a result, do not
+// hold the pointer returned by getModuleState() across a fork.
 class CRAXState : public PluginState {
-    using ModuleStateMap = std::map<const Module *, std::unique_ptr<ModuleState>>;
+    // Indexed by Module::getId().
+    using ModuleStateArray = std::array<std::shared_ptr<ModuleState>, Module::s_maxModules>;
 
     friend class CRAX;
 
 public:
     CRAXState()
         : m_moduleState(),
-          m_pendingOnExecuteSyscallEnd() {}
-
+          m_pendingOnExecuteSyscallEnd(),
+          m_targetProcessPid(),
+          m_elfBase(),
+          m_pocName(),
+          m_symWindowBegin(),
+          m_concreteInput() {}
+
+    // Shallow copy modules, see getModuleState().
     CRAXState(const CRAXState &r)
-        : m_moduleState(),
-          m_pendingOnExecuteSyscallEnd(r.m_pendingOnExecuteSyscallEnd) {
-        // Deep clone modules.
-        for (const auto &[mod, modState] : r.m_moduleState) {
-            std::unique_ptr<ModuleState> newModuleState(modState->clone());
-            m_moduleState.insert(std::make_pair(mod, std::move(newModuleState)));
-        }
-    }
+        : m_moduleState(r.m_moduleState),
+          m_pendingOnExecuteSyscallEnd(r.m_pendingOnExecuteSyscallEnd),
+          m_targetProcessPid(r.m_targetProcessPid),
+          m_elfBase(r.m_elfBase),
+          m_pocName(r.m_pocName),
+          m_symWindowBegin(r.m_symWindowBegin),
+          m_concreteInput(r.m_concreteInput) {}
 
     virtual ~CRAXState() override = default;
 
@@ -102,22 +151,45 @@ public:
     }
 
 
+    // Returns the module state for writing, cloning it first
+    // if it's still shared with other CRAXStates.
     ModuleState *getModuleState(Module *module, ModuleStateFactory f) {
-        auto it = m_moduleState.find(module);
-        if (it == m_moduleState.end()) {
-            std::unique_ptr<ModuleState> newModuleState(f(module, this));
-            assert(newModuleState);
-            ModuleState *ret = newModuleState.get();
-            m_moduleState.insert(std::make_pair(module, std::move(newModuleState)));
-            return ret;
+        auto &modState = findOrCreateModuleState(module, f);
+        if (modState.use_count() > 1) {
+            modState.reset(modState->clone());
         }
-        return it->second.get();
+        return modState.get();
+    }
+
+    // Returns the module state for reading, which may be shared.
+    const ModuleState *getConstModuleState(Module *module, ModuleStateFactory f) {
+        return findOrCreateModuleState(module, f).get();
     }
 
 private:
-    ModuleStateMap m_moduleState;
+    std::shared_ptr<ModuleState> &findOrCreateModuleState(Module *module, ModuleStateFactory f) {
+        auto &modState = m_moduleState[module->getId()];
+        if (!modState) {
+            modState.reset(f(module, this));
+            assert(modState);
+        }
+        return modState;
+    }
+
+    ModuleStateArray m_moduleState;
 
     std::map<uint64_t, SyscallCtx> m_pendingOnExecuteSyscallEnd;  // key: RIP
+
+    // In batch mode, each state runs its own instance of the target,
+    // so these cannot be shared across states.
+    uint64_t m_targetProcessPid;
+    uint64_t m_elfBase;
+    std::string m_pocName;  // empty unless in batch mode
+
+    // Set by CRAX_SYM_WINDOW. The input is immutable once
+    // it's been symbolized, so it's shared across forks.
+    uint64_t m_symWindowBegin;
+    std::shared_ptr<const std::vector<uint8_t>> m_concreteInput;  // null unless windowed
 };
 
 
@@ -178,6 +250,18 @@ public:
         return static_cast<typename T::State *>(modState);
     }
 
+    // Same as above, but the returned `modState` may be shared with other
+    // states, so it's read-only. Prefer this one when nothing is written,
+    // since it saves the forked states from cloning the module state.
+    template <typename T>
+    [[nodiscard]]
+    const typename T::State *getConstModuleState(S2EExecutionState *state, const T *mod) const {
+        auto modState = mod->getConstModuleState(getPluginState(state), &T::State::factory);
+        assert(modState && "Unable to get module state!?");
+
+        return static_cast<const typename T::State *>(modState);
+    }
+
 
     [[nodiscard]]
     S2EExecutionState *getCurrentState() const { return m_currentState; }
@@ -193,6 +277,9 @@ public:
 
     void setConcolicMode(bool enabled) { m_concolicMode = enabled; }
 
+    [[nodiscard]]
+    bool isRopPayloadCoalescingEnabled() const { return m_coalesceRopPayload; }
+
     [[nodiscard]]
     ExploitForm getExploitForm() { return m_exploitForm; }
 
@@ -222,6 +309,9 @@ public:
     [[nodiscard]]
     Exploit &getExploit() { return m_exploit; }
 
+    [[nodiscard]]
+    ExploitGenerator &getExploitGenerator() { return m_exploitGenerator; }
+
     [[nodiscard]]
     const ExploitGenerator &getExploitGenerator() const { return m_exploitGenerator; }
 
@@ -248,21 +338,47 @@ public:
     template <typename M>
     [[nodiscard]]
     static M *getModule() {
-        auto it = Module::s_mapper.find(typeid(M));
-        return (it != Module::s_mapper.end()) ? static_cast<M *>(it->second)
-                                              : nullptr;
+        int id = Module::s_id<M>;
+        return (id != -1) ? static_cast<M *>(Module::s_modules[id]) : nullptr;
     }
 
     template <typename T>
     [[nodiscard]]
     static T *getTechnique() {
-        auto it = Technique::s_mapper.find(typeid(T));
-        return (it != Technique::s_mapper.end()) ? static_cast<T *>(it->second)
-                                                 : nullptr;
+        int id = Technique::s_id<T>;
+        return (id != -1) ? static_cast<T *>(Technique::s_techniques[id]) : nullptr;
+    }
+
+    [[nodiscard]]
+    uint64_t getTargetProcessPid(S2EExecutionState *state) const {
+        return getPluginState(state)->m_targetProcessPid;
+    }
+
+    // The base of the target loaded by `state`. In batch mode, the states of
+    // different PoCs may have loaded it at different addresses, so the hooks
+    // which run before exploit generation use this instead of getElf().getBase().
+    [[nodiscard]]
+    uint64_t getElfBase(S2EExecutionState *state) const {
+        uint64_t elfBase = getPluginState(state)->m_elfBase;
+        return elfBase ? elfBase : m_exploit.getElf().getBase();
     }
 
     [[nodiscard]]
-    uint64_t getTargetProcessPid() const { return m_targetProcessPid; }
+    const std::string &getPocName(S2EExecutionState *state) const {
+        return getPluginState(state)->m_pocName;
+    }
+
+    // The offset of the symbolic input within the whole input.
+    [[nodiscard]]
+    uint64_t getSymWindowBegin(S2EExecutionState *state) const {
+        return getPluginState(state)->m_symWindowBegin;
+    }
+
+    // The whole input if only part of it has been symbolized, or nullptr.
+    [[nodiscard]]
+    const std::vector<uint8_t> *getConcreteInput(S2EExecutionState *state) const {
+        return getPluginState(state)->m_concreteInput.get();
+    }
 
 
     // clang-format off
@@ -301,7 +417,13 @@ private:
     // Allow the guest to communicate with this plugin using s2e_invoke_plugin
     virtual void handleOpcodeInvocation(S2EExecutionState *state,
                                         uint64_t guestDataPtr,
-                                        uint64_t guestDataSize) {}
+                                        uint64_t guestDataSize) override;
+
+    // Handles CRAX_SYM_WINDOW. Returns false if the input is rejected.
+    bool handleSymWindow(S2EExecutionState *state,
+                         uint64_t buffer,
+                         uint64_t size,
+                         uint64_t begin);
 
     void onSymbolicRip(S2EExecutionState *state,
                        klee::ref<klee::Expr> symbolicRip,
@@ -344,6 +466,10 @@ private:
                            const klee::ref<klee::Expr> &condition,
                            bool &allowForking);
 
+    void onProcessFork(bool preFork,
+                       bool isChild,
+                       unsigned parentProcId);
+
 
     // S2E
     S2EExecutionState *m_currentState;
@@ -353,6 +479,7 @@ private:
     bool m_showInstructions;
     bool m_showSyscalls;
     bool m_concolicMode;
+    bool m_coalesceRopPayload;
 
     // CRAX's attributes.
     ExploitForm m_exploitForm;
@@ -365,7 +492,7 @@ private:
     std::vector<std::unique_ptr<Module>> m_modules;
     std::vector<std::unique_ptr<Technique>> m_techniques;
 
-    uint64_t m_targetProcessPid;
+    bool m_hasHookedTarget;
     std::unordered_set<S2EExecutionState *> m_allowedForkingStates;
 };
 
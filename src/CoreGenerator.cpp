@@ -19,7 +19,6 @@
 // SOFTWARE.
 
 #include <s2e/Plugins/CRAX/CRAX.h>
-#include <s2e/Plugins/CRAX/Expr/BinaryExprEval.h>
 #include <s2e/Plugins/CRAX/Utils/StringUtil.h>
 
 #include "CoreGenerator.h"
@@ -30,32 +29,26 @@ namespace s2e::plugins::crax {
 
 void CoreGenerator::generateMainFunction(S2EExecutionState *state,
                                          const std::vector<RopPayload> &ropPayload) {
+    Exploit &exploit = g_crax->getExploit();
+
     handleStage1(ropPayload);
-    g_crax->getExploit().writeline("proc.recvrepeat(0)\n");
+    exploit.writeDrain();
     handleStage2(ropPayload);
 }
 
 void CoreGenerator::handleStage1(const std::vector<RopPayload> &ropPayload) {
     Exploit &exploit = g_crax->getExploit();
-    Process &process = exploit.getProcess();
 
     assert(ropPayload[0].size() == 1);
-    std::string stage1 = evaluate<std::string>(ropPayload[0][0]);
-
-    exploit.writelines({
-        format("payload  = %s", stage1.c_str()),
-        process.toDeclStmt(),
-    });
+    exploit.writeStage1(RopPayloadBuilder::getStage1Payload(ropPayload));
+    exploit.writeSpawn();
 
     // If the proxy in use is SYM_STDIN or SYM_SOCKET, then we have to explicitly
     // send our payload to the stdin of the target process.
     auto proxyType = g_crax->getProxy().getType();
     if (proxyType == Proxy::Type::SYM_STDIN ||
         proxyType == Proxy::Type::SYM_SOCKET) {
-        exploit.writelines({
-            "proc.send(payload)",
-            "time.sleep(0.2)"
-        });
+        exploit.writeSendStage1();
     }
 }
 
@@ -68,11 +61,38 @@ void CoreGenerator::handleStage2(const std::vector<RopPayload> &ropPayload) {
             std::invoke(*le);
         } else {
             for (const ref<Expr> &e : ropPayload[i]) {
-                exploit.appendRopPayload(evaluate<std::string>(e));
+                exploit.appendRopPayload(e);
+            }
+            if (!shouldCoalesce(ropPayload, i)) {
+                exploit.flushRopPayload();
             }
-            exploit.flushRopPayload();
         }
     }
 }
 
+bool CoreGenerator::shouldCoalesce(const std::vector<RopPayload> &ropPayload, size_t i) const {
+    const RopPayloadBuilder &builder = g_crax->getExploitGenerator().getRopPayloadBuilder();
+
+    if (!g_crax->isRopPayloadCoalescingEnabled() ||
+        g_crax->getExploit().isRopPayloadLineTerminated()) {
+        return false;
+    }
+
+    // The last ROP payload must be flushed, and a LambdaExpr
+    // (e.g., receiving a leaked address) acts as a barrier.
+    if (i + 1 >= ropPayload.size() ||
+        ropPayload[i + 1].empty() ||
+        isa<LambdaExpr>(ropPayload[i + 1][0])) {
+        return false;
+    }
+
+    uint64_t size = 0;
+    for (const ref<Expr> &e : ropPayload[i]) {
+        size += e->getWidth() / 8;
+    }
+
+    uint64_t readLen = builder.getSegmentReadLength(i);
+    return readLen && readLen == size;
+}
+
 }  // namespace s2e::plugins::crax
@@ -41,6 +41,13 @@ public:
 protected:
     void handleStage1(const std::vector<RopPayload> &ropPayload);
     void handleStage2(const std::vector<RopPayload> &ropPayload);
+
+private:
+    // Returns true if ropPayload[i] can be sent along with ropPayload[i + 1]
+    // in a single write, i.e., the read() consuming ropPayload[i] requests
+    // exactly as many bytes as it contains, leaving the rest for the next read().
+    [[nodiscard]]
+    bool shouldCoalesce(const std::vector<RopPayload> &ropPayload, size_t i) const;
 };
 
 }  // namespace s2e::plugins::crax
@@ -52,14 +52,8 @@ uint64_t Script::getSymbolValue(const std::string &name) const {
     return it->second;
 }
 
-std::string Script::getFilename(int stateID) const {
-    return format("exploit_%d.py", stateID);
-}
-
 
 
-const std::string Exploit::s_shebang = "#!/usr/bin/env python3";
-
 Exploit::Exploit(const std::string &elfFilename,
                  const std::string &libcFilename,
                  const std::string &ldFilename)
@@ -68,61 +62,104 @@ Exploit::Exploit(const std::string &elfFilename,
       m_libc(libcFilename),
       m_ld(ldFilename),
       m_process(ldFilename, elfFilename, libcFilename),
-      m_ropPayloadLines() {}
+      m_ropPayload(),
+      m_ir(),
+      m_isSelfContained(),
+      // FIXME: Perhaps we should find a better way to do this...
+      m_isRopPayloadLineTerminated(m_elf.hasSymbol("gets")) {}
+
+
+void Exploit::reset() {
+    Script::reset();
+    m_ropPayload.clear();
+    m_ir.reset();
+}
 
 
 uint64_t Exploit::resolveGadget(const ELF &elf, const std::string &gadgetAsm) const {
     return g_crax->getExploitGenerator().getRopGadgetResolver().resolveGadget(elf, gadgetAsm);
 }
 
-void Exploit::appendRopPayload(const std::string &ropPayload) {
-    if (m_ropPayloadLines.empty()) {
-        m_ropPayloadLines.push_back(format("payload  = %s", ropPayload.c_str()));
-    } else {
-        m_ropPayloadLines.push_back(format("payload += %s", ropPayload.c_str()));
-    }
+void Exploit::appendRopPayload(const klee::ref<klee::Expr> &e) {
+    m_ropPayload.push_back(e);
 }
 
 void Exploit::flushRopPayload() {
-    std::vector<std::string> lines;
+    m_ir.add(ExploitIR::Payload{ std::move(m_ropPayload), isRopPayloadLineTerminated() });
+    m_ropPayload.clear();
+}
+
+uint64_t Exploit::writeLeakCanary() {
+    m_ir.add(ExploitIR::Leak{ "canary", "canary", 7, { 0x00 }, 0 });
+    return 7;
+}
+
+uint64_t Exploit::writeLeakElfBase(uint64_t offset) {
+    m_ir.add(ExploitIR::Leak{ "ELF base", m_elf.getVarPrefix() + "_base", 6, {}, offset });
+    return 6;
+}
+
+uint64_t Exploit::writeLeakLibcBase(uint64_t offset) {
+    m_ir.add(ExploitIR::Leak{ "libc base", m_libc.getVarPrefix() + "_base", 6, {}, offset });
+    return 6;
+}
+
+void Exploit::writeComment(const std::string &text) {
+    m_ir.add(ExploitIR::Comment{ text });
+}
+
+void Exploit::writeBlankLine() {
+    m_ir.add(ExploitIR::Comment{});
+}
 
-    writelines(m_ropPayloadLines);
-    m_ropPayloadLines.clear();
+void Exploit::writeSpawn() {
+    m_ir.add(ExploitIR::Spawn{});
+}
 
-    // FIXME: Perhaps we should find a better way to do this...
-    static const char *sendStr = m_elf.hasSymbol("gets") ? "sendline" : "send";
-    lines.push_back(format("proc.%s(payload)", sendStr));
-    lines.push_back("time.sleep(0.2)");
+void Exploit::writeStage1(const std::vector<uint8_t> &bytes, uint64_t begin, uint64_t end) {
+    m_ir.add(ExploitIR::Stage1{ bytes, false, "", begin, end });
+}
 
-    lines.push_back("");
-    writelines(lines);
+void Exploit::writeStage1SolvedAtExploitTime(const std::string &ioStates,
+                                             uint64_t begin,
+                                             uint64_t end) {
+    m_ir.add(ExploitIR::Stage1{ {}, true, ioStates, begin, end });
 }
 
-void Exploit::writeLeakCanary() {
-    writelines({
-        "canary = u64(b'\\x00' + proc.recv(7))",
-        "log.info('leaked canary: {}'.format(hex(canary)))",
-    });
+void Exploit::writeSendStage1(bool isLineTerminated) {
+    m_ir.add(ExploitIR::SendStage1{ isLineTerminated });
 }
 
-void Exploit::writeLeakElfBase(uint64_t offset) {
-    const std::string &prefix = m_elf.getVarPrefix();
+void Exploit::writeSend(const std::vector<uint8_t> &bytes) {
+    m_ir.add(ExploitIR::Send{ bytes });
+}
 
-    writelines({
-        "leaked = u64(proc.recv(6).ljust(8, b'\\x00'))",
-        format("%s_base = leaked - 0x%x", prefix.c_str(), offset),
-        format("log.info('leaked ELF base: {}'.format(hex(%s_base)))", prefix.c_str()),
-    });
+void Exploit::writeRecv(uint64_t len) {
+    if (len) {
+        m_ir.add(ExploitIR::Recv{ len });
+    }
 }
 
-void Exploit::writeLeakLibcBase(uint64_t offset) {
-    const std::string &prefix = m_libc.getVarPrefix();
+void Exploit::writeRecvUntil(const std::vector<uint8_t> &delim) {
+    m_ir.add(ExploitIR::RecvUntil{ delim });
+}
+
+void Exploit::writeRecvAtMost(uint64_t len) {
+    if (len) {
+        m_ir.add(ExploitIR::RecvAtMost{ len });
+    }
+}
+
+void Exploit::writeDrain() {
+    m_ir.add(ExploitIR::Drain{});
+}
+
+void Exploit::writeSleep(uint64_t sec) {
+    m_ir.add(ExploitIR::Sleep{ sec });
+}
 
-    writelines({
-        "leaked = u64(proc.recv(6).ljust(8, b'\\x00'))",
-        format("%s_base = leaked - 0x%x", prefix.c_str(), offset),
-        format("log.info('leaked libc base: {}'.format(hex(%s_base)))", prefix.c_str()),
-    });
+void Exploit::writeShell() {
+    m_ir.add(ExploitIR::Shell{});
 }
 
 std::string Exploit::toVarName(const std::string &s) {
@@ -23,6 +23,7 @@
 
 #include <s2e/S2E.h>
 #include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/ExploitIR.h>
 #include <s2e/Plugins/CRAX/Pwnlib/ELF.h>
 #include <s2e/Plugins/CRAX/Pwnlib/Process.h>
 
@@ -37,7 +38,7 @@ public:
     Script() : m_indentLevel(), m_content(), m_symtab() {}
     virtual ~Script() = default;
 
-    void reset();
+    virtual void reset();
     bool hasSymbol(const std::string &name) const;
     void registerSymbol(const std::string &name, uint64_t value);
     uint64_t getSymbolValue(const std::string &name) const;
@@ -60,7 +61,6 @@ public:
         }
     }
 
-    std::string getFilename(int stateID) const;
     unsigned getIndentLevel() const { return m_indentLevel; }
     const std::string &getContent() const { return m_content; }
     const std::map<std::string, uint64_t> &getSymtab() const { return m_symtab; }
@@ -87,32 +87,63 @@ public:
             const std::string &ldFilename);
     virtual ~Exploit() override = default;
 
+    virtual void reset() override;
+
     // Look for an exact match of the gadget specified by `gadgetAsm` within `elf`.
     // If found, then the offset of the gadget will be returned, and zero otherwise.
     uint64_t resolveGadget(const ELF &elf, const std::string &gadgetAsm) const;
 
-    void appendRopPayload(const std::string &ropPayload);
+    // Buffers `e` until the next flushRopPayload(), which records all
+    // the buffered exprs as a single payload sent to the target.
+    void appendRopPayload(const klee::ref<klee::Expr> &e);
     void flushRopPayload();
 
-    void writeLeakCanary();
-    void writeLeakElfBase(uint64_t offset);
-    void writeLeakLibcBase(uint64_t offset);
+    // Returns true if each flushed ROP payload is sent with a trailing newline,
+    // i.e. the target reads its ROP payloads with gets() instead of read().
+    [[nodiscard]]
+    bool isRopPayloadLineTerminated() const { return m_isRopPayloadLineTerminated; }
+
+    // These methods return the number of bytes received from the target process.
+    uint64_t writeLeakCanary();
+    uint64_t writeLeakElfBase(uint64_t offset);
+    uint64_t writeLeakLibcBase(uint64_t offset);
+
+    // The following methods record I/O actions in the exploit's IR,
+    // which is later rendered into concrete exploit formats.
+    void writeComment(const std::string &text);
+    void writeBlankLine();
+    void writeSpawn();
+    void writeStage1(const std::vector<uint8_t> &bytes, uint64_t begin = 0, uint64_t end = 0);
+    void writeStage1SolvedAtExploitTime(const std::string &ioStates, uint64_t begin, uint64_t end);
+    void writeSendStage1(bool isLineTerminated = false);
+    void writeSend(const std::vector<uint8_t> &bytes);
+    void writeRecv(uint64_t len);
+    void writeRecvUntil(const std::vector<uint8_t> &delim);
+    void writeRecvAtMost(uint64_t len);
+    void writeDrain();
+    void writeSleep(uint64_t sec);
+    void writeShell();
 
     const ELF &getElf() const { return m_elf; }
     const ELF &getLibc() const { return m_libc; }
     const ELF &getLd() const { return m_ld; }
     const Process &getProcess() const { return m_process; }
 
+    // In a self-contained script, symbol references such as `target.sym['read']`
+    // are precomputed as constants, so the script doesn't need to load ELF files.
+    bool isSelfContained() const { return m_isSelfContained; }
+    void setSelfContained(bool selfContained) { m_isSelfContained = selfContained; }
+
     ELF &getElf() { return m_elf; }
     ELF &getLibc() { return m_libc; }
     ELF &getLd() { return m_ld; }
     Process &getProcess() { return m_process; }
 
+    const ExploitIR &getIR() const { return m_ir; }
+
     static std::string toVarName(const std::string &s);
     static std::string toVarName(const ELF &elf, const std::string &gadgetAsm);
 
-    static const std::string s_shebang;
-
 private:
     // ELF files
     ELF m_elf;
@@ -124,8 +155,14 @@ private:
     // choose to provde extra command-line arguments and environment variables.
     Process m_process;
 
-    // Buffered lines.
-    std::vector<std::string> m_ropPayloadLines;
+    // Buffered exprs of the ROP payload to be flushed.
+    std::vector<klee::ref<klee::Expr>> m_ropPayload;
+
+    // The I/O actions of this exploit.
+    ExploitIR m_ir;
+
+    bool m_isSelfContained;
+    bool m_isRopPayloadLineTerminated;
 };
 
 }  // namespace s2e::plugins::crax
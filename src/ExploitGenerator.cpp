@@ -18,47 +18,162 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <s2e/S2E.h>
 #include <s2e/Plugins/CRAX/CRAX.h>
 #include <s2e/Plugins/CRAX/Proxy.h>
 #include <s2e/Plugins/CRAX/Expr/BinaryExprEval.h>
+#include <s2e/Plugins/CRAX/Expr/BinaryExprIterator.h>
 #include <s2e/Plugins/CRAX/Utils/StringUtil.h>
 
 #include <cassert>
+#include <filesystem>
 #include <fstream>
+#include <thread>
 
 #include "ExploitGenerator.h"
 
+using namespace klee;
+
 namespace s2e::plugins::crax {
 
+const std::array<std::string, static_cast<size_t>(ExploitGenerator::Stage::LAST)>
+ExploitGenerator::s_stageNames = {{
+    "none",
+    "checkRequirements",
+    "initialize",
+    "chain",
+    "solveStage1",
+    "emitScript",
+}};
+
+
+ExploitGenerator::ScopedStage::ScopedStage(ExploitGenerator &generator, Stage stage)
+    : m_generator(generator),
+      m_prevStage(generator.m_stage),
+      m_prevDeadline(generator.m_cancellationToken.getDeadline()),
+      m_prevDeadlineReason(generator.m_cancellationToken.getDeadlineReason()) {
+    CancellationToken &token = m_generator.m_cancellationToken;
+    uint64_t budget = m_generator.m_timeBudgets[static_cast<size_t>(stage)];
+    auto deadline = CancellationToken::Clock::time_point::max();
+
+    if (budget) {
+        deadline = CancellationToken::Clock::now() + std::chrono::seconds(budget);
+    }
+
+    // A nested stage never outlives the stage that encloses it.
+    if (deadline < m_prevDeadline) {
+        token.setDeadline(deadline,
+                          format("stage \"%s\" has exceeded its time budget (%llus)",
+                                 s_stageNames[static_cast<size_t>(stage)].c_str(),
+                                 budget));
+    }
+
+    m_generator.m_stage = stage;
+}
+
+ExploitGenerator::ScopedStage::~ScopedStage() {
+    m_generator.m_cancellationToken.setDeadline(m_prevDeadline, m_prevDeadlineReason);
+    m_generator.m_stage = m_prevStage;
+}
+
+
 ExploitGenerator::ExploitGenerator()
     : m_state(),
       m_ropGadgetResolver(),
       m_ropPayloadBuilder(),
-      m_coreGenerator() {}
+      m_coreGenerator(),
+      m_renderers(),
+      m_stage(Stage::NONE),
+      m_timeBudgets(),
+      m_cancellationToken() {}
+
+
+void ExploitGenerator::initTimeBudgets() {
+    for (size_t i = 1; i < s_stageNames.size(); i++) {
+        m_timeBudgets[i] = CRAX_CONFIG_GET_INT("." + s_stageNames[i], 0);
 
+        if (m_timeBudgets[i]) {
+            log<INFO>()
+                << "Time budget of stage \"" << s_stageNames[i] << "\": "
+                << m_timeBudgets[i] << "s\n";
+        }
+    }
+}
+
+void ExploitGenerator::addRenderer(std::unique_ptr<ExploitRenderer> renderer) {
+    m_renderers.push_back(std::move(renderer));
+}
+
+std::string ExploitGenerator::getConfigKey() const {
+    return g_crax->getConfigKey() + ".timeBudgets";
+}
 
 void ExploitGenerator::run(S2EExecutionState *state) {
     assert(g_crax->getProxy().getType() != Proxy::Type::NONE);
 
-    std::vector<RopPayload> ropPayload;
     m_state = state;
+    m_cancellationToken.reset();
+
+    // When a stage runs out of its time budget or a technique turns out
+    // to be not viable, give up on this state and let S2E move on to the next one.
+    try {
+        doRun();
+    } catch (const CancellationToken::CancelledException &e) {
+        log<WARN>() << "Exploit generation cancelled: " << e.what() << '\n';
+    }
 
-    if (!checkRequirements()) {
-        return;
+    m_cancellationToken.reset();
+}
+
+void ExploitGenerator::doRun() {
+    std::vector<RopPayload> ropPayload;
+
+    {
+        ScopedStage stage(*this, Stage::CHECK_REQUIREMENTS);
+        if (!checkRequirements()) {
+            return;
+        }
+    }
+
+    {
+        ScopedStage stage(*this, Stage::INITIALIZE);
+        initialize();
+    }
+
+    {
+        ScopedStage stage(*this, Stage::CHAIN);
+        ropPayload = (g_crax->getExploitForm() == CRAX::ExploitForm::SCRIPT)
+            ? buildFullRopPayload()
+            : buildStage1RopPayload();
     }
 
-    initialize();
+    {
+        ScopedStage stage(*this, Stage::EMIT_SCRIPT);
+        if (g_crax->getExploitForm() == CRAX::ExploitForm::SCRIPT) {
+            generateExploitScript(ropPayload);
+        } else if (ropPayload.size()) {
+            generateExploit(RopPayloadBuilder::getStage1Payload(ropPayload));
+        }
+    }
+}
+
+void ExploitGenerator::waitUntilRopGadgetCacheBuilt() const {
+    if (m_ropGadgetResolver.hasBuiltCache()) {
+        return;
+    }
 
-    if (g_crax->getExploitForm() == CRAX::ExploitForm::SCRIPT) {
-        ropPayload = buildFullRopPayload();
-        generateExploitScript(ropPayload);
-    } else {
-        ropPayload = buildStage1RopPayload();
-        generateExploit(RopPayloadBuilder::getStage1Payload(ropPayload));
+    log<WARN>() << "ROPgadget is still running, please wait...\n";
+    while (!m_ropGadgetResolver.hasBuiltCache()) {
+        m_cancellationToken.throwIfCancelled();
+        std::this_thread::yield();
     }
 }
 
 bool ExploitGenerator::checkRequirements() const {
+    // Gadget resolution blocks until the output of ROPgadget has been cached,
+    // so we wait for it here where the wait can be cancelled.
+    waitUntilRopGadgetCacheBuilt();
+
     for (auto m : g_crax->getModules()) {
         if (!m->checkRequirements()) {
             log<WARN>() << "Requirements unmet (Module: " << m->toString() << ")\n";
@@ -67,6 +182,8 @@ bool ExploitGenerator::checkRequirements() const {
     }
 
     for (auto t : g_crax->getTechniques()) {
+        m_cancellationToken.throwIfCancelled();
+
         if (!t->checkRequirements()) {
             log<WARN>() << "Requirements unmet (Technique: " << t->toString() << ")\n";
             return false;
@@ -97,6 +214,8 @@ void ExploitGenerator::initialize() {
     m_ropPayloadBuilder.reset();
 
     for (auto t : g_crax->getTechniques()) {
+        m_cancellationToken.throwIfCancelled();
+
         log<INFO>() << "Initializing technique: " << t->toString() << '\n';
         t->initialize();
     }
@@ -104,6 +223,8 @@ void ExploitGenerator::initialize() {
 
 std::vector<RopPayload> ExploitGenerator::buildFullRopPayload() {
     for (auto t : g_crax->getTechniques()) {
+        m_cancellationToken.throwIfCancelled();
+
         if (!m_ropPayloadBuilder.chain(*t)) {
             return {};
         }
@@ -114,6 +235,8 @@ std::vector<RopPayload> ExploitGenerator::buildFullRopPayload() {
 
 std::vector<RopPayload> ExploitGenerator::buildStage1RopPayload() {
     for (auto t : g_crax->getTechniques()) {
+        m_cancellationToken.throwIfCancelled();
+
         if (!m_ropPayloadBuilder.chain(*t)) {
             return {};
         }
@@ -131,23 +254,14 @@ bool ExploitGenerator::generateExploitScript(const std::vector<RopPayload> &ropP
     }
 
     Exploit &exploit = g_crax->getExploit();
-    const ELF &elf = exploit.getElf();
-    const ELF &libc = exploit.getLibc();
-    const std::string &elfPrefix = elf.getVarPrefix();
-    const std::string &libcPrefix = libc.getVarPrefix();
-
-    // Write exploit shebang.
-    exploit.writeline(Exploit::s_shebang);
-
-    // Pwntools stuff.
-    exploit.writelines({
-        "from pwn import *",
-        "context.update(arch = 'amd64', os = 'linux', log_level = 'info')",
-        "",
-        format("%s = ELF('%s', checksec=False)", elfPrefix.c_str(), elf.getFilename().c_str()),
-        format("%s = ELF('%s', checksec=False)", libcPrefix.c_str(), libc.getFilename().c_str()),
-        ""
-    });
+    const std::string &elfPrefix = exploit.getElf().getVarPrefix();
+    const std::string &libcPrefix = exploit.getLibc().getVarPrefix();
+
+    // A self-contained script doesn't need to parse the ELF files at runtime,
+    // since all the symbols it refers to are declared in its symbol table.
+    if (exploit.isSelfContained()) {
+        registerPrecomputedSymbols(ropPayload);
+    }
 
     exploit.registerSymbol("canary", 0);
 
@@ -155,45 +269,70 @@ bool ExploitGenerator::generateExploitScript(const std::vector<RopPayload> &ropP
     exploit.registerSymbol(elfPrefix + "_base", 0);
     exploit.registerSymbol(libcPrefix + "_base", 0);
 
-    // Declare symbols and values.
-    for (const auto &[name, value] : exploit.getSymtab()) {
-        exploit.writeline(format("%s = 0x%llx", name.c_str(), value));
-    }
+    // Record the I/O actions of the exploit.
+    m_coreGenerator->generateMainFunction(m_state, ropPayload);
+    exploit.writeShell();
+
+    // Don't leave a half-baked exploit behind if we've run out of time.
+    m_cancellationToken.throwIfCancelled();
 
-    exploit.writeline();
+    // Render the exploit in each of the configured formats.
+    std::filesystem::path dir = getArtifactDir(m_state);
 
-    // Define solve_stage1() function.
-    if (elf.checksec.hasCanary || elf.checksec.hasPIE) {
-        exploit.writeline("def solve_stage1(canary, elf_base, iostates) -> bytes:");
-        exploit.setIndentLevel(4);
-        exploit.writelines({
-            "os.system('./launch-crax.sh -c \"{}\" -e \"{}\" -s \"{}\"'"
-            ".format(hex(canary), hex(elf_base), iostates))",
-            "with open('stage1.bin', 'rb') as f:",
-            "    return f.read()",
-        });
-        exploit.setIndentLevel(0);
-        exploit.writeline();
+    for (const auto &renderer : m_renderers) {
+        std::string filename = dir / renderer->getFilename(getArtifactId(m_state));
+        std::ofstream ofs(filename);
+        ofs << renderer->render(exploit);
+
+        log<WARN>() << "Generated exploit (" << renderer->toString() << "): " << filename << '\n';
     }
+    return true;
+}
 
-    // Generate the main function.
-    exploit.writeline("if __name__ == '__main__':");
-    exploit.setIndentLevel(4);
+void ExploitGenerator::registerPrecomputedSymbols(const std::vector<RopPayload> &ropPayload) const {
+    Exploit &exploit = g_crax->getExploit();
 
-    // Generate the main logic of the exploit script.
-    m_coreGenerator->generateMainFunction(m_state, ropPayload);
+    for (const RopPayload &payload : ropPayload) {
+        for (const ref<Expr> &e : payload) {
+            if (isa<ByteVectorExpr>(e) || isa<LambdaExpr>(e)) {
+                continue;
+            }
 
-    // Write exploit trailer.
-    exploit.setIndentLevel(4);
-    exploit.writeline("proc.interactive()");
+            for (auto it = BinaryExprIterator<IterStrategy::PRE_ORDER>::begin(e);
+                 it != decltype(it)::end();
+                 it++) {
+                auto boe = dyn_cast<BaseOffsetExpr>(*it);
+                if (!boe || !boe->isPrecomputed()) {
+                    continue;
+                }
+
+                const std::string &name = boe->getStrOffset();
+                uint64_t value = boe->getOffset();
+
+                // The same symbol may be referred to multiple times,
+                // but two different symbols must not share a name.
+                if (!exploit.hasSymbol(name) || exploit.getSymbolValue(name) != value) {
+                    exploit.registerSymbol(name, value);
+                }
+            }
+        }
+    }
+}
 
-    // Write the buffered content to the file.
-    std::string filename = exploit.getFilename(m_state->getID());
-    std::ofstream ofs(filename);
-    ofs << exploit.getContent();
+std::string ExploitGenerator::getArtifactId(S2EExecutionState *state) {
+    if (g_s2e->getMaxProcesses() > 1) {
+        return format("%u_%d", g_s2e->getCurrentProcessIndex(), state->getID());
+    }
+    return std::to_string(state->getID());
+}
 
-    log<WARN>() << "Generated exploit script: " << filename << '\n';
-    return true;
+std::filesystem::path ExploitGenerator::getArtifactDir(S2EExecutionState *state) {
+    std::filesystem::path dir = g_crax->getPocName(state);
+
+    if (!dir.empty()) {
+        std::filesystem::create_directories(dir);
+    }
+    return dir;
 }
 
 bool ExploitGenerator::generateExploit(const std::vector<uint8_t> &stage1,
@@ -22,10 +22,14 @@
 #define S2E_PLUGINS_CRAX_EXPLOIT_GENERATOR_H
 
 #include <s2e/Plugins/CRAX/CoreGenerator.h>
+#include <s2e/Plugins/CRAX/Renderers/ExploitRenderer.h>
 #include <s2e/Plugins/CRAX/RopGadgetResolver.h>
 #include <s2e/Plugins/CRAX/RopPayloadBuilder.h>
 #include <s2e/Plugins/CRAX/Techniques/Technique.h>
+#include <s2e/Plugins/CRAX/Utils/CancellationToken.h>
 
+#include <array>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <vector>
@@ -34,8 +38,41 @@ namespace s2e::plugins::crax {
 
 class ExploitGenerator {
 public:
+    // The stages of exploit generation, each of which can be given
+    // a time budget (in seconds) via `pluginsConfig.CRAX.timeBudgets`.
+    enum class Stage {
+        NONE,
+        CHECK_REQUIREMENTS,
+        INITIALIZE,
+        CHAIN,
+        SOLVE_STAGE1,
+        EMIT_SCRIPT,
+        LAST
+    };
+
+    // Arms the time budget of a stage upon construction, and restores
+    // the deadline of the enclosing stage (if any) upon destruction.
+    class ScopedStage {
+    public:
+        ScopedStage(ExploitGenerator &generator, Stage stage);
+        ~ScopedStage();
+
+    private:
+        ExploitGenerator &m_generator;
+        Stage m_prevStage;
+        CancellationToken::Clock::time_point m_prevDeadline;
+        std::string m_prevDeadlineReason;
+    };
+
+
     ExploitGenerator();
 
+    // Reads the time budgets of each stage from CRAX's config.
+    void initTimeBudgets();
+
+    // The generated exploits will be rendered by each of the added renderers.
+    void addRenderer(std::unique_ptr<ExploitRenderer> renderer);
+
     // The entry point of the exploit generator.
     void run(S2EExecutionState *state);
 
@@ -52,7 +89,37 @@ public:
         return m_ropGadgetResolver;
     }
 
+    const RopPayloadBuilder &getRopPayloadBuilder() const {
+        return m_ropPayloadBuilder;
+    }
+
+    // The token is cancelled when the current stage runs out of its
+    // time budget, or when a technique gives up on the current state.
+    CancellationToken &getCancellationToken() const {
+        return m_cancellationToken;
+    }
+
+    [[nodiscard]]
+    Stage getStage() const { return m_stage; }
+
+    std::string getConfigKey() const;
+
+    // Identifies the artifacts (e.g. exploit_<id>.py) of `state`.
+    // State IDs are only unique within an S2E process, so in multi-process
+    // mode the process index is included to avoid filename collisions.
+    [[nodiscard]]
+    static std::string getArtifactId(S2EExecutionState *state);
+
+    // Where the artifacts of `state` go. In batch mode, this is
+    // a directory named after the PoC (created if necessary).
+    [[nodiscard]]
+    static std::filesystem::path getArtifactDir(S2EExecutionState *state);
+
 private:
+    void doRun();
+
+    void waitUntilRopGadgetCacheBuilt() const;
+
     [[nodiscard]]
     bool checkRequirements() const;
 
@@ -64,10 +131,20 @@ private:
     [[nodiscard]]
     std::vector<RopPayload> buildStage1RopPayload();
 
+    // Declares the symbols referred to by a self-contained exploit script.
+    void registerPrecomputedSymbols(const std::vector<RopPayload> &ropPayload) const;
+
+    static const std::array<std::string, static_cast<size_t>(Stage::LAST)> s_stageNames;
+
     S2EExecutionState *m_state;
     RopGadgetResolver m_ropGadgetResolver;
     RopPayloadBuilder m_ropPayloadBuilder;
     std::unique_ptr<CoreGenerator> m_coreGenerator;
+    std::vector<std::unique_ptr<ExploitRenderer>> m_renderers;
+
+    Stage m_stage;
+    std::array<uint64_t, static_cast<size_t>(Stage::LAST)> m_timeBudgets;  // 0: unlimited
+    mutable CancellationToken m_cancellationToken;
 };
 
 }  // namespace s2e::plugins::crax
@@ -0,0 +1,76 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/Plugins/CRAX/API/Logging.h>
+#include <s2e/Plugins/CRAX/Expr/BinaryExprIterator.h>
+#include <s2e/Plugins/CRAX/Expr/Expr.h>
+#include <s2e/Plugins/CRAX/Utils/StringUtil.h>
+
+#include <algorithm>
+
+#include "ExploitIR.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+std::vector<uint8_t> ExploitIR::slice(const Stage1 &stage1) {
+    const auto &bytes = stage1.bytes;
+    size_t begin = std::min<size_t>(stage1.begin, bytes.size());
+    size_t end = stage1.end ? std::min<size_t>(stage1.end, bytes.size()) : bytes.size();
+
+    return std::vector<uint8_t>(bytes.begin() + begin, bytes.begin() + std::max(begin, end));
+}
+
+std::optional<std::vector<std::string>> ExploitIR::toPostfix(const ref<Expr> &e) {
+    std::vector<std::string> ret;
+
+    for (auto it = BinaryExprIterator<IterStrategy::POST_ORDER>::begin(e);
+         it != decltype(it)::end();
+         it++) {
+        ref<Expr> node = *it;
+
+        if (auto boe = dyn_cast<BaseOffsetExpr>(node)) {
+            ret.push_back(boe->getStrBase());
+            ret.push_back(format("0x%llx", boe->getOffset()));
+            ret.push_back("+");
+        } else if (auto ce = dyn_cast<ConstantExpr>(node)) {
+            ret.push_back(format("0x%llx", ce->getZExtValue()));
+        } else {
+            switch (node->getKind()) {
+                case Expr::Kind::Add:
+                    ret.push_back("+");
+                    break;
+                case Expr::Kind::Sub:
+                    ret.push_back("-");
+                    break;
+                case Expr::Kind::Mul:
+                    ret.push_back("*");
+                    break;
+                default:
+                    log<WARN>() << "Unsupported expr kind in exploit IR: " << node->getKind() << '\n';
+                    return std::nullopt;
+            }
+        }
+    }
+    return ret;
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,137 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_EXPLOIT_IR_H
+#define S2E_PLUGINS_CRAX_EXPLOIT_IR_H
+
+#include <klee/Expr.h>
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace s2e::plugins::crax {
+
+// The intermediate representation of a generated exploit.
+//
+// Core generators and techniques don't write exploit scripts directly.
+// Instead, they record a sequence of I/O actions via Exploit, and each
+// ExploitRenderer (see Renderers/) turns the recorded actions, together with
+// the script's symbol table and the target process, into a concrete format,
+// e.g., a pwntools script, a crax-runner description, or JSON.
+class ExploitIR {
+public:
+    // A comment for human readers. An empty comment is a blank line.
+    struct Comment {
+        std::string text;
+    };
+
+    // Start the target process (or connect to the remote target).
+    struct Spawn {};
+
+    // Define the stage 1 payload, which is either solved by CRAX beforehand,
+    // or re-solved at exploitation time with the leaked canary and ELF base.
+    // Only bytes in [begin, end) are used, where end == 0 means the end of it.
+    struct Stage1 {
+        std::vector<uint8_t> bytes;
+        bool isSolvedAtExploitTime;
+        std::string ioStates;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // Send the stage 1 payload.
+    struct SendStage1 {
+        bool isLineTerminated;
+    };
+
+    // Send raw bytes.
+    struct Send {
+        std::vector<uint8_t> bytes;
+    };
+
+    // Receive and discard exactly `len` bytes.
+    struct Recv {
+        uint64_t len;
+    };
+
+    // Receive and discard bytes until `delim`.
+    struct RecvUntil {
+        std::vector<uint8_t> delim;
+    };
+
+    // Receive and discard at most `len` bytes, whatever is available.
+    struct RecvAtMost {
+        uint64_t len;
+    };
+
+    // Discard whatever has been received so far.
+    struct Drain {};
+
+    // var = u64(prefix + recvn(len)) - offset
+    struct Leak {
+        std::string what;
+        std::string var;
+        uint64_t len;
+        std::vector<uint8_t> prefix;
+        uint64_t offset;
+    };
+
+    // Send a ROP payload (stage 2).
+    struct Payload {
+        std::vector<klee::ref<klee::Expr>> exprs;
+        bool isLineTerminated;
+    };
+
+    struct Sleep {
+        uint64_t sec;
+    };
+
+    // The target should be running a shell now.
+    struct Shell {};
+
+    using Action = std::variant<Comment, Spawn, Stage1, SendStage1, Send, Recv,
+                                RecvUntil, RecvAtMost, Drain, Leak, Payload,
+                                Sleep, Shell>;
+
+    ExploitIR() : m_actions() {}
+
+    void reset() { m_actions.clear(); }
+    void add(Action action) { m_actions.push_back(std::move(action)); }
+
+    const std::vector<Action> &getActions() const { return m_actions; }
+
+    // Returns the bytes of `stage1` within [begin, end).
+    static std::vector<uint8_t> slice(const Stage1 &stage1);
+
+    // Converts an expr to postfix tokens, e.g., {"target_base", "0x1040", "+"}.
+    // A BaseOffsetExpr is converted to its base variable plus its resolved offset,
+    // so that consumers of the IR never have to parse any ELF.
+    // Returns std::nullopt if `e` contains an unsupported kind of expr.
+    static std::optional<std::vector<std::string>> toPostfix(const klee::ref<klee::Expr> &e);
+
+private:
+    std::vector<Action> m_actions;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_EXPLOIT_IR_H
@@ -22,7 +22,9 @@
 #include <s2e/Plugins/CRAX/Pwnlib/Util.h>
 #include <s2e/Plugins/CRAX/Utils/StringUtil.h>
 
-#include <stack>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 #include "BinaryExprEval.h"
 
@@ -36,77 +38,96 @@ inline bool isValidOperator(const ref<Expr> &e) {
            dyn_cast<MulExpr>(e);
 }
 
-}  // namespace
 
-template <>
-uint64_t evaluate(const ref<Expr> &e) {
-    // ByteVectorExpr should only exist as expr tree's root node.
-    if (auto bve = dyn_cast<ByteVectorExpr>(e)) {
-        using s2e::plugins::crax::u64;
-        return u64(bve->getBytes());
-    }
+// The results of evaluate<T>() are memoized per expr tree, since the same
+// ROP payload exprs are evaluated again and again by logging, concretization
+// and exploit rendering. klee's exprs are immutable, so a result only becomes
+// stale when the base of an ELF changes (see ELF::getBaseEpoch()).
+class EvalCache {
+public:
+    struct Entry {
+        ref<Expr> root;  // keeps the address of `root` from being reused
+        uint64_t baseEpoch;
+        std::optional<uint64_t> value;
+        std::optional<std::string> str;
+    };
 
-    if (auto phe = dyn_cast<PlaceholderExpr<uint64_t>>(e)) {
-        return 0;
+    EvalCache() : m_entries() {}
+
+    Entry &get(const ref<Expr> &e) {
+        uint64_t baseEpoch = s2e::plugins::crax::ELF::getBaseEpoch();
+
+        if (m_entries.size() >= s_maxNrEntries) {
+            m_entries.clear();
+        }
+
+        auto [it, inserted] = m_entries.try_emplace(e.get());
+        Entry &entry = it->second;
+
+        if (inserted || entry.baseEpoch != baseEpoch) {
+            entry = Entry{ e, baseEpoch, std::nullopt, std::nullopt };
+        }
+        return entry;
     }
 
-    std::stack<ref<Expr>> stack;
+private:
+    static constexpr size_t s_maxNrEntries = 1 << 14;
+
+    std::unordered_map<const Expr *, Entry> m_entries;
+};
+
+// Exprs are never shared across threads, and neither is this cache.
+thread_local EvalCache t_evalCache;
+
 
-    // Evaluates an expr to an integer constant.
+uint64_t doEvaluateValue(const ref<Expr> &e) {
+    std::vector<uint64_t> stack;
+
+    // Evaluates an expr to an integer constant in reverse polish notation.
+    // Unlike ConstantExpr::Add() and friends, this doesn't allocate any
+    // temporary exprs, and the result is truncated to the root's width.
     for (auto it = BinaryExprIterator<IterStrategy::POST_ORDER>::begin(e);
          it != decltype(it)::end();
          it++) {
-        ref<Expr> node = *it;
+        const ref<Expr> &node = *it;
 
         if (auto boe = dyn_cast<BaseOffsetExpr>(node)) {
             // BaseOffsetExpr, essentially, is an AddExpr,
             // but during reverse polish notation evaluation
             // we should treat it like a ConstantExpr.
-            stack.push(boe->toConstantExpr());
+            stack.push_back(boe->getZExtValue());
         } else if (auto ce = dyn_cast<ConstantExpr>(node)) {
-            stack.push(ce);
+            stack.push_back(ce->getZExtValue());
         } else if (isValidOperator(node)) {
             assert(stack.size() >= 2);
 
-            auto op2 = dyn_cast<ConstantExpr>(stack.top());
-            stack.pop();
-            auto op1 = dyn_cast<ConstantExpr>(stack.top());
-            stack.pop();
-            assert(op1 && op2);
-
-            ref<ConstantExpr> result = nullptr;
+            uint64_t op2 = stack.back();
+            stack.pop_back();
+            uint64_t op1 = stack.back();
+            stack.pop_back();
 
             switch (node->getKind()) {
                 case Expr::Kind::Add:
-                    result = op1->Add(op2);
+                    stack.push_back(op1 + op2);
                     break;
                 case Expr::Kind::Sub:
-                    result = op1->Sub(op2);
+                    stack.push_back(op1 - op2);
                     break;
                 case Expr::Kind::Mul:
-                    result = op1->Mul(op2);
+                    stack.push_back(op1 * op2);
                     break;
                 default:
                     break;
             }
-
-            stack.push(result);
         }
     }
 
     assert(stack.size() == 1);
-    auto ce = dyn_cast<ConstantExpr>(stack.top());
-    return ce->getZExtValue();
+    Expr::Width width = e->getWidth();
+    return (width < 64) ? stack.back() & ((1ULL << width) - 1) : stack.back();
 }
 
-
-template <>
-std::string evaluate(const ref<Expr> &e) {
-    // ByteVectorExpr should only exist as expr tree's root node.
-    if (auto bve = dyn_cast<ByteVectorExpr>(e)) {
-        return bve->toString();
-    }
-
+std::string doEvaluateString(const ref<Expr> &e) {
     std::string ret = "p64(";
 
     // Evaluates an expr to a string of infix expression,
@@ -114,7 +135,7 @@ std::string evaluate(const ref<Expr> &e) {
     for (auto it = BinaryExprIterator<IterStrategy::IN_ORDER>::begin(e);
          it != decltype(it)::end();
          it++) {
-        ref<Expr> node = *it;
+        const ref<Expr> &node = *it;
 
         if (auto boe = dyn_cast<BaseOffsetExpr>(node)) {
             ret += boe->toString();
@@ -139,4 +160,47 @@ std::string evaluate(const ref<Expr> &e) {
     return ret + ')';
 }
 
+}  // namespace
+
+
+template <>
+uint64_t evaluate(const ref<Expr> &e) {
+    // ByteVectorExpr should only exist as expr tree's root node.
+    if (auto bve = dyn_cast<ByteVectorExpr>(e)) {
+        using s2e::plugins::crax::u64;
+        return u64(bve->getBytes());
+    }
+
+    if (auto phe = dyn_cast<PlaceholderExpr<uint64_t>>(e)) {
+        return 0;
+    }
+
+    // A single ConstantExpr is common enough and cheaper than a lookup.
+    if (auto ce = dyn_cast<ConstantExpr>(e)) {
+        return ce->getZExtValue();
+    }
+
+    EvalCache::Entry &entry = t_evalCache.get(e);
+    if (!entry.value) {
+        entry.value = doEvaluateValue(e);
+    }
+    return *entry.value;
+}
+
+
+template <>
+std::string evaluate(const ref<Expr> &e) {
+    EvalCache::Entry &entry = t_evalCache.get(e);
+
+    if (!entry.str) {
+        // ByteVectorExpr should only exist as expr tree's root node.
+        if (auto bve = dyn_cast<ByteVectorExpr>(e)) {
+            entry.str = bve->toString();
+        } else {
+            entry.str = doEvaluateString(e);
+        }
+    }
+    return *entry.str;
+}
+
 }  // namespace klee
@@ -28,8 +28,10 @@
 #include <s2e/Plugins/CRAX/Utils/TypeTraits.h>
 
 #include <cassert>
+#include <cctype>
 #include <cstdlib>
 #include <functional>
+#include <map>
 #include <string>
 #include <vector>
 #include <utility>
@@ -40,6 +42,28 @@ using s2e::plugins::crax::dependent_false_v;
 
 namespace klee {
 
+// Returns an Int64 ConstantExpr shared by every caller asking for the same
+// value, since ROP payloads keep rebuilding the same paddings, syscall
+// numbers and small offsets. The table is bounded and thread-local.
+inline ref<ConstantExpr> createInt64Constant(uint64_t value) {
+    static constexpr size_t maxNrEntries = 4096;
+    static thread_local std::map<uint64_t, ref<ConstantExpr>> internTable;
+
+    auto it = internTable.find(value);
+    if (it != internTable.end()) {
+        return it->second;
+    }
+
+    if (internTable.size() >= maxNrEntries) {
+        internTable.clear();
+    }
+
+    ref<ConstantExpr> ret = ConstantExpr::create(value, Expr::Int64);
+    internTable.emplace(value, ret);
+    return ret;
+}
+
+
 // This is CRAX's extension to klee.
 //
 // In a generated exploit script, each line contains a statement such as:
@@ -82,8 +106,9 @@ public:
     static ref<Expr> alloc(const ref<ConstantExpr> &lce,
                            const ref<ConstantExpr> &rce,
                            const std::string &strBase,
-                           const std::string &strOffset) {
-        return ref<Expr>(new BaseOffsetExpr(lce, rce, strBase, strOffset));
+                           const std::string &strOffset,
+                           bool isPrecomputed = false) {
+        return ref<Expr>(new BaseOffsetExpr(lce, rce, strBase, strOffset, isPrecomputed));
     }
 
     // Create a BaseOffsetExpr that represents one of the following:
@@ -99,43 +124,31 @@ public:
     //
     // 4. "target_base + __libc_csu_init_gadget1"
     //    => BaseOffsetExpr::create<BaseType::VAR>(elf, "__libc_csu_init_gadget1")
+    //
+    // If the exploit script is self-contained, 1-3 will refer to precomputed
+    // variables instead, e.g., "target_base + target_sym_read".
+    //
+    // Identical references share one interned node, so the strings are only
+    // formatted once. An interned node is rebuilt if any ELF base has changed
+    // since it was created, or if the value of a VAR has changed.
     template <BaseType BT>
     static ref<Expr> create(const ELF &elf, const std::string &symbol = "") {
-        uint64_t offset = 0;
-        std::string strOffset;
-        const std::string &prefix = elf.getVarPrefix();
-
-        if constexpr (BT == BaseType::SYM) {
-            const auto &symbolMap = elf.symbols();
-            auto it = symbolMap.find(symbol);
-            assert(it != symbolMap.end() && "Symbol doesn't exist in elf.sym");
-            offset = it->second;
-            strOffset = format("%s.sym['%s']", prefix.c_str(), symbol.c_str());
-
-        } else if constexpr (BT == BaseType::GOT) {
-            const auto &gotMap = elf.got();
-            auto it = gotMap.find(symbol);
-            assert(it != gotMap.end() && "Symbol doesn't exist in elf.got");
-            offset = it->second;
-            strOffset = format("%s.got['%s']", prefix.c_str(), symbol.c_str());
-
-        } else if constexpr (BT == BaseType::BSS) {
-            offset = elf.bss();
-            strOffset = format("%s.bss()", prefix.c_str());
-
-        } else if constexpr (BT == BaseType::VAR) {
-            const Exploit &exploit = elf.getExploit();
-            auto it = exploit.getSymtab().find(symbol);
-            assert(it != exploit.getSymtab().end() && "Var doesn't exist in script's symtab");
-            offset = it->second;
-            strOffset = symbol;
-
-        } else {
-            // XXX: Uncomment the following line when S2E upstream upgrades to clang > 13.0.1
-            //static_assert(dependent_false_v<BT>, "Unsupported base type :(");
+        auto &table = s_internTable[{ &elf, BT }];
+        auto it = table.find(symbol);
+        uint64_t baseEpoch = ELF::getBaseEpoch();
+
+        if (it != table.end() && it->second.baseEpoch == baseEpoch) {
+            if constexpr (BT != BaseType::VAR) {
+                return it->second.expr;
+            } else if (it->second.offset == getVarValue(elf, symbol)) {
+                return it->second.expr;
+            }
         }
 
-        return create(elf.getBase(), offset, prefix + "_base", std::move(strOffset));
+        ref<Expr> ret = doCreate<BT>(elf, symbol);
+        uint64_t offset = dyn_cast<BaseOffsetExpr>(ret)->getOffset();
+        table.insert_or_assign(symbol, InternedExpr{ ret, baseEpoch, offset });
+        return ret;
     }
 
     // Create a BaseOffsetExpr that represents an offset from `elf.getBase()`,
@@ -143,16 +156,25 @@ public:
     template <BaseType T>
     static ref<Expr> create(const ELF &elf, uint64_t offset) {
         static_assert(T == BaseType::VAR);
-        return create(elf.getBase(), offset, elf.getVarPrefix() + "_base", "");
+
+        InternedExpr &entry = s_internTableByOffset[{ &elf, offset }];
+        uint64_t baseEpoch = ELF::getBaseEpoch();
+
+        if (!entry.expr || entry.baseEpoch != baseEpoch) {
+            entry.expr = create(elf.getBase(), offset, elf.getVarPrefix() + "_base", "");
+            entry.baseEpoch = baseEpoch;
+            entry.offset = offset;
+        }
+        return entry.expr;
     }
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
     static bool classof(const Expr *e) {
-        // XXX: The normal way of implementing BaseOffsetExpr::classof() is
-        // adding our typeinfo to klee::Expr::Kind enum. However, since I don't
-        // want to touch klee's source code, I'll simply forward the job
-        // to C++'s vtable. Perhaps this can be optimized later.
-        return dynamic_cast<const BaseOffsetExpr *>(e);
+        // The normal way of implementing BaseOffsetExpr::classof() is adding
+        // our kind to klee::Expr::Kind enum, but I don't want to touch klee's
+        // source code. Instead, we rely on the fact that klee's AddExpr always
+        // has two kids, whereas a BaseOffsetExpr hides its kids (see above).
+        return e->getKind() == Expr::Add && e->getNumKids() == 0;
     }
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
@@ -182,52 +204,153 @@ public:
     }
  
     uint64_t getZExtValue() const {
-        return toConstantExpr()->getZExtValue();
+        return dyn_cast<ConstantExpr>(left)->getZExtValue() + getOffset();
+    }
+
+    // If true, `getStrOffset()` is a variable which must be declared
+    // in the script's symbol table with the value of `getOffset()`.
+    bool isPrecomputed() const { return m_isPrecomputed; }
+
+    const std::string &getStrBase() const { return m_strBase; }
+    const std::string &getStrOffset() const { return m_strOffset; }
+
+    uint64_t getOffset() const {
+        return dyn_cast<ConstantExpr>(right)->getZExtValue();
     }
    
 private:
     BaseOffsetExpr(const ref<ConstantExpr> &lce,
                    const ref<ConstantExpr> &rce,
                    const std::string &strBase,
-                   const std::string &strOffset)
+                   const std::string &strOffset,
+                   bool isPrecomputed)
         : AddExpr(lce, rce),
           m_strBase(strBase),
-          m_strOffset(strOffset) {
+          m_strOffset(strOffset),
+          m_isPrecomputed(isPrecomputed) {
         assert(strBase.size() || strOffset.size());
     }
 
+    template <BaseType BT>
+    static ref<Expr> doCreate(const ELF &elf, const std::string &symbol) {
+        uint64_t offset = 0;
+        std::string strOffset;
+        std::string varName;
+        const std::string &prefix = elf.getVarPrefix();
+
+        if constexpr (BT == BaseType::SYM) {
+            const auto &symbolMap = elf.symbols();
+            auto it = symbolMap.find(symbol);
+            assert(it != symbolMap.end() && "Symbol doesn't exist in elf.sym");
+            offset = it->second;
+            strOffset = format("%s.sym['%s']", prefix.c_str(), symbol.c_str());
+            varName = toPrecomputedVarName(prefix + "_sym_", symbol);
+
+        } else if constexpr (BT == BaseType::GOT) {
+            const auto &gotMap = elf.got();
+            auto it = gotMap.find(symbol);
+            assert(it != gotMap.end() && "Symbol doesn't exist in elf.got");
+            offset = it->second;
+            strOffset = format("%s.got['%s']", prefix.c_str(), symbol.c_str());
+            varName = toPrecomputedVarName(prefix + "_got_", symbol);
+
+        } else if constexpr (BT == BaseType::BSS) {
+            offset = elf.bss();
+            strOffset = format("%s.bss()", prefix.c_str());
+            varName = prefix + "_bss";
+
+        } else if constexpr (BT == BaseType::VAR) {
+            offset = getVarValue(elf, symbol);
+            strOffset = symbol;
+
+        } else {
+            // XXX: Uncomment the following line when S2E upstream upgrades to clang > 13.0.1
+            //static_assert(dependent_false_v<BT>, "Unsupported base type :(");
+        }
+
+        bool isPrecomputed = varName.size() && elf.getExploit().isSelfContained();
+        if (isPrecomputed) {
+            strOffset = std::move(varName);
+        }
+
+        return create(elf.getBase(), offset, prefix + "_base", std::move(strOffset), isPrecomputed);
+    }
+
+    static uint64_t getVarValue(const ELF &elf, const std::string &symbol) {
+        const Exploit &exploit = elf.getExploit();
+        auto it = exploit.getSymtab().find(symbol);
+        assert(it != exploit.getSymtab().end() && "Var doesn't exist in script's symtab");
+        return it->second;
+    }
+
     static ref<Expr> create(uint64_t base,
                             uint64_t offset,
                             std::string strBase = "",
-                            std::string strOffset = "") {
+                            std::string strOffset = "",
+                            bool isPrecomputed = false) {
         auto lce = ConstantExpr::create(base, Expr::Int64);
         auto rce = ConstantExpr::create(offset, Expr::Int64);
 
-        return alloc(lce, rce, strBase, strOffset);
+        return alloc(lce, rce, strBase, strOffset, isPrecomputed);
+    }
+
+    // E.g., ("target_sym_", "read@plt") -> "target_sym_read_40plt"
+    // '_' is escaped as "__" and other non-alphanumeric characters as "_<hex>",
+    // so that different symbols never share the same name.
+    static std::string toPrecomputedVarName(const std::string &prefix,
+                                            const std::string &symbol) {
+        std::string ret = prefix;
+        for (unsigned char c : symbol) {
+            if (std::isalnum(c)) {
+                ret += c;
+            } else if (c == '_') {
+                ret += "__";
+            } else {
+                ret += format("_%02x", c);
+            }
+        }
+        return ret;
     }
 
+    struct InternedExpr {
+        ref<Expr> expr;
+        uint64_t baseEpoch;
+        uint64_t offset;
+    };
+
+    // Interned nodes are never shared across threads.
+    static inline thread_local std::map<std::pair<const ELF *, BaseType>,
+                                        std::map<std::string, InternedExpr, std::less<>>> s_internTable;
+
+    static inline thread_local std::map<std::pair<const ELF *, uint64_t>,
+                                        InternedExpr> s_internTableByOffset;
+
     std::string m_strBase;
     std::string m_strOffset;
+    bool m_isPrecomputed;
 };
 
 
-// A placeholder expr which supports storing user data of arbitrary type.
-// It is up to the user to decide what to do with the underlying user data.
-template <typename T>
-class PlaceholderExpr : public Expr {
+// The base class of CRAX's custom exprs which derive from klee::Expr directly.
+//
+// These exprs only live in ROP payloads and never reach klee's solver, so
+// they all report Expr::InvalidKind, which klee never uses for its own exprs.
+// This way, type inquiry on them boils down to comparing integers instead of
+// dynamic_cast, and klee::Expr::Kind enum can stay untouched.
+class CustomExpr : public Expr {
 public:
-    virtual ~PlaceholderExpr() override = default;
+    enum class CustomKind {
+        BYTE_VECTOR,
+        LAMBDA,
+        PLACEHOLDER,
+    };
+
+    virtual ~CustomExpr() override = default;
 
     virtual Kind getKind() const override {
-        // Under normal circumstances, this expr shouldn't exist.
-        // It is supposed to be replaced sometime before expr evaluation.
         return Expr::InvalidKind;
     }
 
-    virtual Width getWidth() const override {
-        return Expr::InvalidWidth;
-    }
-
     virtual unsigned getNumKids() const override {
         return 0;
     }
@@ -240,6 +363,56 @@ public:
         std::abort();
     }
 
+    // Method for support type inquiry through isa, cast, and dyn_cast.
+    static bool classof(const Expr *e) {
+        return e->getKind() == Expr::InvalidKind;
+    }
+
+    // Method for support type inquiry through isa, cast, and dyn_cast.
+    static bool classof(const CustomExpr *) {
+        return true;
+    }
+
+    CustomKind getCustomKind() const { return m_customKind; }
+
+    // Distinguishes the instantiations of a class template, e.g., PlaceholderExpr<T>.
+    const void *getTypeTag() const { return m_typeTag; }
+
+protected:
+    explicit CustomExpr(CustomKind customKind, const void *typeTag = nullptr)
+        : Expr(),
+          m_customKind(customKind),
+          m_typeTag(typeTag) {}
+
+    // Returns true if `e` is a CustomExpr of the given kind (and type tag).
+    static bool isCustomKind(const Expr *e, CustomKind customKind, const void *typeTag = nullptr) {
+        if (e->getKind() != Expr::InvalidKind) {
+            return false;
+        }
+
+        auto ce = static_cast<const CustomExpr *>(e);
+        return ce->m_customKind == customKind && ce->m_typeTag == typeTag;
+    }
+
+private:
+    const CustomKind m_customKind;
+    const void *const m_typeTag;
+};
+
+
+// A placeholder expr which supports storing user data of arbitrary type.
+// It is up to the user to decide what to do with the underlying user data.
+template <typename T>
+class PlaceholderExpr : public CustomExpr {
+public:
+    virtual ~PlaceholderExpr() override = default;
+
+    // Under normal circumstances, this expr shouldn't exist.
+    // It is supposed to be replaced sometime before expr evaluation.
+    virtual Width getWidth() const override {
+        return Expr::InvalidWidth;
+    }
+
     template <typename U>
     static ref<Expr> alloc(U &&userData) {
         return ref<Expr>(new PlaceholderExpr(std::forward<U>(userData)));
@@ -252,7 +425,7 @@ public:
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
     static bool classof(const Expr *e) {
-        return dynamic_cast<const PlaceholderExpr *>(e);
+        return isCustomKind(e, CustomKind::PLACEHOLDER, &s_typeTag);
     }
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
@@ -270,42 +443,29 @@ public:
 
 private:
     PlaceholderExpr(const T &userData)
-        : Expr(),
+        : CustomExpr(CustomKind::PLACEHOLDER, &s_typeTag),
           m_userData(userData) {}
 
     PlaceholderExpr(T &&userData)
-        : Expr(),
+        : CustomExpr(CustomKind::PLACEHOLDER, &s_typeTag),
           m_userData(std::move(userData)) {}
 
+    // Its address is unique to each instantiation of PlaceholderExpr.
+    static inline const char s_typeTag = 0;
+
     T m_userData;
 };
 
 
 // Sometimes we want to send a sequence of bytes whose size is not simply a QWORD.
-class ByteVectorExpr : public Expr {
+class ByteVectorExpr : public CustomExpr {
 public:
     virtual ~ByteVectorExpr() override = default;
 
-    virtual Kind getKind() const override {
-        return Expr::Constant;
-    }
-
     virtual Width getWidth() const override {
         return 8 * m_bytes.size();  // number of bits
     }
 
-    virtual unsigned getNumKids() const override {
-        return 0;
-    }
-
-    virtual ref<Expr> getKid(unsigned i) const override {
-        return nullptr;
-    }
-
-    virtual ref<Expr> rebuild(ref<Expr> kids[]) const override {
-        std::abort();
-    }
-
     template <typename InputIt>
     static ref<Expr> alloc(InputIt first, InputIt last) {
         return ref<Expr>(new ByteVectorExpr(std::vector<uint8_t>(first, last)));
@@ -318,7 +478,7 @@ public:
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
     static bool classof(const Expr *e) {
-        return dynamic_cast<const ByteVectorExpr*>(e);
+        return isCustomKind(e, CustomKind::BYTE_VECTOR);
     }
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
@@ -336,7 +496,7 @@ public:
 
 private:
     ByteVectorExpr(std::vector<uint8_t> &&bytes)
-        : Expr(),
+        : CustomExpr(CustomKind::BYTE_VECTOR),
           m_bytes(std::move(bytes)) {}
 
     std::vector<uint8_t> m_bytes;
@@ -344,32 +504,16 @@ private:
 
 
 // A flexible expression which allows the caller to perform arbitrary actions.
-class LambdaExpr : public Expr {
+class LambdaExpr : public CustomExpr {
     using CallbackType = std::function<void ()>;
 
 public:
     virtual ~LambdaExpr() override = default;
 
-    virtual Kind getKind() const override {
-        return Expr::InvalidKind;
-    }
-
     virtual Width getWidth() const override {
         return Expr::InvalidWidth;
     }
 
-    virtual unsigned getNumKids() const override {
-        return 0;
-    }
-
-    virtual ref<Expr> getKid(unsigned i) const override {
-        return nullptr;
-    }
-
-    virtual ref<Expr> rebuild(ref<Expr> kids[]) const override {
-        std::abort();
-    }
-
     template <typename U>
     static ref<Expr> alloc(U &&cb) {
         return ref<Expr>(new LambdaExpr(std::forward<U>(cb)));
@@ -382,7 +526,7 @@ public:
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
     static bool classof(const Expr *e) {
-        return dynamic_cast<const LambdaExpr *>(e);
+        return isCustomKind(e, CustomKind::LAMBDA);
     }
 
     // Method for support type inquiry through isa, cast, and dyn_cast.
@@ -396,11 +540,11 @@ public:
 
 private:
     LambdaExpr(const CallbackType &cb)
-        : Expr(),
+        : CustomExpr(CustomKind::LAMBDA),
           m_callback(cb) {}
 
     LambdaExpr(CallbackType &&cb)
-        : Expr(),
+        : CustomExpr(CustomKind::LAMBDA),
           m_callback(std::move(cb)) {}
 
     CallbackType m_callback;
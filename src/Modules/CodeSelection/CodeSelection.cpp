@@ -20,6 +20,8 @@
 
 #include <s2e/Plugins/CRAX/CRAX.h>
 
+#include <algorithm>
+
 #include "CodeSelection.h"
 
 using namespace klee;
@@ -29,7 +31,9 @@ namespace s2e::plugins::crax {
 CodeSelection::CodeSelection()
     : Module(),
       m_functions(CRAX_CONFIG_GET_STRING_LIST("")),
-      m_symMemRegMap(initSymMemRegMap()) {
+      m_symMemRegMap(initSymMemRegMap()),
+      m_deniedFunctions(initDeniedFunctions()),
+      m_callees() {
     auto functionMonitor = g_s2e->getPlugin<FunctionMonitor>();
 
     if (!functionMonitor) {
@@ -37,18 +41,76 @@ CodeSelection::CodeSelection()
         exit(1);
     }
 
+    buildCallees();
+
     functionMonitor->onCall.connect(
             sigc::mem_fun(*this, &CodeSelection::onFunctionCall));
 }
 
 
 CodeSelection::SymMemRegMap CodeSelection::initSymMemRegMap() {
+    // Only the strings which are read by the callee are listed here.
+    return {
+        { "__lxstat", { Register::X64::RSI } },
+        { "__xstat",  { Register::X64::RSI } },
+        { "access",   { Register::X64::RDI } },
+        { "fopen",    { Register::X64::RDI, Register::X64::RSI } },
+        { "fputs",    { Register::X64::RDI } },
+        { "lstat",    { Register::X64::RDI } },
+        { "open",     { Register::X64::RDI } },
+        { "opendir",  { Register::X64::RDI } },
+        { "perror",   { Register::X64::RDI } },
+        { "puts",     { Register::X64::RDI } },
+        { "stat",     { Register::X64::RDI } },
+        { "unlink",   { Register::X64::RDI } },
+    };
+}
+
+CodeSelection::FunctionSet CodeSelection::initDeniedFunctions() {
+    // Functions whose return value is computed from their input (e.g., strcmp,
+    // strlen, atoi, getenv) must not be code-selected, since the target would
+    // branch on a concrete result without any constraint on the input.
+    // Neither must functions which copy their input elsewhere (e.g., memcpy,
+    // strcpy), or the copy would be concrete, nor functions which write to
+    // their arguments (e.g., read, fgets), since the writes would be undone
+    // when the arguments are symbolized again.
     return {
-        { "lstat",   { Register::X64::RDI } },
-        { "perror",  { Register::X64::RDI } },
+        "atoi", "atol", "atoll", "getenv", "memchr", "memcmp",
+        "strcasecmp", "strchr", "strcmp", "strcspn", "strlen", "strncasecmp",
+        "strncmp", "strnlen", "strrchr", "strspn", "strstr",
+        "strtol", "strtoll", "strtoul", "strtoull",
+        "memcpy", "memmove", "sprintf", "snprintf", "strcat", "strcpy",
+        "strdup", "strncat", "strncpy", "strndup",
+        "fgets", "fread", "fscanf", "gets", "memset", "read", "recv",
+        "scanf", "sscanf", "strtok",
     };
 }
 
+void CodeSelection::buildCallees() {
+    const ELF &elf = g_crax->getExploit().getElf();
+
+    if (m_functions.size()) {
+        for (const auto &funcSym : m_functions) {
+            if (m_deniedFunctions.count(funcSym)) {
+                log<WARN>() << "CodeSelection: " << funcSym << "() cannot be code-selected\n";
+                continue;
+            }
+            if (auto it = elf.symbols().find(funcSym); it != elf.symbols().end()) {
+                m_callees.emplace(it->second, funcSym);
+            }
+            if (auto it = elf.plt().find(funcSym); it != elf.plt().end()) {
+                m_callees.emplace(it->second, funcSym);
+            }
+        }
+    } else {
+        for (const auto &[offset, funcSym] : elf.inversePlt()) {
+            if (!m_deniedFunctions.count(funcSym)) {
+                m_callees.emplace(offset, funcSym);
+            }
+        }
+    }
+}
+
 bool CodeSelection::checkRequirements() const {
     Exploit &exploit = g_crax->getExploit();
     return exploit.getElf().plt().size();
@@ -70,32 +132,34 @@ void CodeSelection::onFunctionCall(S2EExecutionState *state,
 
     std::string symbol;
 
-    if (!isCallingRegisteredLibraryFunction(calleePc, symbol)) {
+    if (!isCallingRegisteredLibraryFunction(state, calleePc, symbol)) {
         return;
     }
 
     log<WARN>() << "CodeSelection: " << symbol << "(): temporarily concretizing arguments\n";
     ConcretizedRegionDescriptor crd;
 
+    // The arguments of the functions in m_symMemRegMap are known to be strings.
+    bool hasStringArgs = m_symMemRegMap.count(symbol);
+
     for (auto arg : decideArgv(symbol)) {
         uint64_t addr = reg().readConcrete(arg, /*verbose=*/false);
-        uint64_t size = getSymBlockLen(state, addr);
+        uint64_t size = hasStringArgs ? getSymStringLen(state, addr) : getSymBlockLen(state, addr);
 
         if (size) {
             log<DEBUG>()
                 << "Temporarily concretizing the region pointed to by "
                 << reg().getName(arg) << ", size = " << size << '\n';
 
-            // Save the current path constraints.
-            if (crd.exprs.empty()) {
-                crd.constraints = state->constraints();
-            }
-
             // Save the expression of this symbolic block.
             ref<Expr> e = mem().readSymbolic(addr, size * Expr::Int8);
 
-            // Temporarily concretize this symbolic block.
-            static_cast<void>(mem().readConcrete(addr, size, /*concretize=*/true));
+            // Temporarily concretize this symbolic block by overwriting it
+            // with its concolic values. Unlike readConcrete(concretize=true),
+            // this doesn't add any constraint to the state, so there's nothing
+            // to roll back in the path constraints when the function returns.
+            std::vector<uint8_t> bytes = mem().readConcrete(addr, size, /*concretize=*/false);
+            static_cast<void>(mem().writeConcrete(addr, bytes));
 
             crd.exprs.push_back(std::make_pair(addr, e));
         }
@@ -129,55 +193,29 @@ void CodeSelection::onFunctionReturn(S2EExecutionState *state,
         log<DEBUG>() << "Restoring symbolic expressions to: " << hexval(addr) << '\n';
         static_cast<void>(mem().writeSymbolic(addr, expr));
     }
-
-    // Forcibly restore path constraints to `state` (deep copy).
-    const_cast<ConstraintManager &>(state->constraints()) = crd.constraints;
 }
 
 
-bool CodeSelection::isCallingRegisteredLibraryFunction(uint64_t calleePc,
-                                                       std::string &symbolOut) const {
-    // TODO:
-    // 0000000000403dc0 <__lstat>:
-    // 403dc0:       f3 0f 1e fa             endbr64
-    // 403dc4:       48 89 f2                mov    rdx,rsi
-    // 403dc7:       48 89 fe                mov    rsi,rdi
-    // 403dca:       bf 01 00 00 00          mov    edi,0x1
-    // 403dcf:       e9 ec d4 ff ff          jmp    4012c0 <__lxstat@plt>
-    //
-    // >>> hex(elf.sym['lstat'])
-    // '0x403dc0'
-    // >>> hex(elf.plt['lstat'])
-    // Traceback (most recent call last):
-    // File "<stdin>", line 1, in <module>
-    // KeyError: 'lstat'
-    // >>> hex(elf.sym['__lxstat'])
-    // '0x4012c4'
-    // >>> hex(elf.plt['__lxstat'])
-    // '0x4012c4'
+bool CodeSelection::isCallingRegisteredLibraryFunction(S2EExecutionState *state,
+                                                       uint64_t calleePc,
+                                                       std::string &symbolOut) {
+    const ELF &elf = g_crax->getExploit().getElf();
+    uint64_t elfBase = g_crax->getElfBase(state);
 
-    Exploit &exploit = g_crax->getExploit();
-    const ELF &elf = exploit.getElf();
-    bool ret = false;
+    // The runtime addresses of a PIE are unknown until it's loaded.
+    if (elf.checksec.hasPIE && !elfBase) {
+        return false;
+    }
 
-    if (m_functions.size()) {
-        for (const auto &funcSym : m_functions) {
-            auto it = elf.symbols().find(funcSym);
-            if (it != elf.symbols().end() && it->second == calleePc) {
-                ret = true;
-                symbolOut = it->first;
-                break;
-            }
-        }
-    } else {
-        auto it = elf.inversePlt().find(calleePc);
-        if (it != elf.inversePlt().end()) {
-            ret = true;
-            symbolOut = it->second;
-        }
+    // Note that a statically linked wrapper may call into a different symbol,
+    // e.g., lstat() -> __lxstat@plt, so both may have to be monitored.
+    auto it = m_callees.find(calleePc - elfBase);
+    if (it == m_callees.end() || m_deniedFunctions.count(it->second)) {
+        return false;
     }
 
-    return ret;
+    symbolOut = it->second;
+    return true;
 }
 
 CodeSelection::Argv CodeSelection::decideArgv(const std::string &symbol) const {
@@ -200,10 +238,60 @@ CodeSelection::Argv CodeSelection::decideArgv(const std::string &symbol) const {
 uint64_t CodeSelection::getSymBlockLen(S2EExecutionState *state, uint64_t ptr) const {
     g_crax->setCurrentState(state);
 
+    // Most of the arguments don't point to symbolic memory at all.
+    if (!mem().isMapped(ptr) || !mem().isSymbolic(ptr, 1)) {
+        return 0;
+    }
+
+    // Memory is mapped page by page, so we only have to check
+    // if the next page is mapped when the block crosses into it.
+    uint64_t begin = ptr;
+
+    do {
+        ptr++;
+    } while ((ptr % TARGET_PAGE_SIZE || mem().isMapped(ptr)) && mem().isSymbolic(ptr, 1));
+
+    return ptr - begin;
+}
+
+uint64_t CodeSelection::getSymStringLen(S2EExecutionState *state, uint64_t ptr) const {
+    static constexpr uint64_t chunkSize = 64;
+
+    g_crax->setCurrentState(state);
+
+    // Look for the null byte in the concolic values chunk by chunk.
+    // A chunk never crosses a page, so whether the memory is mapped
+    // only has to be checked once per chunk.
     uint64_t len = 0;
-    for (; mem().isMapped(ptr) && mem().isSymbolic(ptr, 1); ptr++, len++) {}
 
-    return len;
+    while (len < s_maxStringLen && mem().isMapped(ptr + len)) {
+        uint64_t addr = ptr + len;
+        uint64_t n = std::min({ chunkSize,
+                                TARGET_PAGE_SIZE - addr % TARGET_PAGE_SIZE,
+                                s_maxStringLen - len });
+
+        std::vector<uint8_t> chunk = mem().readConcrete(addr, n, /*concretize=*/false);
+        auto it = std::find(chunk.begin(), chunk.end(), 0);
+        len += it - chunk.begin();
+
+        if (it != chunk.end()) {
+            len++;
+            break;
+        }
+    }
+
+    // Then check the string page by page, since Memory::isSymbolic()
+    // only works within a single page.
+    for (uint64_t i = 0; i < len; ) {
+        uint64_t addr = ptr + i;
+        uint64_t n = std::min(TARGET_PAGE_SIZE - addr % TARGET_PAGE_SIZE, len - i);
+
+        if (mem().isSymbolic(addr, n)) {
+            return len;
+        }
+        i += n;
+    }
+    return 0;
 }
 
 }  // namespace s2e::plugins::crax
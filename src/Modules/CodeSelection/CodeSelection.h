@@ -30,6 +30,8 @@
 #include <map>
 #include <stack>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <utility>
 
@@ -44,11 +46,11 @@ namespace s2e::plugins::crax {
 //     Control-Flow Hijacking Attacks (2011)
 
 class CodeSelection : public Module {
+    // The undo log of a call to an uninteresting function, i.e.,
+    // the symbolic blocks overwritten with their concolic values.
+    // Its size is proportional to the concretized bytes only.
     struct ConcretizedRegionDescriptor {
         llvm::SmallVector<std::pair<uint64_t, klee::ref<klee::Expr>>, 6> exprs;
-
-        // The path constraints before concretization.
-        klee::ConstraintManager constraints;
     };
 
 public:
@@ -93,11 +95,21 @@ private:
     // symbolic memory regions.
     //
     // Key: function name
-    // Value: which registers (arguments) may point to symbolic regions.
-    using Argv = llvm::SmallVector<Register::X64, 1>;
+    // Value: which registers (arguments) point to the strings read by it.
+    using Argv = llvm::SmallVector<Register::X64, 2>;
     using SymMemRegMap = std::map<std::string, Argv>;
     SymMemRegMap initSymMemRegMap();
 
+    // The functions which must never be code-selected, even if they're
+    // listed in the config or called via the PLT.
+    using FunctionSet = std::unordered_set<std::string>;
+    FunctionSet initDeniedFunctions();
+
+    // Collects the offsets of the monitored functions (or all the PLT entries,
+    // if none is specified) into m_callees. They're relative to the ELF base,
+    // which may differ between states (see CRAX::getElfBase()).
+    void buildCallees();
+
     void onFunctionCall(S2EExecutionState *state,
                         const ModuleDescriptorConstPtr &callerModule,
                         const ModuleDescriptorConstPtr &calleeModule,
@@ -110,16 +122,28 @@ private:
                           const ModuleDescriptorConstPtr &retTargetModule,
                           uint64_t retSite);
 
-    bool isCallingRegisteredLibraryFunction(uint64_t calleePc,
-                                            std::string &symbolOut) const;
+    bool isCallingRegisteredLibraryFunction(S2EExecutionState *state,
+                                            uint64_t calleePc,
+                                            std::string &symbolOut);
 
     Argv decideArgv(const std::string &symbol) const;
 
+    // Returns the length of the symbolic block at `ptr`, or 0.
     uint64_t getSymBlockLen(S2EExecutionState *state, uint64_t ptr) const;
 
+    // Returns the length of the string at `ptr` (including the null byte)
+    // if any of its bytes is symbolic, or 0.
+    uint64_t getSymStringLen(S2EExecutionState *state, uint64_t ptr) const;
+
+    static constexpr uint64_t s_maxStringLen = 4096;  // PATH_MAX
+
 
     std::vector<std::string> m_functions;
     SymMemRegMap m_symMemRegMap;
+    FunctionSet m_deniedFunctions;
+
+    // Key: offset within the ELF, value: function name
+    std::unordered_map<uint64_t, std::string> m_callees;
 };
 
 }  // namespace s2e::plugins::crax
@@ -0,0 +1,199 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/S2E.h>
+#include <s2e/S2EExecutor.h>
+#include <s2e/Plugins/CRAX/CRAX.h>
+#include <s2e/Plugins/CRAX/Modules/IOStates/IOStates.h>
+
+#include <algorithm>
+
+#include "CrashDirectedSearcher.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+CrashDirectedSearcher::CrashDirectedSearcher()
+    : Module(),
+      Searcher(),
+      m_linuxMonitor(g_s2e->getPlugin<LinuxMonitor>()),
+      m_queue(),
+      m_priorities() {
+    g_crax->beforeInstruction.connect(
+            sigc::mem_fun(*this, &CrashDirectedSearcher::beforeInstruction));
+
+    g_crax->afterSyscall.connect(
+            sigc::mem_fun(*this, &CrashDirectedSearcher::afterSyscall));
+
+    g_s2e->getExecutor()->setSearcher(this);
+}
+
+
+ExecutionState &CrashDirectedSearcher::selectState() {
+    assert(m_queue.size() && "CrashDirectedSearcher: no states to select!");
+    return *m_queue.rbegin()->second;
+}
+
+void CrashDirectedSearcher::update(ExecutionState *current,
+                                   const StateSet &addedStates,
+                                   const StateSet &removedStates) {
+    // The forked states inherit the module state (and hence the score)
+    // of the state they're forked from.
+    for (auto es : addedStates) {
+        reprioritize(static_cast<S2EExecutionState *>(es));
+    }
+
+    for (auto es : removedStates) {
+        auto state = static_cast<S2EExecutionState *>(es);
+        auto it = m_priorities.find(state);
+
+        if (it != m_priorities.end()) {
+            m_queue.erase(std::make_pair(it->second, state));
+            m_priorities.erase(it);
+        }
+    }
+}
+
+
+void CrashDirectedSearcher::beforeInstruction(S2EExecutionState *state,
+                                              const Instruction &i) {
+    CallStack::Op op = CallStack::getOp(i);
+
+    if (op == CallStack::Op::NONE || !isTargetProcess(state)) {
+        return;
+    }
+
+    auto modState = g_crax->getModuleState(state, this);
+    auto &callStack = modState->m_callStack;
+    uint64_t rsp = reg().readConcrete(Register::X64::RSP, /*verbose=*/false);
+
+    if (op == CallStack::Op::CALL) {
+        callStack.push(i, rsp);
+        return;
+    }
+
+    // Most overflows are done by a callee (e.g. read(), strcpy()),
+    // so check the frames near the top of the stack before they're gone.
+    int oldOverwrittenFrameIdx = modState->m_overwrittenFrameIdx;
+    scanSavedRipSlots(state, modState, s_maxScannedFramesOnRet);
+
+    callStack.pop(rsp);
+
+    if (modState->m_overwrittenFrameIdx >= static_cast<int>(callStack.size())) {
+        modState->m_overwrittenFrameIdx = -1;
+    }
+
+    if (modState->m_overwrittenFrameIdx != oldOverwrittenFrameIdx ||
+        modState->m_overwrittenFrameIdx != -1) {
+        reprioritize(state);
+    }
+}
+
+void CrashDirectedSearcher::afterSyscall(S2EExecutionState *state,
+                                         const SyscallCtx &syscall) {
+    if (!isTargetProcess(state)) {
+        return;
+    }
+
+    auto modState = g_crax->getModuleState(state, this);
+
+    scanSavedRipSlots(state, modState, modState->m_callStack.size());
+    scanGot(state, modState);
+
+    if (auto ioStates = CRAX::getModule<IOStates>()) {
+        modState->m_hasLeakedAllRequiredInfo = ioStates->hasLeakedAllRequiredInfo(state);
+    }
+
+    reprioritize(state);
+}
+
+
+void CrashDirectedSearcher::scanSavedRipSlots(S2EExecutionState *state,
+                                              State *modState,
+                                              size_t maxFrames) {
+    const CallStack &callStack = modState->m_callStack;
+    int begin = callStack.size() - std::min(maxFrames, callStack.size());
+
+    for (int idx = callStack.size() - 1; idx >= begin; idx--) {
+        if (mem(state).isSymbolic(callStack[idx].savedRipSlot, 8)) {
+            if (modState->m_overwrittenFrameIdx == -1 || idx < modState->m_overwrittenFrameIdx) {
+                modState->m_overwrittenFrameIdx = idx;
+            }
+        }
+    }
+}
+
+void CrashDirectedSearcher::scanGot(S2EExecutionState *state, State *modState) {
+    const ELF &elf = g_crax->getExploit().getElf();
+    uint64_t elfBase = g_crax->getElfBase(state);
+
+    if (modState->m_hasSymbolicGotEntry || (elf.checksec.hasPIE && !elfBase)) {
+        return;
+    }
+
+    for (const auto &[sym, offset] : elf.got()) {
+        if (mem(state).isSymbolic(elf.getRuntimeAddress(offset, elfBase), 8)) {
+            log<WARN>() << "CrashDirectedSearcher: GOT entry of " << sym << " is symbolic\n";
+            modState->m_hasSymbolicGotEntry = true;
+            break;
+        }
+    }
+}
+
+int64_t CrashDirectedSearcher::getScore(const State *modState) const {
+    int64_t score = 0;
+
+    if (modState->m_overwrittenFrameIdx != -1) {
+        // The number of `ret`s before the overwritten return address is popped.
+        int64_t distance = modState->m_callStack.size() - 1 - modState->m_overwrittenFrameIdx;
+        score += (1 << 20) - std::min<int64_t>(distance, 1 << 10);
+    }
+
+    if (modState->m_hasSymbolicGotEntry) {
+        score += 1 << 19;
+    }
+
+    if (modState->m_hasLeakedAllRequiredInfo) {
+        score += 1 << 18;
+    }
+    return score;
+}
+
+void CrashDirectedSearcher::reprioritize(S2EExecutionState *state) {
+    Priority priority(getScore(g_crax->getConstModuleState(state, this)), state->getID());
+    auto it = m_priorities.find(state);
+
+    if (it != m_priorities.end()) {
+        if (it->second == priority) {
+            return;
+        }
+        m_queue.erase(std::make_pair(it->second, state));
+    }
+
+    m_priorities[state] = priority;
+    m_queue.insert(std::make_pair(priority, state));
+}
+
+bool CrashDirectedSearcher::isTargetProcess(S2EExecutionState *state) const {
+    return m_linuxMonitor->getPid(state) == g_crax->getTargetProcessPid(state);
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,137 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_CRASH_DIRECTED_SEARCHER_H
+#define S2E_PLUGINS_CRAX_CRASH_DIRECTED_SEARCHER_H
+
+#include <klee/Searcher.h>
+#include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/API/CallStack.h>
+#include <s2e/Plugins/CRAX/API/Disassembler.h>
+#include <s2e/Plugins/CRAX/Modules/Module.h>
+#include <s2e/Plugins/OSMonitors/Linux/LinuxMonitor.h>
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace s2e::plugins::crax {
+
+// A state searcher which runs the states closest to a control-flow hijack first.
+//
+// Without it, CRAX relies on S2E's default searcher when native forking
+// is enabled, and simply waits for RIP to become symbolic. Here each state
+// is scored by:
+// 1. whether symbolic bytes have been written over a saved return address
+//    or a GOT entry of the target,
+// 2. how many frames have yet to return before the overwritten saved
+//    return address is popped, and
+// 3. whether all the IOStates leak targets have been leaked,
+// and the states with the highest scores are selected first. Among states
+// with the same score, the most recently forked one is selected (DFS).
+class CrashDirectedSearcher : public Module, public klee::Searcher {
+public:
+    class State : public ModuleState {
+        friend class CrashDirectedSearcher;
+
+    public:
+        State()
+            : ModuleState(),
+              m_callStack(),
+              m_overwrittenFrameIdx(-1),
+              m_hasSymbolicGotEntry(),
+              m_hasLeakedAllRequiredInfo() {}
+
+        virtual ~State() override = default;
+
+        static ModuleState *factory(Module *, CRAXState *) {
+            return new State();
+        }
+
+        virtual ModuleState *clone() const override {
+            return new State(*this);
+        }
+
+    private:
+        CallStack m_callStack;
+
+        // The index of the outermost frame whose saved return address
+        // has been overwritten with symbolic bytes, or -1.
+        int m_overwrittenFrameIdx;
+
+        bool m_hasSymbolicGotEntry;
+        bool m_hasLeakedAllRequiredInfo;
+    };
+
+
+    CrashDirectedSearcher();
+    virtual ~CrashDirectedSearcher() override = default;
+
+    virtual std::string toString() const override { return "CrashDirectedSearcher"; }
+
+    virtual klee::ExecutionState &selectState() override;
+
+    virtual void update(klee::ExecutionState *current,
+                        const klee::StateSet &addedStates,
+                        const klee::StateSet &removedStates) override;
+
+    virtual bool empty() override { return m_queue.empty(); }
+
+    virtual void printName(llvm::raw_ostream &os) override {
+        os << "CrashDirectedSearcher\n";
+    }
+
+private:
+    // (score, state ID), the greatest one is selected first.
+    using Priority = std::pair<int64_t, int>;
+
+    void beforeInstruction(S2EExecutionState *state, const Instruction &i);
+
+    void afterSyscall(S2EExecutionState *state, const SyscallCtx &syscall);
+
+    // Checks the saved return addresses of at most `maxFrames` innermost frames.
+    void scanSavedRipSlots(S2EExecutionState *state, State *modState, size_t maxFrames);
+
+    void scanGot(S2EExecutionState *state, State *modState);
+
+    [[nodiscard]]
+    int64_t getScore(const State *modState) const;
+
+    // Recomputes the score of `state` and requeues it.
+    void reprioritize(S2EExecutionState *state);
+
+
+    [[nodiscard]]
+    bool isTargetProcess(S2EExecutionState *state) const;
+
+
+    // The number of innermost frames checked upon each `ret`.
+    static constexpr size_t s_maxScannedFramesOnRet = 8;
+
+    LinuxMonitor *m_linuxMonitor;
+    std::set<std::pair<Priority, S2EExecutionState *>> m_queue;
+    std::unordered_map<S2EExecutionState *, Priority> m_priorities;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_CRASH_DIRECTED_SEARCHER_H
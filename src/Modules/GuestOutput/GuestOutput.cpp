@@ -18,8 +18,19 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include <s2e/S2E.h>
 #include <s2e/Plugins/CRAX/CRAX.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+
 #include "GuestOutput.h"
 
 #define SYS_WRITE  0x01
@@ -29,21 +40,54 @@ using namespace klee;
 
 namespace {
 
-struct iovec {
-    void *iov_base;  // starting address
-    size_t iov_len;  // number of bytes to transfer
+// struct iovec of the guest.
+struct GuestIovec {
+    uint64_t iov_base;  // starting address
+    uint64_t iov_len;   // number of bytes to transfer
 };
 
 }  // namespace
 
 namespace s2e::plugins::crax {
 
-GuestOutput::GuestOutput() : Module() {
+GuestOutput::GuestOutput()
+    : Module(),
+      m_perStateFiles(CRAX_CONFIG_GET_BOOL(".perStateFiles", false)),
+      m_stateFds(),
+      m_ringBuffer(),
+      m_nrPendingChunks(),
+      m_shouldStop(),
+      m_hasWriterFailed(),
+      m_writerErrno(),
+      m_writerFailedFd(-1),
+      m_hasReportedWriterFailure(),
+      m_writer() {
     g_crax->afterSyscall.connect(
             sigc::mem_fun(*this, &GuestOutput::onWrite));
 
     g_crax->afterSyscall.connect(
             sigc::mem_fun(*this, &GuestOutput::onWritev));
+
+    g_s2e->getCorePlugin()->onProcessFork.connect(
+            sigc::mem_fun(*this, &GuestOutput::onProcessFork));
+
+    if (m_perStateFiles) {
+        g_s2e->getCorePlugin()->onStateFork.connect(
+                sigc::mem_fun(*this, &GuestOutput::onStateFork));
+
+        g_s2e->getCorePlugin()->onStateKill.connect(
+                sigc::mem_fun(*this, &GuestOutput::onStateKill));
+    }
+
+    startWriter();
+}
+
+GuestOutput::~GuestOutput() {
+    stopWriter();
+
+    for (const auto &[id, fd] : m_stateFds) {
+        close(fd);
+    }
 }
 
 
@@ -54,10 +98,14 @@ void GuestOutput::onWrite(S2EExecutionState *state,
         return;
     }
 
+    if (static_cast<int64_t>(syscall.ret) <= 0) {
+        return;
+    }
+
     g_crax->setCurrentState(state);
 
     std::vector<uint8_t> bytes = mem().readConcrete(syscall.arg2, syscall.ret, /*concretize=*/false);
-    write(syscall.arg1, bytes.data(), bytes.size());
+    enqueue(state, syscall.arg1, std::move(bytes));
 }
 
 // ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
@@ -67,18 +115,246 @@ void GuestOutput::onWritev(S2EExecutionState *state,
         return;
     }
 
+    if (static_cast<int64_t>(syscall.ret) <= 0 || syscall.arg3 > IOV_MAX) {
+        return;
+    }
+
     g_crax->setCurrentState(state);
 
-    for (uint64_t i = 0; i < syscall.arg3; i++) {
-        uint64_t iovAddr = syscall.arg2 + i * sizeof(iovec);
-        std::vector<uint8_t> iovBytes = mem().readConcrete(iovAddr, sizeof(iovec));
+    // Read the whole iovec array at once, and gather the buffers
+    // into a single chunk, up to what the kernel has actually written.
+    std::vector<uint8_t> iovBytes = mem().readConcrete(syscall.arg2, syscall.arg3 * sizeof(GuestIovec));
+
+    if (iovBytes.size() != syscall.arg3 * sizeof(GuestIovec)) {
+        return;
+    }
 
-        iovec *iov = reinterpret_cast<iovec *>(iovBytes.data());
-        uint64_t addr = reinterpret_cast<uint64_t>(iov->iov_base);
+    auto iov = reinterpret_cast<const GuestIovec *>(iovBytes.data());
+    std::vector<uint8_t> bytes;
+    bytes.reserve(syscall.ret);
 
-        std::vector<uint8_t> bytes = mem().readConcrete(addr, iov->iov_len, /*concretize=*/false);
-        write(syscall.arg1, bytes.data(), bytes.size());
+    for (uint64_t i = 0; i < syscall.arg3 && bytes.size() < syscall.ret; i++) {
+        uint64_t len = std::min<uint64_t>(iov[i].iov_len, syscall.ret - bytes.size());
+        std::vector<uint8_t> buf = mem().readConcrete(iov[i].iov_base, len, /*concretize=*/false);
+        bytes.insert(bytes.end(), buf.begin(), buf.end());
     }
+
+    enqueue(state, syscall.arg1, std::move(bytes));
+}
+
+void GuestOutput::onStateFork(S2EExecutionState *state,
+                              const std::vector<S2EExecutionState *> &newStates,
+                              const std::vector<ref<Expr>> &newConditions) {
+    std::error_code ec;
+    std::string filename = getFilename(state);
+
+    if (!m_stateFds.count(state->getID())) {
+        return;  // nothing has been written yet
+    }
+
+    // The output of the forked states begins with that of `state`.
+    flush();
+
+    for (S2EExecutionState *newState : newStates) {
+        if (newState == state) {
+            continue;
+        }
+
+        std::filesystem::copy_file(filename, getFilename(newState),
+                                   std::filesystem::copy_options::overwrite_existing, ec);
+        if (ec) {
+            log<WARN>() << "Failed to copy " << filename << ": " << ec.message() << '\n';
+        }
+    }
+}
+
+void GuestOutput::onStateKill(S2EExecutionState *state) {
+    auto it = m_stateFds.find(state->getID());
+
+    if (it == m_stateFds.end()) {
+        return;
+    }
+
+    flush();
+    close(it->second);
+    m_stateFds.erase(it);
+}
+
+void GuestOutput::onProcessFork(bool preFork, bool isChild, unsigned parentProcId) {
+    // fork() only duplicates the calling thread, so stop the writer
+    // before fork(), and start one in both processes after it.
+    if (preFork) {
+        stopWriter();
+    } else {
+        startWriter();
+    }
+}
+
+
+void GuestOutput::enqueue(S2EExecutionState *state, int guestFd, std::vector<uint8_t> &&bytes) {
+    if (bytes.empty()) {
+        return;
+    }
+
+    if (m_hasWriterFailed) {
+        reportWriterFailure();
+        return;
+    }
+
+    Chunk chunk { getHostFd(state, guestFd), std::move(bytes) };
+
+    if (chunk.fd < 0) {
+        return;
+    }
+
+    // Only block if the writer falls behind by a whole ring buffer.
+    m_nrPendingChunks++;
+    while (!m_ringBuffer.tryPush(std::move(chunk))) {
+        if (m_hasWriterFailed) {
+            m_nrPendingChunks--;
+            reportWriterFailure();
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void GuestOutput::flush() {
+    while (m_nrPendingChunks && !m_hasWriterFailed) {
+        std::this_thread::yield();
+    }
+
+    if (m_hasWriterFailed) {
+        reportWriterFailure();
+    }
+}
+
+void GuestOutput::reportWriterFailure() {
+    if (m_hasReportedWriterFailure) {
+        return;
+    }
+
+    log<WARN>() << "GuestOutput: failed to write to fd " << m_writerFailedFd << ": "
+                << std::strerror(m_writerErrno) << ", dropping the output from now on.\n";
+    m_hasReportedWriterFailure = true;
+}
+
+void GuestOutput::startWriter() {
+    if (m_hasWriterFailed) {
+        return;
+    }
+
+    m_shouldStop = false;
+    m_writer = std::thread(&GuestOutput::drain, this);
+}
+
+void GuestOutput::stopWriter() {
+    if (!m_writer.joinable()) {
+        return;
+    }
+
+    m_shouldStop = true;
+    m_writer.join();
+}
+
+void GuestOutput::drain() {
+    constexpr size_t maxBatchSize = 64;
+    std::vector<Chunk> batch;
+    Chunk chunk;
+
+    batch.reserve(maxBatchSize);
+
+    while (true) {
+        while (batch.size() < maxBatchSize && m_ringBuffer.tryPop(chunk)) {
+            batch.push_back(std::move(chunk));
+        }
+
+        if (batch.empty()) {
+            // Everything queued before stopWriter() has been written.
+            if (m_shouldStop && m_ringBuffer.empty()) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        for (size_t i = 0; i < batch.size(); ) {
+            ssize_t next = writeChunks(batch, i);
+
+            if (next < 0) {
+                // Don't keep the S2E thread waiting in enqueue() or flush().
+                m_hasWriterFailed = true;
+                return;
+            }
+            i = next;
+        }
+
+        m_nrPendingChunks -= batch.size();
+        batch.clear();
+    }
+}
+
+ssize_t GuestOutput::writeChunks(const std::vector<Chunk> &batch, size_t begin) {
+    std::vector<iovec> iov;
+    size_t end = begin;
+
+    // Write the consecutive chunks of the same fd with a single writev().
+    for (; end < batch.size() && batch[end].fd == batch[begin].fd; end++) {
+        iov.push_back({ const_cast<uint8_t *>(batch[end].bytes.data()), batch[end].bytes.size() });
+    }
+
+    for (size_t k = 0; k < iov.size();) {
+        ssize_t n = writev(batch[begin].fd, &iov[k], std::min<size_t>(iov.size() - k, IOV_MAX));
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // drain() sets m_hasWriterFailed after these.
+            m_writerErrno = errno;
+            m_writerFailedFd = batch[begin].fd;
+            return -1;
+        }
+
+        // Skip whatever has been written.
+        for (; k < iov.size() && static_cast<size_t>(n) >= iov[k].iov_len; k++) {
+            n -= iov[k].iov_len;
+        }
+        if (k < iov.size()) {
+            iov[k].iov_base = static_cast<uint8_t *>(iov[k].iov_base) + n;
+            iov[k].iov_len -= n;
+        }
+    }
+    return end;
+}
+
+int GuestOutput::getHostFd(S2EExecutionState *state, int guestFd) {
+    if (!m_perStateFiles) {
+        return guestFd;
+    }
+
+    auto it = m_stateFds.find(state->getID());
+
+    if (it != m_stateFds.end()) {
+        return it->second;
+    }
+
+    std::string filename = getFilename(state);
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        log<WARN>() << "Failed to open " << filename << '\n';
+        return -1;
+    }
+
+    m_stateFds[state->getID()] = fd;
+    return fd;
+}
+
+std::string GuestOutput::getFilename(S2EExecutionState *state) {
+    // The state ids are only unique within an S2E process.
+    std::string id = ExploitGenerator::getArtifactId(state);
+    return ExploitGenerator::getArtifactDir(state) / ("output_" + id + ".txt");
 }
 
 }  // namespace s2e::plugins::crax
@@ -21,8 +21,17 @@
 #ifndef S2E_PLUGINS_CRAX_GUEST_OUTPUT_H
 #define S2E_PLUGINS_CRAX_GUEST_OUTPUT_H
 
+#include <klee/Expr.h>
 #include <s2e/S2EExecutionState.h>
 #include <s2e/Plugins/CRAX/Modules/Module.h>
+#include <s2e/Plugins/CRAX/Utils/SpscRingBuffer.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <unistd.h>
 
@@ -32,6 +41,22 @@ namespace s2e::plugins::crax {
 // will only contain the output of the proxy itself, not the output of
 // the target binary. This module hooks the write() and writev() syscalls
 // and prints the target binary's output to host's stdout/stderr.
+//
+// The syscall hooks only copy the output into a ring buffer, which is
+// drained by a background thread, so a chatty target doesn't stall
+// the emulation on host I/O.
+//
+// With `perStateFiles`, the output of each state goes to output_<id>.txt
+// (next to exploit_<id>.*) instead, and a forked state's file starts
+// with the output of its parent.
+//
+// If the host fails to write the output, the writer thread stops,
+// and the output is dropped from then on.
+//
+// Config:
+//   modulesConfig.GuestOutput = {
+//       perStateFiles = false,
+//   }
 
 class GuestOutput : public Module {
 public:
@@ -51,22 +76,78 @@ public:
 
 
     GuestOutput();
-    virtual ~GuestOutput() override = default;
+    virtual ~GuestOutput() override;
 
     virtual std::string toString() const override {
         return "GuestOutput";
     }
 
 private:
+    struct Chunk {
+        int fd = -1;
+        std::vector<uint8_t> bytes;
+    };
+
     void onWrite(S2EExecutionState *state,
                  const SyscallCtx &syscall);
 
     void onWritev(S2EExecutionState *state,
                   const SyscallCtx &syscall);
 
+    void onStateFork(S2EExecutionState *state,
+                     const std::vector<S2EExecutionState *> &newStates,
+                     const std::vector<klee::ref<klee::Expr>> &newConditions);
+
+    void onStateKill(S2EExecutionState *state);
+
+    void onProcessFork(bool preFork, bool isChild, unsigned parentProcId);
+
+    // Queues `bytes` written to `guestFd` by `state`.
+    void enqueue(S2EExecutionState *state, int guestFd, std::vector<uint8_t> &&bytes);
+
+    // Waits until everything queued so far has been written.
+    void flush();
+
+    // Logs why the writer has failed (only once). S2E's log streams
+    // aren't thread-safe, so the writer thread itself can't log.
+    void reportWriterFailure();
+
+    void startWriter();
+    void stopWriter();
+
+    // The body of the writer thread.
+    void drain();
+
+    // Writes the chunks of `batch` with the same fd as batch[begin],
+    // starting from batch[begin]. Returns the index of the next chunk,
+    // or -1 on failure.
+    [[nodiscard]]
+    ssize_t writeChunks(const std::vector<Chunk> &batch, size_t begin);
+
+    [[nodiscard]]
+    int getHostFd(S2EExecutionState *state, int guestFd);
+
+    [[nodiscard]]
+    static std::string getFilename(S2EExecutionState *state);
+
     inline bool isValidFd(int fd) {
         return fd == STDOUT_FILENO || fd == STDERR_FILENO;
     }
+
+
+    static constexpr size_t s_ringBufferSize = 1024;
+
+    const bool m_perStateFiles;
+    std::map<int, int> m_stateFds;  // state id -> host fd, only used by the S2E thread
+
+    SpscRingBuffer<Chunk, s_ringBufferSize> m_ringBuffer;
+    std::atomic<uint64_t> m_nrPendingChunks;  // queued but not yet written
+    std::atomic<bool> m_shouldStop;
+    std::atomic<bool> m_hasWriterFailed;
+    std::atomic<int> m_writerErrno;  // set before m_hasWriterFailed
+    std::atomic<int> m_writerFailedFd;
+    bool m_hasReportedWriterFailure;  // only used by the S2E thread
+    std::thread m_writer;
 };
 
 }  // namespace s2e::plugins::crax
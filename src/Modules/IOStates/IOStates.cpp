@@ -33,6 +33,9 @@
 #define SYS_READ 0
 #define SYS_WRITE 1
 #define SYS_NANOSLEEP 35
+#define SYS_CLOCK_NANOSLEEP 230
+
+#define TIMER_ABSTIME 1
 
 using namespace klee;
 
@@ -57,7 +60,8 @@ const std::array<std::string, IOStates::LeakType::LAST> IOStates::s_leakTypes =
 IOStates::IOStates()
     : Module(),
       m_leakTargets(),
-      m_canary(),
+      m_isForkingLeakOffsets(),
+      m_recordOutputBytes(),
       m_userSpecifiedCanary(CRAX_CONFIG_GET_INT(".canary", 0)),
       m_userSpecifiedElfBase(CRAX_CONFIG_GET_INT(".elfBase", 0)),
       m_userSpecifiedStateInfoList(initUserSpecifiedStateInfoList()) {
@@ -93,6 +97,9 @@ IOStates::IOStates()
 
         g_crax->onStateForkModuleDecide.connect(
                 sigc::mem_fun(*this, &IOStates::onStateForkModuleDecide));
+
+        g_s2e->getCorePlugin()->onProcessForkDecide.connect(
+                sigc::mem_fun(*this, &IOStates::onProcessForkDecide));
     }
 
     // Determine which base address(es) must be leaked
@@ -115,7 +122,7 @@ IOStates::IOStates()
 bool IOStates::checkRequirements() const {
     S2EExecutionState *state = g_crax->getCurrentState();
 
-    auto modState = g_crax->getModuleState(state, this);
+    auto modState = g_crax->getConstModuleState(state, this);
     modState->dump();
 
     if (hasLeakedAllRequiredInfo(state)) {
@@ -132,6 +139,10 @@ std::unique_ptr<CoreGenerator> IOStates::makeCoreGenerator() const {
     return std::make_unique<LeakBasedCoreGenerator>();
 }
 
+uint64_t IOStates::getCanary(S2EExecutionState *state) const {
+    return g_crax->getConstModuleState(state, this)->canary;
+}
+
 
 std::vector<IOStates::StateInfo> IOStates::initUserSpecifiedStateInfoList() {
     std::string str = CRAX_CONFIG_GET_STRING(".stateInfoList", "");
@@ -159,7 +170,7 @@ std::vector<IOStates::StateInfo> IOStates::initUserSpecifiedStateInfoList() {
                 break;
             }
             case 'o': {
-                OutputStateInfo stateInfo;
+                OutputStateInfo stateInfo {};
                 stateInfo.isInteresting = false;
                 if (s.size() > 1) {
                     stateInfo.bufIndex = std::stoull(s.substr(1));
@@ -190,7 +201,7 @@ void IOStates::inputStateHookTopHalf(S2EExecutionState *inputState,
     }
 
     g_crax->setCurrentState(inputState);
-    auto modState = g_crax->getModuleState(inputState, this);
+    auto modState = g_crax->getConstModuleState(inputState, this);
 
     auto bufInfo = analyzeLeak(inputState, syscall.arg2, syscall.arg3);
 
@@ -235,8 +246,12 @@ void IOStates::inputStateHookTopHalf(S2EExecutionState *inputState,
         return;
     }
 
-    // For each offset, fork a new state
+    // For each offset, fork a new state. With S2E's multi-process mode,
+    // these states will be spread across the worker processes once all of
+    // them have been forked (see onProcessForkDecide()).
     // XXX: Optimize this with a custom searcher (?)
+    m_isForkingLeakOffsets = true;
+
     for (uint64_t offset : bufInfo[currentLeakType]) {
         // If we're leaking the canary, then we need to overwrite
         // the least significant bit of the canary, so offset++.
@@ -259,6 +274,8 @@ void IOStates::inputStateHookTopHalf(S2EExecutionState *inputState,
         auto forkedModState = g_crax->getModuleState(forkedState, this);
         forkedModState->leakableOffset = offset;
     }
+
+    m_isForkingLeakOffsets = false;
 }
 
 void IOStates::inputStateHookBottomHalf(S2EExecutionState *inputState,
@@ -315,9 +332,23 @@ void IOStates::outputStateHook(S2EExecutionState *outputState,
         }
     }
 
-    OutputStateInfo stateInfo;
+    OutputStateInfo stateInfo {};
     stateInfo.isInteresting = false;
 
+    // Record how many bytes have been written, so that the exploit script
+    // can receive exactly this amount of bytes instead of relying on timeouts.
+    stateInfo.len = (static_cast<int64_t>(syscall.ret) > 0) ? syscall.ret : 0;
+
+    // If the target echoes our input, the length of this output may differ
+    // at exploitation time, so we also record its concrete trailing bytes
+    // which can be received with recvuntil() instead.
+    stateInfo.isInputDependent = mem().isSymbolic(syscall.arg2, stateInfo.len);
+    stateInfo.delim = getTrailingConcreteBytes(syscall.arg2, stateInfo.len);
+
+    if (m_recordOutputBytes) {
+        stateInfo.bytes = mem().readConcrete(syscall.arg2, stateInfo.len, /*concretize=*/false);
+    }
+
     if (outputStateInfoList.size() && !hasLeakedAllRequiredInfo(outputState)) {
         stateInfo.isInteresting = true;
         stateInfo.bufIndex = outputStateInfoList.front().bufIndex;
@@ -338,7 +369,14 @@ void IOStates::outputStateHook(S2EExecutionState *outputState,
 
 void IOStates::sleepStateHook(S2EExecutionState *sleepState,
                               const SyscallCtx &syscall) {
-    if (syscall.nr != SYS_NANOSLEEP) {
+    uint64_t rqtpAddr = 0;
+
+    if (syscall.nr == SYS_NANOSLEEP) {
+        rqtpAddr = syscall.arg1;
+    } else if (syscall.nr == SYS_CLOCK_NANOSLEEP && !(syscall.arg2 & TIMER_ABSTIME)) {
+        // Newer glibc implements nanosleep() with clock_nanosleep().
+        rqtpAddr = syscall.arg3;
+    } else {
         return;
     }
 
@@ -347,7 +385,7 @@ void IOStates::sleepStateHook(S2EExecutionState *sleepState,
     auto modState = g_crax->getModuleState(sleepState, this);
 
     std::vector<uint8_t> bytes
-        = mem().readConcrete(syscall.arg1, sizeof(__kernel_timespec));
+        = mem().readConcrete(rqtpAddr, sizeof(__kernel_timespec));
 
     auto rqtp = reinterpret_cast<__kernel_timespec *>(bytes.data());
 
@@ -358,32 +396,39 @@ void IOStates::sleepStateHook(S2EExecutionState *sleepState,
 
 void IOStates::maybeInterceptStackCanary(S2EExecutionState *state,
                                          const Instruction &i) {
-    static bool hasReachedMain = false;
+    // This runs before every instruction, so avoid cloning
+    // the module state unless there's something to write.
+    auto modState = g_crax->getConstModuleState(state, this);
 
     // If we've already intercepted the canary of the target ELF,
     // then we don't need to proceed anymore.
-    if (m_canary) {
+    if (modState->canary) {
         return;
     }
 
-    if (i.address == g_crax->getExploit().getElf().getRuntimeAddress("main")) {
-        hasReachedMain = true;
+    const ELF &elf = g_crax->getExploit().getElf();
+
+    if (!modState->hasReachedMain &&
+        i.address == elf.getRuntimeAddress("main", g_crax->getElfBase(state))) {
+        g_crax->getModuleState(state, this)->hasReachedMain = true;
+        modState = g_crax->getConstModuleState(state, this);
     }
 
-    if (hasReachedMain &&
+    if (modState->hasReachedMain &&
         i.mnemonic == "mov" && i.opStr == "rax, qword ptr fs:[0x28]") {
-        m_canary = reg().readConcrete(Register::X64::RAX);
+        uint64_t canary = reg().readConcrete(Register::X64::RAX);
+        g_crax->getModuleState(state, this)->canary = canary;
 
         log<WARN>()
             << '[' << hexval(i.address) << "] "
-            << "Intercepted canary: " << hexval(m_canary) << '\n';
+            << "Intercepted canary: " << hexval(canary) << '\n';
     }
 }
 
 void IOStates::onStackChkFailed(S2EExecutionState *state,
                                 const Instruction &i) {
-    const uint64_t stackChkFailPlt
-        = g_crax->getExploit().getElf().getRuntimeAddress("__stack_chk_fail");
+    const uint64_t stackChkFailPlt = g_crax->getExploit().getElf().getRuntimeAddress(
+            "__stack_chk_fail", g_crax->getElfBase(state));
 
     if (i.address == stackChkFailPlt) {
         // The program has reached __stack_chk_fail and
@@ -420,7 +465,7 @@ void IOStates::onStateForkModuleDecide(S2EExecutionState *state,
     const ELF &elf = exploit.getElf();
 
     // Look ahead the next instruction.
-    if (!elf.isCallSiteOf(*i2, "__stack_chk_fail")) {
+    if (!elf.isCallSiteOf(*i2, "__stack_chk_fail", g_crax->getElfBase(state))) {
         allowForking = false;
         return;
     }
@@ -443,6 +488,15 @@ void IOStates::onStateForkModuleDecide(S2EExecutionState *state,
     }
 }
 
+void IOStates::onProcessForkDecide(bool *proceed) {
+    // Defer the process fork until the states of all the leakable offsets
+    // of the current input state have been forked, so that S2E can shard
+    // them across the worker processes.
+    if (m_isForkingLeakOffsets) {
+        *proceed = false;
+    }
+}
+
 void IOStates::beforeExploitGeneration(S2EExecutionState *state) {
     auto modState = g_crax->getModuleState(state, this);
 
@@ -462,12 +516,13 @@ std::array<std::vector<uint64_t>, IOStates::LeakType::LAST>
 IOStates::analyzeLeak(S2EExecutionState *inputState, uint64_t buf, uint64_t len) {
     const auto &vmmap = mem(inputState).vmmap();
     std::array<std::vector<uint64_t>, IOStates::LeakType::LAST> bufInfo;
+    uint64_t canary = getCanary(inputState);
 
     for (uint64_t i = 0; i < len; i += 8) {
         uint64_t value = u64(mem().readConcrete(buf + i, 8, /*concretize=*/false));
         //log<WARN>() << "addr = " << hexval(buf + i) << " value = " << hexval(value) << '\n';
 
-        if (g_crax->getExploit().getElf().checksec.hasCanary && value == m_canary) {
+        if (g_crax->getExploit().getElf().checksec.hasCanary && value == canary) {
             bufInfo[LeakType::CANARY].push_back(i);
         } else {
             foreach2 (it, vmmap.begin(), vmmap.end()) {
@@ -485,6 +540,7 @@ std::vector<IOStates::OutputStateInfo>
 IOStates::detectLeak(S2EExecutionState *outputState, uint64_t buf, uint64_t len) {
     const auto &vmmap = mem(outputState).vmmap();
     std::vector<IOStates::OutputStateInfo> leakInfo;
+    uint64_t canary = getCanary(outputState);
 
     IOStates::OutputStateInfo info;
     info.isInteresting = true;
@@ -494,7 +550,7 @@ IOStates::detectLeak(S2EExecutionState *outputState, uint64_t buf, uint64_t len)
         uint64_t value = u64(mem().readConcrete(buf + i, n, /*concretize=*/false));
         //log<WARN>() << "addr = " << hexval(buf + i) << " value = " << hexval(value) << '\n';
 
-        if (g_crax->getExploit().getElf().checksec.hasCanary && (value & ~0xff) == m_canary) {
+        if (g_crax->getExploit().getElf().checksec.hasCanary && (value & ~0xff) == canary) {
             info.bufIndex = i + 1;
             info.baseOffset = 0;
             info.leakType = LeakType::CANARY;
@@ -515,8 +571,18 @@ IOStates::detectLeak(S2EExecutionState *outputState, uint64_t buf, uint64_t len)
     return leakInfo;
 }
 
+std::vector<uint8_t> IOStates::getTrailingConcreteBytes(uint64_t buf, uint64_t len) const {
+    static constexpr uint64_t maxDelimLen = 8;
+    uint64_t n = 0;
+
+    while (n < std::min(len, maxDelimLen) && !mem().isSymbolic(buf + len - n - 1, 1)) {
+        n++;
+    }
+    return n ? mem().readConcrete(buf + len - n, n, /*concretize=*/false) : std::vector<uint8_t> {};
+}
+
 bool IOStates::hasLeakedAllRequiredInfo(S2EExecutionState *state) const {
-    auto modState = g_crax->getModuleState(state, this);
+    auto modState = g_crax->getConstModuleState(state, this);
     return modState->currentLeakTargetIdx >= m_leakTargets.size();
 }
 
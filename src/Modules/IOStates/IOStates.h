@@ -64,6 +64,10 @@ public:
         uint64_t bufIndex;
         uint64_t baseOffset;
         LeakType leakType;
+        uint64_t len;  // the number of bytes actually written by sys_write()
+        bool isInputDependent;  // the written bytes contain symbolic data
+        std::vector<uint8_t> delim;  // the concrete trailing bytes of the written data
+        std::vector<uint8_t> bytes;  // the written data, see setRecordOutputBytes()
     };
 
     struct SleepStateInfo {
@@ -81,6 +85,8 @@ public:
               lastInputStateInfoIdx(),
               lastInputStateInfoIdxBeforeFirstSymbolicRip(-1),
               currentLeakTargetIdx(),
+              canary(),
+              hasReachedMain(),
               stateInfoList() {}
 
         virtual ~State() override = default;
@@ -102,6 +108,12 @@ public:
         uint32_t lastInputStateInfoIdx;
         uint32_t lastInputStateInfoIdxBeforeFirstSymbolicRip;
         uint32_t currentLeakTargetIdx;
+
+        // The canary is intercepted per path rather than per plugin instance,
+        // since S2E may run the paths in different processes.
+        uint64_t canary;
+        bool hasReachedMain;
+
         std::vector<StateInfo> stateInfoList;
     };
 
@@ -113,7 +125,8 @@ public:
     virtual std::unique_ptr<CoreGenerator> makeCoreGenerator() const override;
     virtual std::string toString() const override { return "IOStates"; }
 
-    uint64_t getCanary() const { return m_canary; }
+    uint64_t getCanary(S2EExecutionState *state) const;
+    bool hasLeakedAllRequiredInfo(S2EExecutionState *state) const;
     uint64_t getUserSpecifiedCanary() const { return m_userSpecifiedCanary; }
     uint64_t getUserSpecifiedElfBase() const { return m_userSpecifiedElfBase; }
 
@@ -121,6 +134,13 @@ public:
         return m_leakTargets;
     }
 
+    // Whether to keep the data written at each output state (with the
+    // concolic values of symbolic bytes). Only StateSnapshot needs it,
+    // so it's off by default to keep the per-state memory small.
+    void setRecordOutputBytes(bool recordOutputBytes) {
+        m_recordOutputBytes = recordOutputBytes;
+    }
+
     static std::string toString(LeakType leakType) {
         return s_leakTypes[leakType];
     }
@@ -152,6 +172,8 @@ private:
                                  const klee::ref<klee::Expr> &__condition,
                                  bool &allowForking);
 
+    void onProcessForkDecide(bool *proceed);
+
     void beforeExploitGeneration(S2EExecutionState *state);
 
 
@@ -163,16 +185,21 @@ private:
     std::vector<IOStates::OutputStateInfo>
     detectLeak(S2EExecutionState *outputState, uint64_t buf, uint64_t len);
 
-    bool hasLeakedAllRequiredInfo(S2EExecutionState *state) const;
-
     LeakType getLeakType(const std::string &image) const;
 
+    // Returns up to 8 concrete bytes at the end of [buf, buf + len).
+    std::vector<uint8_t> getTrailingConcreteBytes(uint64_t buf, uint64_t len) const;
+
 
     // The targets that must be leaked according to checksec.
     std::vector<LeakType> m_leakTargets;
 
-    // Intercepted canary (guest).
-    uint64_t m_canary;
+    // True while forking a state for each leakable offset of an input state.
+    // S2E must not fork the process in the meantime, or both processes
+    // would go on to fork the remaining offsets.
+    bool m_isForkingLeakOffsets;
+
+    bool m_recordOutputBytes;
 
     // User-specified canary and ELF base (host).
     uint64_t m_userSpecifiedCanary;
@@ -19,13 +19,13 @@
 // SOFTWARE.
 
 #include <s2e/Plugins/CRAX/CRAX.h>
-#include <s2e/Plugins/CRAX/Expr/BinaryExprEval.h>
 #include <s2e/Plugins/CRAX/Modules/IOStates/IOStates.h>
 #include <s2e/Plugins/CRAX/Modules/IOStates/PseudoInputStream.h>
 #include <s2e/Plugins/CRAX/Utils/StringUtil.h>
 
 #include "LeakBasedCoreGenerator.h"
 
+#include <algorithm>
 #include <variant>
 #include <utility>
 
@@ -48,7 +48,11 @@ struct IOStateInfoVisitor {
     void operator()(const SleepStateInfo &stateInfo);
 
     bool shouldSkipInputState() const;
+    bool shouldDeferOutputState() const;
     void handleStage1(const InputStateInfo &stateInfo);
+    void handleOutputState(const OutputStateInfo &stateInfo, bool isDeferred);
+    void handleDeferredOutputStates();
+    void writeRecv(const OutputStateInfo &stateInfo, uint64_t offset, bool isDeferred);
 
     // Extra parameters
     LeakBasedCoreGenerator &coreGenerator;
@@ -75,24 +79,22 @@ void IOStateInfoVisitor::operator()(const InputStateInfo &stateInfo) {
     // If all required information have already been leaked, then we should
     // just skip these extra I/O states (especially the input states).
     if (shouldSkipInputState()) {
-        exploit.writeline(format("# input state (offset = %d), skipped", stateInfo.offset));
+        exploit.writeComment(format("input state (offset = %d), skipped", stateInfo.offset));
         inputStream.skip(stateInfo.offset);
         return;
     }
 
-    exploit.writeline(format("# input state (offset = %d)", stateInfo.offset));
+    exploit.writeComment(format("input state (offset = %d)", stateInfo.offset));
 
     if (i != modState.lastInputStateInfoIdx) {
         llvm::ArrayRef<uint8_t> bytes = inputStream.read(stateInfo.offset);
-        std::string byteString = toByteString(bytes.begin(), bytes.end());
-
-        exploit.writeline(format("proc.send(%s)", byteString.c_str()));
+        exploit.writeSend(std::vector<uint8_t>(bytes.begin(), bytes.end()));
         return;
     }
 
-    exploit.writeline("# input state (ROP payload begins)");
+    exploit.writeComment("input state (ROP payload begins)");
     handleStage1(stateInfo);
-    exploit.writeline("proc.recvrepeat(0)\n");
+    handleDeferredOutputStates();
     coreGenerator.handleStage2(ropPayload);
 }
 
@@ -107,81 +109,137 @@ bool IOStateInfoVisitor::shouldSkipInputState() const {
            i >= modState.lastInputStateInfoIdxBeforeFirstSymbolicRip;
 }
 
+bool IOStateInfoVisitor::shouldDeferOutputState() const {
+    // The input states starting from `lastInputStateInfoIdxBeforeFirstSymbolicRip`
+    // are all sent at once as stage 1, so whatever the target program writes
+    // after that can only be received after stage 1 has been sent.
+    return i > modState.lastInputStateInfoIdxBeforeFirstSymbolicRip;
+}
+
 void IOStateInfoVisitor::handleStage1(const InputStateInfo &stateInfo) {
     uint64_t nrBytesRead = inputStream.getNrBytesRead();
     uint64_t nrBytesSkipped = inputStream.getNrBytesSkipped();
 
-    std::string s;
+    // Only the bytes within [nrBytesRead, nrBytesRead + nrBytesSkipped) are sent.
+    uint64_t begin = nrBytesRead;
+    uint64_t end = nrBytesSkipped ? nrBytesRead + nrBytesSkipped : 0;
 
     // Let's deal with the simplest case first (no canary and no PIE).
     if (!elf.checksec.hasCanary && !elf.checksec.hasPIE) {
         llvm::ArrayRef<uint8_t> bytes = inputStream.read(nrBytesSkipped + stateInfo.offset);
-        s += evaluate<std::string>(ByteVectorExpr::create(bytes));
+        exploit.writeStage1(std::vector<uint8_t>(bytes.begin(), bytes.end()), begin, end);
     } else {
         // If either canary or PIE is enabled, stage1 needs to be solved
         // on the fly at exploitation time.
-        s += format("solve_stage1(canary, %s_base, '%s')", elf.getVarPrefix().c_str(),
-                                                           modState.toString().c_str());
+        exploit.writeStage1SolvedAtExploitTime(modState.toString(), begin, end);
     }
 
-    if (nrBytesRead || nrBytesSkipped) {
-        s += '[';
-        s += nrBytesRead ? std::to_string(nrBytesRead) : "";
-        s += ':';
-        s += nrBytesSkipped ? std::to_string(nrBytesRead + nrBytesSkipped) : "";
-        s += ']';
+    exploit.writeSendStage1(exploit.isRopPayloadLineTerminated());
+    exploit.writeBlankLine();
+}
+
+void IOStateInfoVisitor::operator()(const OutputStateInfo &stateInfo) {
+    if (shouldDeferOutputState()) {
+        exploit.writeComment("output state, deferred until stage 1 is sent");
+        return;
     }
 
-    exploit.appendRopPayload(s);
-    exploit.flushRopPayload();
+    handleOutputState(stateInfo, /*isDeferred=*/false);
 }
 
-void IOStateInfoVisitor::operator()(const OutputStateInfo &stateInfo) {
-    exploit.writeline("# output state");
+void IOStateInfoVisitor::handleOutputState(const OutputStateInfo &stateInfo, bool isDeferred) {
+    exploit.writeComment("output state");
 
     // This output state cannot leak anything.
     if (!stateInfo.isInteresting) {
-        exploit.writeline("proc.recvrepeat(0.1)");
+        writeRecv(stateInfo, 0, isDeferred);
         return;
     }
 
-    exploit.writeline("# leaking: " + IOStates::toString(stateInfo.leakType));
-    exploit.writeline(format("proc.recv(%d)", stateInfo.bufIndex));
+    // The leaked data must be located at `bufIndex` at exploitation time,
+    // so the bytes before it are always received exactly.
+    exploit.writeComment("leaking: " + IOStates::toString(stateInfo.leakType));
+    exploit.writeRecv(stateInfo.bufIndex);
+
+    uint64_t nrBytesReceived = stateInfo.bufIndex;
 
     // XXX: Add support for leaking libc via IOStates
     if (stateInfo.leakType == IOStates::LeakType::CANARY) {
-        exploit.writeLeakCanary();
+        nrBytesReceived += exploit.writeLeakCanary();
     } else {
-        exploit.writeLeakElfBase(stateInfo.baseOffset);
+        nrBytesReceived += exploit.writeLeakElfBase(stateInfo.baseOffset);
     }
 
     // We still need to receive whatever that comes after
     // the canary or the address.
-    exploit.writeline("proc.recvrepeat(0.1)");
+    writeRecv(stateInfo, nrBytesReceived, isDeferred);
+}
+
+void IOStateInfoVisitor::handleDeferredOutputStates() {
+    const auto &stateInfoList = modState.stateInfoList;
+
+    for (size_t j = modState.lastInputStateInfoIdxBeforeFirstSymbolicRip + 1;
+         j < stateInfoList.size();
+         j++) {
+        if (const auto stateInfo = std::get_if<OutputStateInfo>(&stateInfoList[j])) {
+            exploit.writeBlankLine();
+            handleOutputState(*stateInfo, /*isDeferred=*/true);
+        }
+    }
+
+    exploit.writeBlankLine();
+}
+
+void IOStateInfoVisitor::writeRecv(const OutputStateInfo &stateInfo,
+                                   uint64_t offset,
+                                   bool isDeferred) {
+    if (stateInfo.len <= offset) {
+        return;
+    }
+
+    uint64_t len = stateInfo.len - offset;
+
+    // The length recorded in the PoC run only holds if the output
+    // neither echoes our input nor comes after stage 1 (which differs
+    // from the PoC at exploitation time).
+    if (!isDeferred && !stateInfo.isInputDependent) {
+        exploit.writeRecv(len);
+        return;
+    }
+
+    // Otherwise, receive until its concrete trailing bytes if there are any,
+    // or fall back to a bounded receive.
+    const std::vector<uint8_t> &delim = stateInfo.delim;
+    if (delim.empty()) {
+        exploit.writeRecvAtMost(len);
+    } else if (delim.size() > len) {
+        exploit.writeRecvUntil(std::vector<uint8_t>(delim.end() - len, delim.end()));
+    } else {
+        exploit.writeRecvUntil(delim);
+    }
 }
 
 void IOStateInfoVisitor::operator()(const SleepStateInfo &stateInfo) {
-    exploit.writeline("# sleep state");
-    exploit.writeline(format("sleep(%d)", stateInfo.sec));
+    exploit.writeComment("sleep state");
+    exploit.writeSleep(stateInfo.sec);
 }
 
 
 void LeakBasedCoreGenerator::generateMainFunction(S2EExecutionState *state,
                                                   const std::vector<RopPayload> &ropPayload) {
     Exploit &exploit = g_crax->getExploit();
-    Process &process = exploit.getProcess();
 
     auto iostates = CRAX::getModule<IOStates>();
     assert(iostates);
 
-    auto modState = g_crax->getModuleState(state, iostates);
+    auto modState = g_crax->getConstModuleState(state, iostates);
     assert(modState);
 
     PseudoInputStream inputStream(RopPayloadBuilder::getStage1Payload(ropPayload));
-    exploit.writeline(process.toDeclStmt());
+    exploit.writeSpawn();
 
     for (size_t i = 0; i < modState->stateInfoList.size(); i++) {
-        exploit.writeline();
+        exploit.writeBlankLine();
 
         auto v = IOStateInfoVisitor{
             *this, exploit, exploit.getElf(), ropPayload, inputStream, *modState, i
@@ -0,0 +1,185 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <s2e/S2E.h>
+#include <s2e/Plugins/CRAX/CRAX.h>
+#include <s2e/Plugins/CRAX/Utils/StringUtil.h>
+
+#include <klee/util/ExprUtil.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "InputTaint.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+InputTaint::InputTaint()
+    : Module(),
+      m_regions(CRAX_CONFIG_GET_STRING_LIST(".regions")),
+      m_taintOnly(CRAX_CONFIG_GET_BOOL(".taintOnly", true)) {
+    if (m_regions.empty()) {
+        m_regions.push_back(VirtualMemoryMap::s_stackLabel);
+    }
+
+    // Without forks, the path constraints are never solved.
+    if (m_taintOnly) {
+        g_crax->setConcolicMode(true);
+    }
+
+    g_crax->beforeExploitGeneration.connect(
+            sigc::mem_fun(*this, &InputTaint::beforeExploitGeneration));
+}
+
+
+void InputTaint::beforeExploitGeneration(S2EExecutionState *state) {
+    writeRanges(state);
+
+    // Solving for the exploits is left to pass 2.
+    if (m_taintOnly) {
+        g_s2e->getExecutor()->terminateState(*state, "End of taint pass");
+    }
+}
+
+void InputTaint::writeRanges(S2EExecutionState *state) const {
+    std::string filename = ExploitGenerator::getArtifactDir(state) / getFilename();
+
+    InputRanges ranges = toRanges(collectOffsets(state));
+
+    if (ranges.empty()) {
+        log<WARN>() << "No input byte reaches the crash, " << filename << " not written.\n";
+        return;
+    }
+
+    // In multi-process mode, the states of a PoC may run in different
+    // processes, so append all the ranges with a single write.
+    std::ofstream ofs(filename, std::ios::app);
+
+    if (!ofs) {
+        log<WARN>() << "Failed to open " << filename << '\n';
+        return;
+    }
+
+    std::string content;
+    uint64_t nrBytes = 0;
+    for (const auto &[begin, end] : ranges) {
+        content += format("0x%llx 0x%llx\n", begin, end);
+        nrBytes += end - begin;
+    }
+    ofs.write(content.data(), content.size());
+    ofs.flush();
+
+    log<WARN>() << "Appended the symbolic ranges (" << nrBytes << " bytes) to " << filename << '\n';
+}
+
+void InputTaint::collectOffsets(S2EExecutionState *state,
+                                const ref<Expr> &e,
+                                std::set<uint64_t> &offsets) const {
+    if (!e || isa<ConstantExpr>(e)) {
+        return;
+    }
+
+    // In pass 2, the array only spans the symbolic window,
+    // so the offsets have to be shifted back.
+    uint64_t windowBegin = g_crax->getSymWindowBegin(state);
+    std::vector<ref<ReadExpr>> reads;
+    findReads(e, /*visitUpdates=*/true, reads);
+
+    for (const auto &re : reads) {
+        const std::string &name = re->getUpdates()->getRoot()->getName();
+        if (!Memory::isInputArrayName(name)) {
+            continue;
+        }
+
+        // A symbolic index may read any byte of the array,
+        // but that is already pinned down by the path constraints.
+        auto ce = dyn_cast<ConstantExpr>(re->getIndex());
+        if (!ce) {
+            continue;
+        }
+
+        // sym_file --lazy names each page of the input by its offset.
+        auto pageOffset = Memory::getInputFilePageOffset(name);
+        offsets.insert(pageOffset.value_or(windowBegin) + ce->getZExtValue());
+    }
+}
+
+std::set<uint64_t> InputTaint::collectOffsets(S2EExecutionState *state) const {
+    std::set<uint64_t> ret;
+
+    for (int i = 0; i <= Register::X64::RIP; i++) {
+        auto r = static_cast<Register::X64>(i);
+        if (r == Register::X64::LAST) {
+            continue;
+        }
+        collectOffsets(state, reg(state).readSymbolic(r, Expr::Int64, /*verbose=*/false), ret);
+    }
+
+    const auto &vmmap = mem(state).vmmap();
+
+    foreach2 (it, vmmap.begin(), vmmap.end()) {
+        RegionDescriptorPtr region = *it;
+
+        if (std::find(m_regions.begin(), m_regions.end(), region->moduleName) == m_regions.end()) {
+            continue;
+        }
+
+        // Skip concrete pages as a whole, since most of them are.
+        for (uint64_t page = it.start(); page <= it.stop(); page += TARGET_PAGE_SIZE) {
+            if (!mem(state).isSymbolic(page, TARGET_PAGE_SIZE)) {
+                continue;
+            }
+
+            for (uint64_t addr = page; addr < page + TARGET_PAGE_SIZE; addr++) {
+                if (mem(state).isSymbolic(addr, 1)) {
+                    collectOffsets(state, mem(state).readSymbolic(addr, Expr::Int8), ret);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+InputTaint::InputRanges InputTaint::toRanges(const std::set<uint64_t> &offsets) {
+    InputRanges ret;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+
+    for (uint64_t offset : offsets) {
+        if (offset != end) {
+            if (end > begin) {
+                ret[begin] = end;
+            }
+            begin = offset;
+        }
+        end = offset + 1;
+    }
+
+    if (end > begin) {
+        ret[begin] = end;
+    }
+    return ret;
+}
+
+}  // namespace s2e::plugins::crax
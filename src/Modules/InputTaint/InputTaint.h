@@ -0,0 +1,104 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef S2E_PLUGINS_CRAX_INPUT_TAINT_H
+#define S2E_PLUGINS_CRAX_INPUT_TAINT_H
+
+#include <klee/Expr.h>
+#include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/Modules/Module.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace s2e::plugins::crax {
+
+// Symbolizing the whole PoC makes every byte of it flow through KLEE,
+// even though only a few of them reach the saved RIP and the area where
+// the ROP payload goes. This module finds out which input bytes those are,
+// so that the next run can symbolize only them (selective symbolization).
+//
+// Pass 1 is a taint pass: load this module alone with concolicMode = true.
+// The input labels each symbolic byte with its offset (the ReadExprs of the
+// input array), so no fork is made and the solver is never queried. When RIP
+// becomes symbolic, the offsets of the input bytes which the symbolic
+// registers and the symbolic memory in `regions` depend on are appended as
+// merged, half-open ranges to `symranges` (next to the exploits, i.e.,
+// <PoC name>/symranges in batch mode), and the state is killed instead of
+// generating exploits:
+//
+//   0x48 0x58
+//   0x60 0xa0
+//
+// Pass 2: pass that file to the proxy via `--sym-ranges` without this module.
+// The proxy then only symbolizes the bytes spanned by these ranges, and tells
+// CRAX where they are in the whole input (CRAX_SYM_WINDOW), so that the
+// exploits still contain the whole input. See proxies/README.md.
+//
+// Only the [stack] is scanned by default, since the stdio buffers
+// on the heap hold a symbolic copy of the entire input anyway.
+//
+// Config:
+//   modulesConfig.InputTaint = {
+//       regions = { "[stack]" },
+//       taintOnly = true,  -- false: generate exploits in pass 1 as well
+//   }
+
+class InputTaint : public Module {
+public:
+    InputTaint();
+    virtual ~InputTaint() override = default;
+
+    virtual std::string toString() const override { return "InputTaint"; }
+
+    // All the states of a PoC append to the same file, so the proxy
+    // symbolizes every byte which reaches any of the crashes.
+    [[nodiscard]]
+    static std::string getFilename() { return "symranges"; }
+
+private:
+    using InputRanges = std::map<uint64_t, uint64_t>;  // begin -> end
+
+    void beforeExploitGeneration(S2EExecutionState *state);
+
+    void writeRanges(S2EExecutionState *state) const;
+
+    // Adds the offsets of the input bytes `e` depends on to `offsets`.
+    void collectOffsets(S2EExecutionState *state,
+                        const klee::ref<klee::Expr> &e,
+                        std::set<uint64_t> &offsets) const;
+
+    [[nodiscard]]
+    std::set<uint64_t> collectOffsets(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    static InputRanges toRanges(const std::set<uint64_t> &offsets);
+
+
+    std::vector<std::string> m_regions;
+    bool m_taintOnly;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_INPUT_TAINT_H
@@ -0,0 +1,341 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <s2e/S2E.h>
+#include <s2e/Plugins/CRAX/CRAX.h>
+#include <s2e/Plugins/CRAX/Pwnlib/Util.h>
+
+#include <algorithm>
+
+#include "LibcSummaries.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+static uint64_t getBytesUntilPageEnd(uint64_t addr) {
+    return TARGET_PAGE_SIZE - addr % TARGET_PAGE_SIZE;
+}
+
+
+LibcSummaries::LibcSummaries()
+    : Module(),
+      m_summaries(),
+      m_maxLength(CRAX_CONFIG_GET_INT(".maxLength", 0x1000)),
+      m_callees() {
+    auto functionMonitor = g_s2e->getPlugin<FunctionMonitor>();
+
+    if (!functionMonitor) {
+        log<WARN>() << "LibcSummaries requires S2E's FunctionMonitor plugin.\n";
+        exit(1);
+    }
+
+    SummaryMap supported = initSummaryMap();
+    std::vector<std::string> functions = CRAX_CONFIG_GET_STRING_LIST(".functions");
+
+    if (functions.empty()) {
+        m_summaries = supported;
+    }
+
+    for (const auto &function : functions) {
+        auto it = supported.find(function);
+
+        if (it == supported.end()) {
+            log<WARN>() << "LibcSummaries: no summary for " << function << "(), ignored.\n";
+            continue;
+        }
+        m_summaries.insert(*it);
+    }
+
+    buildCallees();
+
+    functionMonitor->onCall.connect(
+            sigc::mem_fun(*this, &LibcSummaries::onFunctionCall));
+}
+
+
+LibcSummaries::SummaryMap LibcSummaries::initSummaryMap() {
+    return {
+        { "memcpy",  &LibcSummaries::summarizeMemcpy },
+        { "memmove", &LibcSummaries::summarizeMemcpy },
+        { "memset",  &LibcSummaries::summarizeMemset },
+        { "strcmp",  &LibcSummaries::summarizeStrcmp },
+        { "strcpy",  &LibcSummaries::summarizeStrcpy },
+        { "strlen",  &LibcSummaries::summarizeStrlen },
+    };
+}
+
+void LibcSummaries::onFunctionCall(S2EExecutionState *state,
+                                   const ModuleDescriptorConstPtr &callerModule,
+                                   const ModuleDescriptorConstPtr &calleeModule,
+                                   uint64_t callerPc,
+                                   uint64_t calleePc,
+                                   const FunctionMonitor::ReturnSignalPtr &onRet) {
+    if (!callerModule || callerModule->Name != VirtualMemoryMap::s_elfLabel) {
+        return;
+    }
+
+    const ELF &elf = g_crax->getExploit().getElf();
+    uint64_t elfBase = g_crax->getElfBase(state);
+
+    // The runtime addresses of a PIE are unknown until it's loaded.
+    if (elf.checksec.hasPIE && !elfBase) {
+        return;
+    }
+
+    auto it = m_callees.find(calleePc - elfBase);
+    if (it == m_callees.end()) {
+        return;
+    }
+
+    g_crax->setCurrentState(state);
+
+    std::optional<ref<Expr>> ret = (this->*(it->second))(state);
+    if (!ret) {
+        return;
+    }
+
+    // The call has pushed the return address, so emulate `ret`.
+    uint64_t rsp = reg().readConcrete(Register::X64::RSP, /*verbose=*/false);
+    uint64_t retAddr = u64(mem().readConcrete(rsp, 8, /*concretize=*/false));
+
+    log<DEBUG>() << "LibcSummaries: returning to " << hexval(retAddr) << '\n';
+
+    reg().writeSymbolic(Register::X64::RAX, *ret, /*verbose=*/false);
+    reg().writeConcrete(Register::X64::RSP, rsp + 8, /*verbose=*/false);
+    reg().writeConcrete(Register::X64::RIP, retAddr, /*verbose=*/false);
+
+    // Restart at the return address (see DynamicRop::applyNextConstraintGroup()).
+    throw CpuExitException();
+}
+
+void LibcSummaries::buildCallees() {
+    const ELF &elf = g_crax->getExploit().getElf();
+
+    for (const auto &[function, summary] : m_summaries) {
+        if (auto it = elf.plt().find(function); it != elf.plt().end()) {
+            m_callees.emplace(it->second, summary);
+        } else if (auto it = elf.symbols().find(function); it != elf.symbols().end()) {
+            // Statically linked.
+            m_callees.emplace(it->second, summary);
+        }
+    }
+}
+
+
+std::optional<ref<Expr>> LibcSummaries::summarizeStrlen(S2EExecutionState *state) {
+    uint64_t s = reg().readConcrete(Register::X64::RDI, /*verbose=*/false);
+    std::optional<uint64_t> len = findStringLength(s);
+
+    if (!len || !isSymbolic(s, *len + 1)) {
+        return std::nullopt;
+    }
+
+    if (!addConstraint(state, buildStringLengthConstraint(s, *len))) {
+        return std::nullopt;
+    }
+    return ConstantExpr::create(*len, Expr::Int64);
+}
+
+std::optional<ref<Expr>> LibcSummaries::summarizeStrcpy(S2EExecutionState *state) {
+    uint64_t dst = reg().readConcrete(Register::X64::RDI, /*verbose=*/false);
+    uint64_t src = reg().readConcrete(Register::X64::RSI, /*verbose=*/false);
+    std::optional<uint64_t> len = findStringLength(src);
+
+    if (!len || !isSymbolic(src, *len + 1) || !isMapped(dst, *len + 1)) {
+        return std::nullopt;
+    }
+
+    if (!addConstraint(state, buildStringLengthConstraint(src, *len))) {
+        return std::nullopt;
+    }
+
+    copy(dst, src, *len + 1);
+    return ConstantExpr::create(dst, Expr::Int64);
+}
+
+std::optional<ref<Expr>> LibcSummaries::summarizeMemcpy(S2EExecutionState *state) {
+    uint64_t dst = reg().readConcrete(Register::X64::RDI, /*verbose=*/false);
+    uint64_t src = reg().readConcrete(Register::X64::RSI, /*verbose=*/false);
+    std::optional<uint64_t> size = readConcreteArg(Register::X64::RDX);
+
+    if (!size || !*size || *size > m_maxLength ||
+        !isMapped(src, *size) || !isMapped(dst, *size) || !isSymbolic(src, *size)) {
+        return std::nullopt;
+    }
+
+    // copy() reads the whole source before writing, so this works for memmove() too.
+    copy(dst, src, *size);
+    return ConstantExpr::create(dst, Expr::Int64);
+}
+
+std::optional<ref<Expr>> LibcSummaries::summarizeMemset(S2EExecutionState *state) {
+    uint64_t dst = reg().readConcrete(Register::X64::RDI, /*verbose=*/false);
+    std::optional<uint64_t> size = readConcreteArg(Register::X64::RDX);
+
+    // Filling memory with a concrete byte doesn't fork, so leave it to libc.
+    if (!size || !*size || *size > m_maxLength ||
+        !reg().isSymbolic(Register::X64::RSI) || !isMapped(dst, *size)) {
+        return std::nullopt;
+    }
+
+    ref<Expr> c = reg().readSymbolic(Register::X64::RSI, Expr::Int8, /*verbose=*/false);
+
+    for (uint64_t i = 0; i < *size; i++) {
+        static_cast<void>(mem().writeSymbolic(dst + i, c));
+    }
+    return ConstantExpr::create(dst, Expr::Int64);
+}
+
+std::optional<ref<Expr>> LibcSummaries::summarizeStrcmp(S2EExecutionState *state) {
+    uint64_t s1 = reg().readConcrete(Register::X64::RDI, /*verbose=*/false);
+    uint64_t s2 = reg().readConcrete(Register::X64::RSI, /*verbose=*/false);
+    std::optional<uint64_t> len1 = findStringLength(s1);
+    std::optional<uint64_t> len2 = findStringLength(s2);
+
+    if (!len1 || !len2 || (!isSymbolic(s1, *len1 + 1) && !isSymbolic(s2, *len2 + 1))) {
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> bytes1 = mem().readConcrete(s1, *len1 + 1, /*concretize=*/false);
+    std::vector<uint8_t> bytes2 = mem().readConcrete(s2, *len2 + 1, /*concretize=*/false);
+
+    // Find where the strings differ (or both end) under the concolic values,
+    // and constrain the strings to be the same before that.
+    uint64_t i = 0;
+    ref<Expr> constraint = ConstantExpr::create(1, Expr::Bool);
+    ref<Expr> c1 = mem().readSymbolic(s1, Expr::Int8);
+    ref<Expr> c2 = mem().readSymbolic(s2, Expr::Int8);
+    ref<Expr> zero = ConstantExpr::create(0, Expr::Int8);
+
+    for (; bytes1[i] == bytes2[i] && bytes1[i]; i++) {
+        constraint = AndExpr::create(constraint, EqExpr::create(c1, c2));
+        constraint = AndExpr::create(constraint, NotExpr::create(EqExpr::create(c1, zero)));
+        c1 = mem().readSymbolic(s1 + i + 1, Expr::Int8);
+        c2 = mem().readSymbolic(s2 + i + 1, Expr::Int8);
+    }
+
+    if (bytes1[i] == bytes2[i]) {
+        // Both strings end here.
+        constraint = AndExpr::create(constraint, EqExpr::create(c1, zero));
+        constraint = AndExpr::create(constraint, EqExpr::create(c2, zero));
+    } else {
+        constraint = AndExpr::create(constraint, NotExpr::create(EqExpr::create(c1, c2)));
+    }
+
+    if (!addConstraint(state, constraint)) {
+        return std::nullopt;
+    }
+
+    // Keep the sign of the result symbolic, since the caller may branch on it.
+    return SExtExpr::create(SubExpr::create(ZExtExpr::create(c1, Expr::Int32),
+                                            ZExtExpr::create(c2, Expr::Int32)),
+                            Expr::Int64);
+}
+
+
+std::optional<uint64_t> LibcSummaries::findStringLength(uint64_t addr) const {
+    uint64_t len = 0;
+
+    while (len < m_maxLength) {
+        // Read up to the end of the current page.
+        uint64_t size = std::min(getBytesUntilPageEnd(addr + len), m_maxLength - len);
+
+        if (!mem().isMapped(addr + len)) {
+            return std::nullopt;
+        }
+
+        std::vector<uint8_t> bytes = mem().readConcrete(addr + len, size, /*concretize=*/false);
+        auto it = std::find(bytes.begin(), bytes.end(), 0);
+
+        if (it != bytes.end()) {
+            return len + (it - bytes.begin());
+        }
+        len += size;
+    }
+    return std::nullopt;
+}
+
+ref<Expr> LibcSummaries::buildStringLengthConstraint(uint64_t addr, uint64_t len) const {
+    ref<Expr> ret = ConstantExpr::create(1, Expr::Bool);
+    ref<Expr> zero = ConstantExpr::create(0, Expr::Int8);
+
+    for (uint64_t i = 0; i < len; i++) {
+        ref<Expr> c = mem().readSymbolic(addr + i, Expr::Int8);
+        ret = AndExpr::create(ret, NotExpr::create(EqExpr::create(c, zero)));
+    }
+
+    ref<Expr> c = mem().readSymbolic(addr + len, Expr::Int8);
+    return AndExpr::create(ret, EqExpr::create(c, zero));
+}
+
+void LibcSummaries::copy(uint64_t dst, uint64_t src, uint64_t size) const {
+    std::vector<ref<Expr>> chunks;
+
+    for (uint64_t i = 0; i < size; ) {
+        uint64_t chunkSize = std::min(getBytesUntilPageEnd(src + i), size - i);
+        chunks.push_back(mem().readSymbolic(src + i, chunkSize * Expr::Int8));
+        i += chunkSize;
+    }
+
+    for (const auto &chunk : chunks) {
+        static_cast<void>(mem().writeSymbolic(dst, chunk));
+        dst += Expr::getMinBytesForWidth(chunk->getWidth());
+    }
+}
+
+bool LibcSummaries::isMapped(uint64_t addr, uint64_t size) const {
+    for (uint64_t i = 0; i < size; i += getBytesUntilPageEnd(addr + i)) {
+        if (!mem().isMapped(addr + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LibcSummaries::isSymbolic(uint64_t addr, uint64_t size) const {
+    for (uint64_t i = 0; i < size; ) {
+        uint64_t chunkSize = std::min(getBytesUntilPageEnd(addr + i), size - i);
+
+        if (mem().isSymbolic(addr + i, chunkSize)) {
+            return true;
+        }
+        i += chunkSize;
+    }
+    return false;
+}
+
+bool LibcSummaries::addConstraint(S2EExecutionState *state, const ref<Expr> &constraint) const {
+    // e.g., strcmp() may decide the result before reaching any symbolic byte.
+    if (auto ce = dyn_cast<ConstantExpr>(constraint)) {
+        return ce->isTrue();
+    }
+    return state->addConstraint(constraint);
+}
+
+std::optional<uint64_t> LibcSummaries::readConcreteArg(Register::X64 r) const {
+    if (reg().isSymbolic(r)) {
+        return std::nullopt;
+    }
+    return reg().readConcrete(r, /*verbose=*/false);
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,147 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef S2E_PLUGINS_CRAX_LIBC_SUMMARIES_H
+#define S2E_PLUGINS_CRAX_LIBC_SUMMARIES_H
+
+#include <klee/Expr.h>
+#include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/API/Register.h>
+#include <s2e/Plugins/CRAX/Modules/Module.h>
+#include <s2e/Plugins/ExecutionMonitors/FunctionMonitor.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace s2e::plugins::crax {
+
+// Executing libc functions such as strcpy() on symbolic buffers forks
+// (or adds constraints) once per byte. This module intercepts the calls
+// from the target to the selected libc functions, applies a summary of
+// each function on the host, and returns to the caller right away.
+//
+// A summary follows the concolic path: e.g., the summary of strlen()
+// adds one constraint stating that the string is as long as it is under
+// the current concolic values, and returns that length. Calls whose
+// inputs are entirely concrete are left to libc, which is fast anyway.
+//
+// Functions that are summarized should not be listed in CodeSelection,
+// since the return of a summarized function is never executed.
+//
+// Config:
+//   modulesConfig.LibcSummaries = {
+//       functions = { "strlen", "strcpy", "memcpy", "memmove", "memset", "strcmp" },
+//       maxLength = 0x1000,  -- longer strings and copies are left to libc
+//   }
+//
+// All the supported functions are summarized if `functions` is empty.
+
+class LibcSummaries : public Module {
+public:
+    class State : public ModuleState {
+    public:
+        State() : ModuleState() {}
+        virtual ~State() override = default;
+
+        static ModuleState *factory(Module *, CRAXState *) {
+            return new State();
+        }
+
+        virtual ModuleState *clone() const override {
+            return new State(*this);
+        }
+    };
+
+
+    LibcSummaries();
+    virtual ~LibcSummaries() override = default;
+
+    virtual std::string toString() const override { return "LibcSummaries"; }
+
+private:
+    // Applies the effects of a libc function to `state`, and returns
+    // the return value, or nullopt if the call should be left to libc.
+    using Summary = std::optional<klee::ref<klee::Expr>> (LibcSummaries::*)(S2EExecutionState *);
+    using SummaryMap = std::map<std::string, Summary>;
+    static SummaryMap initSummaryMap();
+
+    void onFunctionCall(S2EExecutionState *state,
+                        const ModuleDescriptorConstPtr &callerModule,
+                        const ModuleDescriptorConstPtr &calleeModule,
+                        uint64_t callerPc,
+                        uint64_t calleePc,
+                        const FunctionMonitor::ReturnSignalPtr &onRet);
+
+    // Collects the offsets of the summarized functions into m_callees.
+    // They're relative to the ELF base, which may differ between states.
+    void buildCallees();
+
+    // Summaries
+    std::optional<klee::ref<klee::Expr>> summarizeStrlen(S2EExecutionState *state);
+    std::optional<klee::ref<klee::Expr>> summarizeStrcpy(S2EExecutionState *state);
+    std::optional<klee::ref<klee::Expr>> summarizeMemcpy(S2EExecutionState *state);
+    std::optional<klee::ref<klee::Expr>> summarizeMemset(S2EExecutionState *state);
+    std::optional<klee::ref<klee::Expr>> summarizeStrcmp(S2EExecutionState *state);
+
+    // Returns the concolic length of the string at `addr`, or nullopt if
+    // it isn't terminated within m_maxLength bytes of mapped memory.
+    [[nodiscard]]
+    std::optional<uint64_t> findStringLength(uint64_t addr) const;
+
+    // Constrains the string at `addr` to be exactly `len` bytes long.
+    [[nodiscard]]
+    klee::ref<klee::Expr> buildStringLengthConstraint(uint64_t addr, uint64_t len) const;
+
+    // Copies `size` bytes from `src` to `dst`, preserving symbolic bytes.
+    // Both ranges must have been checked with isMapped().
+    void copy(uint64_t dst, uint64_t src, uint64_t size) const;
+
+    // Whether every page of [addr, addr + size) is mapped. If not, the call
+    // is left to libc, so that the target faults as it would without us.
+    [[nodiscard]]
+    bool isMapped(uint64_t addr, uint64_t size) const;
+
+    // Same as Memory::isSymbolic(), but `size` may span multiple pages.
+    [[nodiscard]]
+    bool isSymbolic(uint64_t addr, uint64_t size) const;
+
+    // Adds `constraint` to `state`, which is satisfied by the concolic values.
+    [[nodiscard]]
+    bool addConstraint(S2EExecutionState *state, const klee::ref<klee::Expr> &constraint) const;
+
+    // Reads a register which is expected to be concrete, e.g., a length.
+    [[nodiscard]]
+    std::optional<uint64_t> readConcreteArg(Register::X64 r) const;
+
+
+    SummaryMap m_summaries;
+    uint64_t m_maxLength;
+
+    // Key: offset within the ELF, value: summary
+    std::unordered_map<uint64_t, Summary> m_callees;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_LIBC_SUMMARIES_H
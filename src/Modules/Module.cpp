@@ -20,10 +20,16 @@
 
 #include <s2e/Plugins/CRAX/CRAX.h>
 #include <s2e/Plugins/CRAX/Modules/CodeSelection/CodeSelection.h>
+#include <s2e/Plugins/CRAX/Modules/CrashDirectedSearcher/CrashDirectedSearcher.h>
 #include <s2e/Plugins/CRAX/Modules/DynamicRop/DynamicRop.h>
 #include <s2e/Plugins/CRAX/Modules/IOStates/IOStates.h>
 #include <s2e/Plugins/CRAX/Modules/GuestOutput/GuestOutput.h>
+#include <s2e/Plugins/CRAX/Modules/InputTaint/InputTaint.h>
+#include <s2e/Plugins/CRAX/Modules/LibcSummaries/LibcSummaries.h>
+#include <s2e/Plugins/CRAX/Modules/SavedRipWatcher/SavedRipWatcher.h>
+#include <s2e/Plugins/CRAX/Modules/StateSnapshot/StateSnapshot.h>
 #include <s2e/Plugins/CRAX/Modules/SymbolicAddressMap/SymbolicAddressMap.h>
+#include <s2e/Plugins/CRAX/Modules/VirtualClock/VirtualClock.h>
 
 #include <cassert>
 #include <type_traits>
@@ -32,40 +38,63 @@
 
 namespace s2e::plugins::crax {
 
-std::map<std::type_index, Module *> Module::s_mapper;
+std::vector<Module *> Module::s_modules;
 
 
 ModuleState *Module::getModuleState(CRAXState *s, ModuleStateFactory f) const {
     return s->getModuleState(const_cast<Module *>(this), f);
 }
 
+const ModuleState *Module::getConstModuleState(CRAXState *s, ModuleStateFactory f) const {
+    return s->getConstModuleState(const_cast<Module *>(this), f);
+}
+
 std::string Module::getConfigKey() const {
     return g_crax->getConfigKey() + ".modulesConfig." + toString();
 }
 
 
+template <typename T>
+std::unique_ptr<Module> Module::make() {
+    assert(s_id<T> == -1 && "The same module is loaded twice?");
+    assert(s_modules.size() < s_maxModules && "Too many modules, bump Module::s_maxModules");
+
+    std::unique_ptr<Module> ret = std::make_unique<T>();
+    ret->m_id = s_modules.size();
+
+    s_id<T> = ret->m_id;
+    s_modules.push_back(ret.get());
+    return ret;
+}
+
 std::unique_ptr<Module> Module::create(const std::string &name) {
     std::unique_ptr<Module> ret;
 
     if (name == "CodeSelection") {
-        ret = std::make_unique<CodeSelection>();
+        ret = make<CodeSelection>();
+    } else if (name == "CrashDirectedSearcher") {
+        ret = make<CrashDirectedSearcher>();
     } else if (name == "DynamicRop") {
-        ret = std::make_unique<DynamicRop>();
+        ret = make<DynamicRop>();
     } else if (name == "IOStates") {
-        ret = std::make_unique<IOStates>();
+        ret = make<IOStates>();
     } else if (name == "GuestOutput") {
-        ret = std::make_unique<GuestOutput>();
+        ret = make<GuestOutput>();
+    } else if (name == "InputTaint") {
+        ret = make<InputTaint>();
+    } else if (name == "LibcSummaries") {
+        ret = make<LibcSummaries>();
+    } else if (name == "SavedRipWatcher") {
+        ret = make<SavedRipWatcher>();
+    } else if (name == "StateSnapshot") {
+        ret = make<StateSnapshot>();
     } else if (name == "SymbolicAddressMap") {
-        ret = std::make_unique<SymbolicAddressMap>();
+        ret = make<SymbolicAddressMap>();
+    } else if (name == "VirtualClock") {
+        ret = make<VirtualClock>();
     }
 
     assert(ret && "Module::create() failed, incorrect module name given in config?");
-
-    // It seems that we cannot write `typeid(*ret)` directly due to
-    // [-Werror,-Wpotentially-evaluated-expression], so we have to add
-    // a layer of indirection here...
-    auto &mod = *ret;
-    Module::s_mapper.insert({typeid(mod), &mod});
     return ret;
 }
 
@@ -21,10 +21,9 @@
 #ifndef S2E_PLUGINS_CRAX_MODULE_H
 #define S2E_PLUGINS_CRAX_MODULE_H
 
-#include <map>
 #include <memory>
 #include <string>
-#include <typeindex>
+#include <vector>
 
 namespace s2e::plugins::crax {
 
@@ -42,7 +41,7 @@ using ModuleStateFactory = ModuleState *(*)(Module *, CRAXState *);
 // Essentially, a module is an S2E-plugin's plugin.
 class Module {
 public:
-    Module() = default;
+    Module() : m_id() {}
     virtual ~Module() = default;
 
     virtual bool checkRequirements() const { return true; }
@@ -50,14 +49,38 @@ public:
     virtual std::string toString() const = 0;
 
     ModuleState *getModuleState(CRAXState *state, ModuleStateFactory f) const;
+    const ModuleState *getConstModuleState(CRAXState *state, ModuleStateFactory f) const;
     std::string getConfigKey() const;
 
+    // The index of this module in s_modules, which is also where
+    // its per-state module state is stored in a CRAXState.
+    [[nodiscard]]
+    size_t getId() const { return m_id; }
+
     static std::unique_ptr<Module> create(const std::string &name);
-    static std::map<std::type_index, Module *> s_mapper;
+
+    // Modules are numbered in the order they're created, and s_id<T> is
+    // the ID of the module of type T, or -1 if T hasn't been loaded.
+    // This lets CRAX::getModule<T>() avoid any lookup by typeid.
+    static std::vector<Module *> s_modules;
+
+    template <typename T>
+    static inline int s_id = -1;
+
+    static constexpr size_t s_maxModules = 16;
+
+private:
+    template <typename T>
+    static std::unique_ptr<Module> make();
+
+    size_t m_id;
 };
 
 
 // The per-state information of a CRAX's module.
+//
+// Module states are shared between forked states until one of them
+// writes to it (see CRAXState), so clone() is only called on demand.
 class ModuleState {
 public:
     virtual ~ModuleState() = default;
@@ -0,0 +1,196 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/S2E.h>
+#include <s2e/Plugins/CRAX/CRAX.h>
+
+#include "SavedRipWatcher.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+SavedRipWatcher::SavedRipWatcher()
+    : Module(),
+      m_linuxMonitor(g_s2e->getPlugin<LinuxMonitor>()),
+      m_shortcutToRet(CRAX_CONFIG_GET_BOOL(".shortcutToRet", false)),
+      m_retGadgetOffset() {
+    // The shortcut would skip the epilogue, including the canary check.
+    if (m_shortcutToRet && g_crax->getExploit().getElf().checksec.hasCanary) {
+        log<WARN>() << "SavedRipWatcher: the target has a canary, shortcut disabled.\n";
+        m_shortcutToRet = false;
+    }
+
+    g_crax->beforeInstruction.connect(
+            sigc::mem_fun(*this, &SavedRipWatcher::beforeInstruction));
+
+    g_crax->beforeExploitGeneration.connect(
+            sigc::mem_fun(*this, &SavedRipWatcher::beforeExploitGeneration));
+
+    // Symbolic data can only be written to memory by an instruction executed
+    // symbolically, which S2E reports through this signal. Concrete writes
+    // are not interesting here since they cannot make a saved RIP symbolic.
+    g_s2e->getCorePlugin()->onAfterSymbolicDataMemoryAccess.connect(
+            sigc::mem_fun(*this, &SavedRipWatcher::onSymbolicMemoryAccess));
+
+    g_s2e->getCorePlugin()->onStateKill.connect(
+            sigc::mem_fun(*this, &SavedRipWatcher::onStateKill));
+}
+
+
+std::optional<SavedRipWatcher::CrashContext>
+SavedRipWatcher::getCrashContext(S2EExecutionState *state) const {
+    return g_crax->getConstModuleState(state, this)->m_crashContext;
+}
+
+void SavedRipWatcher::beforeInstruction(S2EExecutionState *state,
+                                        const Instruction &i) {
+    CallStack::Op op = CallStack::getOp(i);
+
+    if (op == CallStack::Op::NONE || !isTargetProcess(state)) {
+        return;
+    }
+
+    auto modState = g_crax->getModuleState(state, this);
+    auto &callStack = modState->m_callStack;
+    uint64_t rsp = reg().readConcrete(Register::X64::RSP, /*verbose=*/false);
+
+    if (op == CallStack::Op::CALL) {
+        callStack.push(i, rsp);
+        return;
+    }
+
+    callStack.pop(rsp);
+
+    // The callee which has overflowed the frame is returning to it,
+    // so the whole overflow has been written by now.
+    if (modState->m_hasPendingShortcut && callStack.size() == modState->m_crashContext->frameIdx + 1) {
+        shortcutToRet(state, modState);
+    }
+}
+
+void SavedRipWatcher::onSymbolicMemoryAccess(S2EExecutionState *state,
+                                             ref<Expr> virtualAddress,
+                                             ref<Expr> hostAddress,
+                                             ref<Expr> value,
+                                             unsigned flags) {
+    auto ce = dyn_cast<ConstantExpr>(virtualAddress);
+
+    if (!(flags & MEM_TRACE_FLAG_WRITE) || !ce || isa<ConstantExpr>(value)) {
+        return;
+    }
+
+    auto modState = g_crax->getConstModuleState(state, this);
+
+    const CallStack &callStack = modState->m_callStack;
+
+    // Only the first overwrite matters.
+    if (modState->m_crashContext || callStack.empty()) {
+        return;
+    }
+
+    int idx = callStack.find(ce->getZExtValue(), Expr::getMinBytesForWidth(value->getWidth()));
+
+    if (idx == -1 || !isTargetProcess(state)) {
+        return;
+    }
+
+    // Wait until the whole saved RIP is symbolic.
+    const CallStack::Frame &frame = callStack[idx];
+    if (!mem(state).isSymbolic(frame.savedRipSlot, 8)) {
+        return;
+    }
+
+    CrashContext ctx { state->regs()->getPc(), frame.savedRipSlot, frame.returnAddress,
+                       static_cast<size_t>(idx) };
+
+    log<WARN>()
+        << '[' << hexval(ctx.pc) << "] "
+        << "Saved RIP of frame #" << idx << " (slot: " << hexval(ctx.savedRipSlot)
+        << ", returning to " << hexval(ctx.returnAddress) << ") has become symbolic\n";
+
+    // If the overflowed function is writing the overflow itself,
+    // we cannot tell when it's done, so let it run.
+    bool isWrittenByCallee = callStack.size() > ctx.frameIdx + 1;
+
+    auto mutableModState = g_crax->getModuleState(state, this);
+    mutableModState->m_crashContext = ctx;
+    mutableModState->m_hasPendingShortcut = m_shortcutToRet && isWrittenByCallee;
+}
+
+void SavedRipWatcher::beforeExploitGeneration(S2EExecutionState *state) {
+    g_crax->getModuleState(state, this)->m_hasHijackedRip = true;
+}
+
+void SavedRipWatcher::onStateKill(S2EExecutionState *state) {
+    auto modState = g_crax->getConstModuleState(state, this);
+
+    if (modState->m_crashContext && !modState->m_hasHijackedRip) {
+        const CrashContext &ctx = *modState->m_crashContext;
+
+        log<WARN>()
+            << "State " << state->getID() << " was killed before returning through "
+            << "the overwritten saved RIP at " << hexval(ctx.savedRipSlot)
+            << " (overwritten at " << hexval(ctx.pc) << ")\n";
+    }
+}
+
+
+void SavedRipWatcher::shortcutToRet(S2EExecutionState *state, State *modState) {
+    modState->m_hasPendingShortcut = false;
+
+    const ELF &elf = g_crax->getExploit().getElf();
+
+    if (!m_retGadgetOffset) {
+        m_retGadgetOffset = g_crax->getExploit().resolveGadget(elf, "ret");
+
+        if (!m_retGadgetOffset) {
+            log<WARN>() << "SavedRipWatcher: no `ret` in the target, shortcut disabled.\n";
+            m_shortcutToRet = false;
+            return;
+        }
+    }
+
+    const CrashContext &ctx = *modState->m_crashContext;
+
+    log<WARN>() << "Skipping to `ret` through " << hexval(ctx.savedRipSlot) << '\n';
+
+    // Emulate `leave` if the saved RBP has been overwritten as well,
+    // since the epilogue of the overflowed function would pop it.
+    if (mem().isSymbolic(ctx.savedRipSlot - 8, 8)) {
+        reg().writeSymbolic(Register::X64::RBP, mem().readSymbolic(ctx.savedRipSlot - 8, Expr::Int64));
+    }
+
+    // The frames above the overflowed one are gone.
+    modState->m_callStack.resize(ctx.frameIdx + 1);
+
+    reg().writeConcrete(Register::X64::RSP, ctx.savedRipSlot);
+    uint64_t retGadget = elf.getRuntimeAddress(m_retGadgetOffset, g_crax->getElfBase(state));
+    reg().writeConcrete(Register::X64::RIP, retGadget);
+
+    // Restart at the `ret` (see DynamicRop::applyNextConstraintGroup()).
+    throw CpuExitException();
+}
+
+bool SavedRipWatcher::isTargetProcess(S2EExecutionState *state) const {
+    return m_linuxMonitor->getPid(state) == g_crax->getTargetProcessPid(state);
+}
+
+}  // namespace s2e::plugins::crax
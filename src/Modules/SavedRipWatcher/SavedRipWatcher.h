@@ -0,0 +1,132 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_SAVED_RIP_WATCHER_H
+#define S2E_PLUGINS_CRAX_SAVED_RIP_WATCHER_H
+
+#include <klee/Expr.h>
+#include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/API/CallStack.h>
+#include <s2e/Plugins/CRAX/API/Disassembler.h>
+#include <s2e/Plugins/CRAX/Modules/Module.h>
+#include <s2e/Plugins/OSMonitors/Linux/LinuxMonitor.h>
+
+#include <optional>
+#include <string>
+
+namespace s2e::plugins::crax {
+
+// CRAX normally acts when RIP becomes symbolic, i.e., only after the
+// overflowing function has done all its remaining work (which may include
+// long loops over the symbolic buffer) and returned.
+//
+// This module tracks the frames of the target through call/ret and watches
+// their saved return addresses. As soon as one of them has been entirely
+// overwritten with symbolic bytes, the crash context is recorded. If
+// `shortcutToRet` is set and the overwrite was done by a callee (e.g., read(),
+// strcpy()), the remaining work of the overflowed function is skipped by
+// returning through the overwritten slot once the callee returns, i.e.,
+// after the whole overflow has been written. The shortcut is disabled if the
+// target has a canary, since it would jump past the canary check.
+// Overwrites which never reach a `ret` (e.g., masked by a later abort())
+// are reported when the state is killed.
+//
+// Config:
+//   modulesConfig.SavedRipWatcher = {
+//       shortcutToRet = false,
+//   }
+
+class SavedRipWatcher : public Module {
+public:
+    struct CrashContext {
+        uint64_t pc;  // the instruction which overwrote the saved RIP
+        uint64_t savedRipSlot;
+        uint64_t returnAddress;
+        size_t frameIdx;  // 0 is the outermost frame
+    };
+
+
+    class State : public ModuleState {
+        friend class SavedRipWatcher;
+
+    public:
+        State()
+            : ModuleState(),
+              m_callStack(),
+              m_crashContext(),
+              m_hasPendingShortcut(),
+              m_hasHijackedRip() {}
+
+        virtual ~State() override = default;
+
+        static ModuleState *factory(Module *, CRAXState *) {
+            return new State();
+        }
+
+        virtual ModuleState *clone() const override {
+            return new State(*this);
+        }
+
+    private:
+        CallStack m_callStack;
+        std::optional<CrashContext> m_crashContext;
+        bool m_hasPendingShortcut;
+        bool m_hasHijackedRip;
+    };
+
+
+    SavedRipWatcher();
+    virtual ~SavedRipWatcher() override = default;
+
+    virtual std::string toString() const override { return "SavedRipWatcher"; }
+
+    // Returns the context of the first saved RIP overwrite in `state`, if any.
+    [[nodiscard]]
+    std::optional<CrashContext> getCrashContext(S2EExecutionState *state) const;
+
+private:
+    void beforeInstruction(S2EExecutionState *state, const Instruction &i);
+
+    void onSymbolicMemoryAccess(S2EExecutionState *state,
+                                klee::ref<klee::Expr> virtualAddress,
+                                klee::ref<klee::Expr> hostAddress,
+                                klee::ref<klee::Expr> value,
+                                unsigned flags);
+
+    void beforeExploitGeneration(S2EExecutionState *state);
+
+    void onStateKill(S2EExecutionState *state);
+
+    // Skips the rest of the overflowed function by emulating `leave; ret`
+    // on the overwritten frame.
+    void shortcutToRet(S2EExecutionState *state, State *modState);
+
+    [[nodiscard]]
+    bool isTargetProcess(S2EExecutionState *state) const;
+
+
+    LinuxMonitor *m_linuxMonitor;
+    bool m_shortcutToRet;
+    uint64_t m_retGadgetOffset;  // relative to the ELF base of each state
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_SAVED_RIP_WATCHER_H
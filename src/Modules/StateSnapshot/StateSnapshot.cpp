@@ -0,0 +1,273 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <s2e/S2E.h>
+#include <s2e/Plugins/CRAX/CRAX.h>
+#include <s2e/Plugins/CRAX/RopPayloadBuilder.h>
+#include <s2e/Plugins/CRAX/Modules/IOStates/IOStates.h>
+#include <s2e/Plugins/CRAX/Renderers/JsonRenderer.h>
+#include <s2e/Plugins/CRAX/Utils/StringUtil.h>
+#include <s2e/Plugins/CRAX/Utils/VariantOverload.h>
+
+#include <klee/util/ExprPPrinter.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "StateSnapshot.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+StateSnapshot::StateSnapshot()
+    : Module(),
+      m_dumpMemory(CRAX_CONFIG_GET_BOOL(".dumpMemory", true)) {
+    if (auto iostates = CRAX::getModule<IOStates>()) {
+        iostates->setRecordOutputBytes(true);
+    }
+
+    g_crax->beforeExploitGeneration.connect(
+            sigc::mem_fun(*this, &StateSnapshot::beforeExploitGeneration));
+}
+
+
+void StateSnapshot::beforeExploitGeneration(S2EExecutionState *state) {
+    std::string id = ExploitGenerator::getArtifactId(state);
+    std::string filename = ExploitGenerator::getArtifactDir(state) / getFilename(id);
+
+    std::ofstream ofs(filename);
+
+    if (!ofs) {
+        log<WARN>() << "Failed to open " << filename << '\n';
+        return;
+    }
+
+    ofs << render(state);
+    log<WARN>() << "Saved the snapshot of state " << state->getID() << " to " << filename << '\n';
+}
+
+std::string StateSnapshot::render(S2EExecutionState *state) const {
+    const Exploit &exploit = g_crax->getExploit();
+    const ELF &elf = exploit.getElf();
+    const ELF &libc = exploit.getLibc();
+
+    std::string ret = "{\n";
+    ret += format("  \"version\": %d,\n", s_version);
+    ret += format("  \"state\": %d,\n", state->getID());
+    ret += format("  \"elf\": { \"filename\": %s, \"base\": \"0x%llx\" },\n",
+                  JsonRenderer::quote(elf.getFilename()).c_str(), elf.getBase());
+    ret += format("  \"libc\": { \"filename\": %s, \"base\": \"0x%llx\" },\n",
+                  JsonRenderer::quote(libc.getFilename()).c_str(), libc.getBase());
+    ret += "  \"registers\": " + renderRegisters(state) + ",\n";
+    ret += "  \"symbolicRegisters\": " + renderSymbolicRegisters(state) + ",\n";
+    ret += "  \"symbolicMemory\": " + renderSymbolicMemory(state) + ",\n";
+    ret += "  \"vmmap\": " + renderVmmap(state) + ",\n";
+    ret += "  \"memory\": " + renderMemory(state) + ",\n";
+    ret += "  \"concolics\": " + renderConcolics(state) + ",\n";
+    ret += "  \"ioStates\": " + renderIOStates(state) + ",\n";
+    ret += "  \"constraints\": " + JsonRenderer::quote(renderConstraints(state)) + "\n";
+    return ret + "}\n";
+}
+
+std::string StateSnapshot::renderRegisters(S2EExecutionState *state) const {
+    std::vector<std::string> regs;
+
+    for (int i = 0; i <= Register::X64::RIP; i++) {
+        auto r = static_cast<Register::X64>(i);
+        if (r == Register::X64::LAST) {
+            continue;
+        }
+        regs.push_back(format("%s: \"0x%llx\"",
+                              JsonRenderer::quote(reg(state).getName(r)).c_str(),
+                              reg(state).readConcrete(r, /*verbose=*/false)));
+    }
+    return "{ " + join(regs, ", ") + " }";
+}
+
+std::string StateSnapshot::renderSymbolicRegisters(S2EExecutionState *state) const {
+    std::vector<std::string> regs;
+
+    for (int i = 0; i <= Register::X64::RIP; i++) {
+        auto r = static_cast<Register::X64>(i);
+        if (r == Register::X64::LAST) {
+            continue;
+        }
+
+        ref<Expr> e = reg(state).readSymbolic(r, Expr::Int64, /*verbose=*/false);
+        if (isa<ConstantExpr>(e)) {
+            continue;
+        }
+
+        std::string s;
+        llvm::raw_string_ostream os(s);
+        os << e;
+        regs.push_back(JsonRenderer::quote(reg(state).getName(r)) + ": " +
+                       JsonRenderer::quote(os.str()));
+    }
+    return "{ " + join(regs, ", ") + " }";
+}
+
+std::string StateSnapshot::renderSymbolicMemory(S2EExecutionState *state) const {
+    std::vector<std::string> regions;
+
+    for (const auto &[addr, size] : mem(state).getSymbolicMemory()) {
+        regions.push_back(format("{ \"addr\": \"0x%llx\", \"size\": %llu }", addr, size));
+    }
+    return "[" + join(regions, ", ") + "]";
+}
+
+std::string StateSnapshot::renderVmmap(S2EExecutionState *state) const {
+    std::vector<std::string> regions;
+    const auto &vmmap = mem(state).vmmap();
+
+    foreach2 (it, vmmap.begin(), vmmap.end()) {
+        RegionDescriptorPtr region = *it;
+        regions.push_back(format("\n    { \"start\": \"0x%llx\", \"end\": \"0x%llx\", "
+                                 "\"perms\": \"%c%c%c\", \"module\": %s }",
+                                 it.start(), it.stop() + 1,
+                                 region->r ? 'r' : '-',
+                                 region->w ? 'w' : '-',
+                                 region->x ? 'x' : '-',
+                                 JsonRenderer::quote(region->moduleName).c_str()));
+    }
+    return "[" + join(regions, ",") + "\n  ]";
+}
+
+std::string StateSnapshot::renderMemory(S2EExecutionState *state) const {
+    std::vector<std::string> regions;
+
+    if (!m_dumpMemory) {
+        return "[]";
+    }
+
+    const auto &vmmap = mem(state).vmmap();
+
+    foreach2 (it, vmmap.begin(), vmmap.end()) {
+        RegionDescriptorPtr region = *it;
+
+        bool isWritableElfRegion = region->w && region->moduleName == VirtualMemoryMap::s_elfLabel;
+        bool isStack = region->moduleName == VirtualMemoryMap::s_stackLabel;
+
+        if (!isWritableElfRegion && !isStack) {
+            continue;
+        }
+
+        // Symbolic bytes are dumped with their concolic values,
+        // and without adding any constraint to the state.
+        uint64_t size = it.stop() + 1 - it.start();
+        std::vector<uint8_t> bytes = mem(state).readConcrete(it.start(), size, /*concretize=*/false);
+
+        regions.push_back(format("\n    { \"addr\": \"0x%llx\", \"bytes\": \"%s\" }",
+                                 it.start(),
+                                 toHexString(bytes.begin(), bytes.end()).c_str()));
+    }
+    return "[" + join(regions, ",") + "\n  ]";
+}
+
+std::string StateSnapshot::renderConcolics(S2EExecutionState *state) const {
+    std::vector<std::string> arrays;
+
+    for (const auto &[name, bytes] : RopPayloadBuilder::getConcreteInputs(*state)) {
+        arrays.push_back(JsonRenderer::quote(name) + ": \"" +
+                         toHexString(bytes.begin(), bytes.end()) + '"');
+    }
+    return "{ " + join(arrays, ", ") + " }";
+}
+
+std::string StateSnapshot::renderIOStates(S2EExecutionState *state) const {
+    auto iostates = CRAX::getModule<IOStates>();
+
+    if (!iostates) {
+        return "null";
+    }
+
+    auto modState = g_crax->getConstModuleState(state, iostates);
+
+    // The input states consume the concrete input one after another,
+    // the same way LeakBasedCoreGenerator reads its PseudoInputStream.
+    RopPayloadBuilder::ConcreteInput input = RopPayloadBuilder::getOneConcreteInput(*state);
+    uint64_t inputOffset = 0;
+
+    auto hex = [](const std::vector<uint8_t> &bytes) {
+        return '"' + toHexString(bytes.begin(), bytes.end()) + '"';
+    };
+
+    auto visitor = overload {
+        [&](const IOStates::InputStateInfo &stateInfo) {
+            uint64_t begin = std::min<uint64_t>(inputOffset, input.size());
+            uint64_t end = std::min<uint64_t>(begin + stateInfo.offset, input.size());
+            std::string ret = format("{ \"kind\": \"input\", \"offset\": %llu, \"len\": %llu, "
+                                     "\"bytes\": %s }",
+                                     inputOffset, stateInfo.offset,
+                                     hex(std::vector<uint8_t>(input.begin() + begin, input.begin() + end)).c_str());
+            inputOffset += stateInfo.offset;
+            return ret;
+        },
+        [&](const IOStates::OutputStateInfo &stateInfo) {
+            std::string ret = format("{ \"kind\": \"output\", \"len\": %llu, \"bytes\": %s, "
+                                     "\"delim\": %s, \"isInputDependent\": %s, "
+                                     "\"isInteresting\": %s",
+                                     stateInfo.len,
+                                     hex(stateInfo.bytes).c_str(),
+                                     hex(stateInfo.delim).c_str(),
+                                     stateInfo.isInputDependent ? "true" : "false",
+                                     stateInfo.isInteresting ? "true" : "false");
+            if (stateInfo.isInteresting) {
+                ret += format(", \"bufIndex\": %llu, \"baseOffset\": \"0x%llx\", \"leakType\": %s",
+                              stateInfo.bufIndex, stateInfo.baseOffset,
+                              JsonRenderer::quote(IOStates::toString(stateInfo.leakType)).c_str());
+            }
+            return ret + " }";
+        },
+        [](const IOStates::SleepStateInfo &stateInfo) {
+            return format("{ \"kind\": \"sleep\", \"sec\": %lld }",
+                          static_cast<long long>(stateInfo.sec));
+        }
+    };
+
+    std::vector<std::string> stateInfoList;
+    for (const auto &stateInfo : modState->stateInfoList) {
+        stateInfoList.push_back("\n      " + std::visit(visitor, stateInfo));
+    }
+
+    std::string ret = "{\n";
+    ret += format("    \"lastInputStateInfoIdx\": %u,\n", modState->lastInputStateInfoIdx);
+    ret += format("    \"lastInputStateInfoIdxBeforeFirstSymbolicRip\": %d,\n",
+                  static_cast<int32_t>(modState->lastInputStateInfoIdxBeforeFirstSymbolicRip));
+    ret += format("    \"canary\": \"0x%llx\",\n", modState->canary);
+    ret += "    \"stateInfoList\": [" + join(stateInfoList, ",") + "\n    ]\n";
+    return ret + "  }";
+}
+
+std::string StateSnapshot::renderConstraints(S2EExecutionState *state) const {
+    std::string ret;
+    llvm::raw_string_ostream os(ret);
+
+    // The path constraints along with the declarations of the arrays
+    // they refer to, in a form which kleaver can parse.
+    ExprPPrinter::printQuery(os, state->constraints(), ConstantExpr::alloc(0, Expr::Bool));
+    return os.str();
+}
+
+}  // namespace s2e::plugins::crax
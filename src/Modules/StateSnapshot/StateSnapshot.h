@@ -0,0 +1,130 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef S2E_PLUGINS_CRAX_STATE_SNAPSHOT_H
+#define S2E_PLUGINS_CRAX_STATE_SNAPSHOT_H
+
+#include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/Modules/Module.h>
+
+#include <string>
+
+namespace s2e::plugins::crax {
+
+// Records everything exploit generation depends on at the moment RIP
+// becomes symbolic into snapshot_<id>.json (next to exploit_<id>.*),
+// so that it can be studied offline without booting the guest again.
+// scripts/crax-check-snapshot.py replays its I/O against the target on
+// the host to check that it still crashes. Exploits can't be regenerated
+// from a snapshot, since the techniques need a live S2EExecutionState.
+//
+//   {
+//     "version": 2,
+//     "state": 0,
+//     "elf": { "filename": "./target", "base": "0x..." },
+//     "libc": { "filename": "./libc-2.24.so", "base": "0x..." },
+//     "registers": { "RAX": "0x...", ..., "RIP": "0x..." },
+//     "symbolicRegisters": { "RIP": "<expr>", ... },
+//     "symbolicMemory": [ { "addr": "0x...", "size": 8 }, ... ],
+//     "vmmap": [ { "start": "0x...", "end": "0x...", "perms": "rw-", "module": "..." }, ... ],
+//     "memory": [ { "addr": "0x...", "bytes": "<hex>" }, ... ],
+//     "concolics": { "<array>": "<hex>", ... },
+//     "ioStates": {
+//       "lastInputStateInfoIdx": 3,
+//       "lastInputStateInfoIdxBeforeFirstSymbolicRip": 3,
+//       "canary": "0x...",
+//       "stateInfoList": [
+//         { "kind": "input", "offset": 0, "len": 16, "bytes": "<hex>" },
+//         { "kind": "output", "len": 8, "bytes": "<hex>", "delim": "<hex>",
+//           "isInputDependent": false, "isInteresting": true,
+//           "bufIndex": 0, "baseOffset": "0x...", "leakType": "libc" },
+//         { "kind": "sleep", "sec": 1 },
+//         ...
+//       ]
+//     } | null,
+//     "constraints": "<kquery>"
+//   }
+//
+// Only the writable regions of the target and [stack] are dumped
+// into "memory", since the rest can be recovered from the ELF files.
+// The "offset" of an input state is where it starts in the concrete
+// input, and "len" is the number of bytes IOStates sends for it.
+// Integers that may exceed 2^53 are hex strings, as in JsonRenderer.
+//
+// Load this module after IOStates, so that IOStates has finished
+// updating its state when the snapshot is taken, and records the
+// bytes of the output states for it.
+//
+// Config:
+//   modulesConfig.StateSnapshot = {
+//       dumpMemory = true,
+//   }
+
+class StateSnapshot : public Module {
+public:
+    StateSnapshot();
+    virtual ~StateSnapshot() override = default;
+
+    virtual std::string toString() const override { return "StateSnapshot"; }
+
+    [[nodiscard]]
+    static std::string getFilename(const std::string &id) {
+        return "snapshot_" + id + ".json";
+    }
+
+    static constexpr int s_version = 2;
+
+private:
+    void beforeExploitGeneration(S2EExecutionState *state);
+
+    [[nodiscard]]
+    std::string render(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderRegisters(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderSymbolicRegisters(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderSymbolicMemory(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderVmmap(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderMemory(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderConcolics(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderIOStates(S2EExecutionState *state) const;
+
+    [[nodiscard]]
+    std::string renderConstraints(S2EExecutionState *state) const;
+
+    bool m_dumpMemory;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_STATE_SNAPSHOT_H
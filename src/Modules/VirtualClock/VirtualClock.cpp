@@ -0,0 +1,286 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <s2e/Plugins/CRAX/CRAX.h>
+#include <s2e/Plugins/CRAX/Pwnlib/Util.h>
+
+#include <algorithm>
+#include <map>
+
+#include "VirtualClock.h"
+
+#define SYS_SELECT          23
+#define SYS_SCHED_YIELD     24
+#define SYS_NANOSLEEP       35
+#define SYS_ALARM           37
+#define SYS_GETTIMEOFDAY    96
+#define SYS_TIME            201
+#define SYS_CLOCK_GETTIME   228
+#define SYS_CLOCK_NANOSLEEP 230
+
+#define CLOCK_PROCESS_CPUTIME_ID 2
+#define CLOCK_THREAD_CPUTIME_ID  3
+
+#define TIMER_ABSTIME 1
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+namespace {
+
+constexpr uint64_t s_nsPerSec = 1000000000;
+
+const std::map<std::string, uint64_t> s_supportedSyscalls = {
+    { "nanosleep",       SYS_NANOSLEEP },
+    { "clock_nanosleep", SYS_CLOCK_NANOSLEEP },
+    { "alarm",           SYS_ALARM },
+    { "select",          SYS_SELECT },
+    { "time",            SYS_TIME },
+    { "gettimeofday",    SYS_GETTIMEOFDAY },
+    { "clock_gettime",   SYS_CLOCK_GETTIME },
+};
+
+uint64_t addSaturated(uint64_t a, uint64_t b) {
+    return (a > UINT64_MAX - b) ? UINT64_MAX : a + b;
+}
+
+}  // namespace
+
+
+VirtualClock::VirtualClock()
+    : Module(),
+      m_syscalls() {
+    std::vector<std::string> syscalls = CRAX_CONFIG_GET_STRING_LIST(".syscalls");
+
+    if (syscalls.empty()) {
+        for (const auto &[name, nr] : s_supportedSyscalls) {
+            m_syscalls.push_back(nr);
+        }
+    }
+
+    for (const auto &name : syscalls) {
+        auto it = s_supportedSyscalls.find(name);
+
+        if (it == s_supportedSyscalls.end()) {
+            log<WARN>() << "VirtualClock: cannot fast-forward " << name << "(), ignored.\n";
+            continue;
+        }
+        m_syscalls.push_back(it->second);
+    }
+
+    g_crax->beforeSyscall.connect(
+            sigc::mem_fun(*this, &VirtualClock::beforeSyscall));
+
+    g_crax->afterSyscall.connect(
+            sigc::mem_fun(*this, &VirtualClock::afterSyscall));
+}
+
+
+uint64_t VirtualClock::getTime(S2EExecutionState *state) const {
+    return g_crax->getConstModuleState(state, this)->now;
+}
+
+void VirtualClock::beforeSyscall(S2EExecutionState *state, SyscallCtx &syscall) {
+    if (!isEnabled(syscall.nr)) {
+        return;
+    }
+
+    g_crax->setCurrentState(state);
+    uint64_t ns = 0;
+
+    switch (syscall.nr) {
+        // int nanosleep(const struct timespec *req, struct timespec *rem);
+        case SYS_NANOSLEEP:
+            if (!readDuration(syscall.arg1, /*isTimeval=*/false, ns)) {
+                return;
+            }
+            g_crax->getModuleState(state, this)->now = addSaturated(getTime(state), ns);
+            skipSyscall();
+            break;
+
+        // int clock_nanosleep(clockid_t clockid, int flags,
+        //                     const struct timespec *request,
+        //                     struct timespec *remain);
+        case SYS_CLOCK_NANOSLEEP:
+            // An absolute deadline is relative to a clock we don't know.
+            if ((syscall.arg2 & TIMER_ABSTIME) ||
+                !readDuration(syscall.arg3, /*isTimeval=*/false, ns)) {
+                return;
+            }
+            g_crax->getModuleState(state, this)->now = addSaturated(getTime(state), ns);
+            skipSyscall();
+            break;
+
+        // unsigned int alarm(unsigned int seconds);
+        case SYS_ALARM: {
+            auto modState = g_crax->getModuleState(state, this);
+            uint64_t seconds = static_cast<uint32_t>(syscall.arg1);
+
+            modState->alarmRemaining = (modState->alarmDeadline > modState->now)
+                ? (modState->alarmDeadline - modState->now + s_nsPerSec - 1) / s_nsPerSec
+                : 0;
+            modState->alarmDeadline = seconds ? addSaturated(modState->now, seconds * s_nsPerSec) : 0;
+            skipSyscall();
+            break;
+        }
+
+        // int select(int nfds, fd_set *readfds, fd_set *writefds,
+        //            fd_set *exceptfds, struct timeval *timeout);
+        case SYS_SELECT:
+            // A null timeout waits for the fds forever.
+            if (!syscall.arg5 || !readDuration(syscall.arg5, /*isTimeval=*/true, ns) || !ns) {
+                return;
+            }
+            // Poll the fds instead, the kernel updates the timeout anyway.
+            mem().writeConcrete(syscall.arg5, std::vector<uint8_t>(2 * sizeof(uint64_t)));
+            g_crax->getModuleState(state, this)->pendingTimeout = ns;
+            break;
+
+        default:
+            return;
+    }
+
+    log<INFO>() << "Fast-forwarded syscall " << syscall.nr
+                << ", virtual time: " << g_crax->getConstModuleState(state, this)->now << " ns\n";
+}
+
+void VirtualClock::afterSyscall(S2EExecutionState *state, const SyscallCtx &syscall) {
+    if (!isEnabled(syscall.nr)) {
+        return;
+    }
+
+    g_crax->setCurrentState(state);
+
+    switch (syscall.nr) {
+        case SYS_ALARM: {
+            uint64_t remaining = g_crax->getConstModuleState(state, this)->alarmRemaining;
+            reg().writeConcrete(Register::X64::RAX, remaining, /*verbose=*/false);
+            break;
+        }
+
+        case SYS_SELECT:
+            if (g_crax->getConstModuleState(state, this)->pendingTimeout) {
+                auto modState = g_crax->getModuleState(state, this);
+
+                // Nothing became ready, so the whole timeout has elapsed.
+                if (syscall.ret == 0) {
+                    modState->now = addSaturated(modState->now, modState->pendingTimeout);
+                }
+                modState->pendingTimeout = 0;
+            }
+            break;
+
+        // time_t time(time_t *tloc);
+        case SYS_TIME: {
+            if (static_cast<int64_t>(syscall.ret) < 0 || !getTime(state)) {
+                break;
+            }
+            uint64_t t = syscall.ret + getTime(state) / s_nsPerSec;
+            reg().writeConcrete(Register::X64::RAX, t, /*verbose=*/false);
+            if (syscall.arg1) {
+                mem().writeConcrete(syscall.arg1, p64(t));
+            }
+            break;
+        }
+
+        // int gettimeofday(struct timeval *tv, struct timezone *tz);
+        case SYS_GETTIMEOFDAY:
+            if (syscall.ret == 0 && syscall.arg1 && getTime(state)) {
+                advanceTime(syscall.arg1, /*isTimeval=*/true, getTime(state));
+            }
+            break;
+
+        // int clock_gettime(clockid_t clockid, struct timespec *tp);
+        case SYS_CLOCK_GETTIME:
+            // The CPU-time clocks don't advance while the target sleeps.
+            if (syscall.ret == 0 && syscall.arg2 && getTime(state) &&
+                syscall.arg1 != CLOCK_PROCESS_CPUTIME_ID &&
+                syscall.arg1 != CLOCK_THREAD_CPUTIME_ID) {
+                advanceTime(syscall.arg2, /*isTimeval=*/false, getTime(state));
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool VirtualClock::readDuration(uint64_t addr, bool isTimeval, uint64_t &ns) {
+    // struct timespec { time_t tv_sec; long tv_nsec; };
+    // struct timeval  { time_t tv_sec; suseconds_t tv_usec; };
+    static constexpr uint64_t size = 2 * sizeof(uint64_t);
+
+    // Concretizing a symbolic duration would constrain the input,
+    // so let the target sleep for real instead.
+    if (mem().isSymbolic(addr, size)) {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes = mem().readConcrete(addr, size, /*concretize=*/false);
+
+    if (bytes.size() != size) {
+        return false;
+    }
+
+    auto fields = reinterpret_cast<const int64_t *>(bytes.data());
+    uint64_t unit = isTimeval ? 1000 : 1;
+
+    // Compare without multiplying, which may overflow.
+    if (fields[0] < 0 || fields[1] < 0 || static_cast<uint64_t>(fields[1]) >= s_nsPerSec / unit) {
+        return false;  // let the kernel return EINVAL
+    }
+
+    uint64_t sec = fields[0];
+    uint64_t subsec = fields[1] * unit;
+
+    ns = (sec > (UINT64_MAX - subsec) / s_nsPerSec) ? UINT64_MAX : sec * s_nsPerSec + subsec;
+    return true;
+}
+
+void VirtualClock::advanceTime(uint64_t addr, bool isTimeval, uint64_t ns) {
+    std::vector<uint8_t> bytes = mem().readConcrete(addr, 2 * sizeof(uint64_t), /*concretize=*/false);
+
+    if (bytes.size() != 2 * sizeof(uint64_t)) {
+        return;
+    }
+
+    auto fields = reinterpret_cast<int64_t *>(bytes.data());
+    uint64_t unit = isTimeval ? 1000 : 1;
+    uint64_t subsec = fields[1] * unit + ns % s_nsPerSec;
+
+    fields[0] += ns / s_nsPerSec + subsec / s_nsPerSec;
+    fields[1] = (subsec % s_nsPerSec) / unit;
+
+    mem().writeConcrete(addr, bytes);
+}
+
+void VirtualClock::skipSyscall() {
+    // sched_yield() always returns 0, which is also what
+    // the sleeps return when they aren't interrupted.
+    reg().writeConcrete(Register::X64::RAX, SYS_SCHED_YIELD, /*verbose=*/false);
+}
+
+bool VirtualClock::isEnabled(uint64_t nr) const {
+    return std::find(m_syscalls.begin(), m_syscalls.end(), nr) != m_syscalls.end();
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,130 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef S2E_PLUGINS_CRAX_VIRTUAL_CLOCK_H
+#define S2E_PLUGINS_CRAX_VIRTUAL_CLOCK_H
+
+#include <s2e/S2EExecutionState.h>
+#include <s2e/Plugins/CRAX/API/Disassembler.h>
+#include <s2e/Plugins/CRAX/Modules/Module.h>
+
+#include <string>
+#include <vector>
+
+namespace s2e::plugins::crax {
+
+// Sleeping in the guest wastes real time, since the guest is emulated
+// and the target doesn't run any faster while it sleeps. This module
+// completes sleeps immediately and advances a per-state virtual clock
+// by their durations instead:
+//
+//   nanosleep(), clock_nanosleep()  - turned into sched_yield()
+//   alarm()                         - never delivers SIGALRM, but returns
+//                                     the remaining seconds of the
+//                                     previous alarm in virtual time
+//   select()                        - the timeout is zeroed, and the
+//                                     virtual clock advances by it if
+//                                     select() times out
+//
+// The time returned by time(), gettimeofday() and clock_gettime()
+// (except for the CPU-time clocks) is advanced by the virtual clock,
+// so the target sees its sleeps take as long as they would natively.
+//
+// The syscall contexts seen by the other modules are left intact, so
+// IOStates still records SleepStateInfo and the generated exploits
+// still sleep for as long as the target did. Sleeps with a symbolic
+// duration are left to the kernel.
+//
+// Time read via the vDSO, which glibc uses for the time queries above,
+// never reaches the kernel and thus isn't adjusted. Boot the guest
+// kernel with `vdso=0` to make them syscalls.
+//
+// Config:
+//   modulesConfig.VirtualClock = {
+//       syscalls = { "nanosleep", "clock_nanosleep", "alarm", "select",
+//                    "time", "gettimeofday", "clock_gettime" },
+//   }
+//
+// All the supported syscalls are fast-forwarded if `syscalls` is empty.
+
+class VirtualClock : public Module {
+public:
+    class State : public ModuleState {
+    public:
+        State()
+            : ModuleState(),
+              now(),
+              alarmDeadline(),
+              alarmRemaining(),
+              pendingTimeout() {}
+
+        virtual ~State() override = default;
+
+        static ModuleState *factory(Module *, CRAXState *) {
+            return new State();
+        }
+
+        virtual ModuleState *clone() const override {
+            return new State(*this);
+        }
+
+        uint64_t now;             // ns slept so far
+        uint64_t alarmDeadline;   // in virtual ns, 0 if no alarm is set
+        uint64_t alarmRemaining;  // the return value of the ongoing alarm()
+        uint64_t pendingTimeout;  // ns of the ongoing select()
+    };
+
+
+    VirtualClock();
+    virtual ~VirtualClock() override = default;
+
+    virtual std::string toString() const override { return "VirtualClock"; }
+
+    // The virtual time elapsed in `state`, in nanoseconds.
+    [[nodiscard]]
+    uint64_t getTime(S2EExecutionState *state) const;
+
+private:
+    void beforeSyscall(S2EExecutionState *state, SyscallCtx &syscall);
+    void afterSyscall(S2EExecutionState *state, const SyscallCtx &syscall);
+
+    // Reads a timespec (or a timeval if `isTimeval`) from the guest in ns,
+    // saturating at UINT64_MAX. Fails if it's symbolic or invalid.
+    [[nodiscard]]
+    static bool readDuration(uint64_t addr, bool isTimeval, uint64_t &ns);
+
+    // Advances the timespec (or the timeval if `isTimeval`) at `addr`,
+    // which the kernel has just written, by `ns`.
+    static void advanceTime(uint64_t addr, bool isTimeval, uint64_t ns);
+
+    // Makes the kernel return right away instead of serving `syscall`.
+    static void skipSyscall();
+
+    [[nodiscard]]
+    bool isEnabled(uint64_t nr) const;
+
+
+    std::vector<uint64_t> m_syscalls;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_VIRTUAL_CLOCK_H
@@ -36,6 +36,8 @@
 
 namespace s2e::plugins::crax {
 
+std::atomic<uint64_t> ELF::s_baseEpoch(0);
+
 ELF::ELF(const std::string &filename)
     : checksec(filename),
       m_elf(CRAX::s_pwnlib.attr("elf").attr("ELF").call(filename)),
@@ -85,14 +87,22 @@ ELF::FunctionMap ELF::buildFunctionMap() {
 
 
 uint64_t ELF::getRuntimeAddress(uint64_t offset) const {
-    assert((!checksec.hasPIE || m_base) && "PIE enabled, but `m_base` uninitialized!");
-    return (!checksec.hasPIE) ? offset : m_base + offset;
+    return getRuntimeAddress(offset, m_base);
 }
 
 uint64_t ELF::getRuntimeAddress(const std::string &symbol) const {
     return getRuntimeAddress(symbols().at(symbol));
 }
 
+uint64_t ELF::getRuntimeAddress(uint64_t offset, uint64_t base) const {
+    assert((!checksec.hasPIE || base) && "PIE enabled, but `base` uninitialized!");
+    return (!checksec.hasPIE) ? offset : base + offset;
+}
+
+uint64_t ELF::getRuntimeAddress(const std::string &symbol, uint64_t base) const {
+    return getRuntimeAddress(symbols().at(symbol), base);
+}
+
 uint64_t ELF::rebaseAddress(uint64_t address, uint64_t newBase) const {
     assert(address >= m_base);
     return newBase + address - m_base;
@@ -134,11 +144,15 @@ std::string ELF::getBelongingSymbol(uint64_t offset) const {
 }
 
 bool ELF::isCallSiteOf(const Instruction &i, const std::string &symbol) const {
+    return isCallSiteOf(i, symbol, m_base);
+}
+
+bool ELF::isCallSiteOf(const Instruction &i, const std::string &symbol, uint64_t base) const {
     if (i.mnemonic != "call" || !hasSymbol(symbol)) {
         return false;
     }
 
-    const uint64_t addr = getRuntimeAddress(symbol);
+    const uint64_t addr = getRuntimeAddress(symbol, base);
     uint64_t operand = 0;
     try {
         operand = std::stoull(i.opStr, nullptr, 16);
@@ -154,6 +168,13 @@ uint64_t ELF::bss() const {
     return m_elf.attr("bss").call().cast<uint64_t>();
 }
 
+void ELF::setBase(uint64_t base) {
+    if (m_base != base) {
+        m_base = base;
+        s_baseEpoch.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
 const Exploit &ELF::getExploit() const {
     return g_crax->getExploit();
 }
@@ -26,6 +26,7 @@
 
 #include <pybind11/embed.h>
 
+#include <atomic>
 #include <map>
 #include <string>
 
@@ -56,6 +57,12 @@ public:
     std::string getBelongingSymbol(uint64_t instructionAddr) const;
     bool isCallSiteOf(const Instruction &i, const std::string &symbol) const;
 
+    // Same as above, but relative to `base` instead of getBase(),
+    // e.g., the ELF base of a specific state (see CRAX::getElfBase()).
+    uint64_t getRuntimeAddress(uint64_t offset, uint64_t base) const;
+    uint64_t getRuntimeAddress(const std::string &symbol, uint64_t base) const;
+    bool isCallSiteOf(const Instruction &i, const std::string &symbol, uint64_t base) const;
+
     inline bool hasSymbol(const std::string &symbol) const {
         return m_symbols.find(symbol) != m_symbols.end();
     }
@@ -70,7 +77,7 @@ public:
     const std::string &getFilename() const { return m_filename; }
     const std::string &getVarPrefix() const { return m_varPrefix; }
     uint64_t getBase() const { return m_base; }
-    void setBase(uint64_t base) { m_base = base; }
+    void setBase(uint64_t base);
 
     const Exploit &getExploit() const;
 
@@ -78,6 +85,10 @@ public:
         return 0x400000;
     }
 
+    // Bumped whenever the base of any ELF changes, so that anything
+    // computed from the bases (e.g., evaluated exprs) can be invalidated.
+    static uint64_t getBaseEpoch() { return s_baseEpoch.load(std::memory_order_relaxed); }
+
     const Checksec checksec;
 
 private:
@@ -94,6 +105,8 @@ private:
     std::string m_filename;
     std::string m_varPrefix;
     uint64_t m_base;
+
+    static std::atomic<uint64_t> s_baseEpoch;
 };
 
 }  // namespace s2e::plugins::crax
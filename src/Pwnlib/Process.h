@@ -42,6 +42,10 @@ public:
 
     Argv &getArgv() { return m_argv; }
     Env &getEnv() { return m_env; }
+    const Argv &getArgv() const { return m_argv; }
+    const Env &getEnv() const { return m_env; }
+    const std::string &getDestAddr() const { return m_destAddr; }
+    int getDestPort() const { return m_destPort; }
     bool isAslrEnabled() const { return m_isAslrEnabled; }
     bool isRemoteMode() const { return m_isRemoteMode; }
     bool isTcp() const { return m_isTcp; }
@@ -0,0 +1,158 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/Plugins/CRAX/Exploit.h>
+#include <s2e/Plugins/CRAX/Expr/Expr.h>
+#include <s2e/Plugins/CRAX/Utils/StringUtil.h>
+#include <s2e/Plugins/CRAX/Utils/VariantOverload.h>
+
+#include <cctype>
+
+#include "CraxRenderer.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+std::string CraxRenderer::render(const Exploit &exploit) const {
+    std::vector<std::string> lines;
+
+    auto toHex = [](const auto &bytes) {
+        return toHexString(bytes.begin(), bytes.end());
+    };
+
+    lines.push_back(format("crax %d", s_version));
+
+    for (const auto &[name, value] : exploit.getSymtab()) {
+        lines.push_back(format("set %s 0x%llx", name.c_str(), value));
+    }
+
+    auto visitor = overload {
+        [&lines](const ExploitIR::Comment &action) {
+            lines.push_back(action.text.size() ? "# " + action.text : "");
+        },
+        [&lines, &exploit](const ExploitIR::Spawn &) {
+            const Process &process = exploit.getProcess();
+
+            if (process.isRemoteMode()) {
+                lines.push_back(format("connect %s %d", escape(process.getDestAddr()).c_str(),
+                                                        process.getDestPort()));
+                return;
+            }
+
+            std::string argv = "argv";
+            for (const auto &arg : process.getArgv()) {
+                argv += ' ' + escape(fromPythonLiteral(arg));
+            }
+            lines.push_back(argv);
+
+            for (const auto &[key, value] : process.getEnv()) {
+                lines.push_back("env " + escape(fromPythonLiteral(key)) +
+                                ' ' + escape(fromPythonLiteral(value)));
+            }
+
+            lines.push_back(format("aslr %d", process.isAslrEnabled()));
+            lines.push_back("spawn");
+        },
+        [&lines, &toHex](const ExploitIR::Stage1 &action) {
+            // The runner cannot re-run S2E to solve stage1.
+            if (action.isSolvedAtExploitTime) {
+                lines.push_back("unsupported " + escape("stage1 must be solved at exploitation time"));
+                return;
+            }
+            lines.push_back("stage1 " + toHex(ExploitIR::slice(action)));
+        },
+        [&lines](const ExploitIR::SendStage1 &action) {
+            lines.push_back("send @payload");
+            if (action.isLineTerminated) {
+                lines.push_back("send 0a");
+            }
+        },
+        [&lines, &toHex](const ExploitIR::Send &action) {
+            if (action.bytes.size()) {
+                lines.push_back("send " + toHex(action.bytes));
+            }
+        },
+        [&lines](const ExploitIR::Recv &action) {
+            lines.push_back(format("recv %llu", action.len));
+        },
+        [&lines, &toHex](const ExploitIR::RecvUntil &action) {
+            lines.push_back("recvuntil " + toHex(action.delim));
+        },
+        [&lines](const ExploitIR::RecvAtMost &action) {
+            lines.push_back(format("recvatmost %llu", action.len));
+        },
+        [&lines](const ExploitIR::Drain &) {
+            lines.push_back("drain");
+        },
+        [&lines, &toHex](const ExploitIR::Leak &action) {
+            std::string prefix = action.prefix.size() ? toHex(action.prefix) : "-";
+            lines.push_back(format("leak %s %llu %s 0x%llx", action.var.c_str(),
+                                                             action.len,
+                                                             prefix.c_str(),
+                                                             action.offset));
+        },
+        [&lines, &toHex](const ExploitIR::Payload &action) {
+            for (const ref<Expr> &e : action.exprs) {
+                if (auto bve = dyn_cast<ByteVectorExpr>(e)) {
+                    if (bve->getBytes().size()) {
+                        lines.push_back("push " + toHex(bve->getBytes()));
+                    }
+                } else if (auto tokens = ExploitIR::toPostfix(e)) {
+                    lines.push_back("push64 " + join(*tokens, " "));
+                } else {
+                    lines.push_back("unsupported " + escape("payload expr cannot be converted to postfix"));
+                    return;
+                }
+            }
+            lines.push_back(action.isLineTerminated ? "flushline" : "flush");
+        },
+        [&lines](const ExploitIR::Sleep &action) {
+            lines.push_back(format("sleep %llu", action.sec * 1000));
+        },
+        [&lines](const ExploitIR::Shell &) {
+            lines.push_back("shell");
+        }
+    };
+
+    for (const auto &action : exploit.getIR().getActions()) {
+        std::visit(visitor, action);
+    }
+    return join(lines, "\n") + '\n';
+}
+
+std::string CraxRenderer::getFilename(const std::string &id) const {
+    return "exploit_" + id + ".crax";
+}
+
+std::string CraxRenderer::escape(const std::string &s) {
+    std::string ret;
+
+    for (auto c : s) {
+        if (std::isgraph(static_cast<unsigned char>(c)) && c != '\\') {
+            ret += c;
+        } else {
+            ret += format("\\x%02x", static_cast<uint8_t>(c));
+        }
+    }
+    return ret;
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,78 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_CRAX_RENDERER_H
+#define S2E_PLUGINS_CRAX_CRAX_RENDERER_H
+
+#include <s2e/Plugins/CRAX/Renderers/ExploitRenderer.h>
+
+namespace s2e::plugins::crax {
+
+// Renders an exploit as a language-neutral description (exploit_<id>.crax),
+// which is executed by tools/crax-runner.
+//
+// Each line is an operation followed by space-separated operands. Byte strings
+// are hex-encoded, and string operands escape whitespace, '\' and unprintable
+// characters as \xNN. Lines starting with '#' are comments.
+//
+//   crax <version>                 header
+//   set <var> <value>              declare a variable (e.g. target_base, pivot_dest)
+//   stage1 <hex>                   define the stage 1 payload, referred to as @payload
+//   argv <str|@payload>...         argv of the target process
+//   env <key> <str|@payload>       an environment variable of the target process
+//   aslr <0|1>                     whether ASLR is enabled for the target process
+//   spawn                          start the target process locally
+//   connect <host> <port>          connect to the target via TCP
+//   send <hex|@payload>            send bytes immediately
+//   push <hex>                     append bytes to the pending payload
+//   push64 <postfix expr>...       append p64() of a postfix expr, e.g. "target_base 0x1040 +"
+//   flush / flushline              send the pending payload (followed by '\n')
+//   recv <n>                       receive and discard exactly n bytes
+//   recvuntil <delim>              receive and discard bytes until delim
+//   recvatmost <n>                 receive and discard at most n bytes
+//   drain                          discard whatever has been received so far
+//   leak <var> <n> <prefix|-> <offset>
+//                                  var = u64(prefix + recv(n)) - offset
+//   sleep <ms>                     sleep for the given milliseconds
+//   unsupported <reason>           this exploit cannot be run natively
+//   shell                          the target should be running a shell now
+class CraxRenderer : public ExploitRenderer {
+public:
+    CraxRenderer() = default;
+    virtual ~CraxRenderer() override = default;
+
+    [[nodiscard]]
+    virtual std::string render(const Exploit &exploit) const override;
+
+    [[nodiscard]]
+    virtual std::string getFilename(const std::string &id) const override;
+
+    [[nodiscard]]
+    virtual std::string toString() const override { return "crax"; }
+
+    static constexpr int s_version = 1;
+
+private:
+    static std::string escape(const std::string &s);
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_CRAX_RENDERER_H
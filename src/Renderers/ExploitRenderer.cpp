@@ -0,0 +1,53 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/Plugins/CRAX/Renderers/CraxRenderer.h>
+#include <s2e/Plugins/CRAX/Renderers/JsonRenderer.h>
+#include <s2e/Plugins/CRAX/Renderers/PwntoolsRenderer.h>
+
+#include <cassert>
+
+#include "ExploitRenderer.h"
+
+namespace s2e::plugins::crax {
+
+std::unique_ptr<ExploitRenderer> ExploitRenderer::create(const std::string &name) {
+    std::unique_ptr<ExploitRenderer> ret;
+
+    if (name == "pwntools") {
+        ret = std::make_unique<PwntoolsRenderer>();
+    } else if (name == "crax") {
+        ret = std::make_unique<CraxRenderer>();
+    } else if (name == "json") {
+        ret = std::make_unique<JsonRenderer>();
+    }
+
+    assert(ret && "ExploitRenderer::create() failed, incorrect format name given in config?");
+    return ret;
+}
+
+std::string ExploitRenderer::fromPythonLiteral(const std::string &s) {
+    if (s.size() >= 2 && s.front() == '\'' && s.back() == '\'') {
+        return s.substr(1, s.size() - 2);
+    }
+    return '@' + s;
+}
+
+}  // namespace s2e::plugins::crax
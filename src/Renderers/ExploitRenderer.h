@@ -0,0 +1,61 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_EXPLOIT_RENDERER_H
+#define S2E_PLUGINS_CRAX_EXPLOIT_RENDERER_H
+
+#include <memory>
+#include <string>
+
+namespace s2e::plugins::crax {
+
+// Forward declaration
+class Exploit;
+
+// An ExploitRenderer turns the IR of an exploit (see ExploitIR.h), its symbol
+// table and its target process into a concrete exploit format.
+// To add your own renderer, make your class derive from ExploitRenderer,
+// and add it to ExploitRenderer::create().
+class ExploitRenderer {
+public:
+    virtual ~ExploitRenderer() = default;
+
+    [[nodiscard]]
+    virtual std::string render(const Exploit &exploit) const = 0;
+
+    // `id` identifies the state for which the exploit was generated,
+    // see ExploitGenerator::getArtifactId().
+    [[nodiscard]]
+    virtual std::string getFilename(const std::string &id) const = 0;
+
+    [[nodiscard]]
+    virtual std::string toString() const = 0;
+
+    static std::unique_ptr<ExploitRenderer> create(const std::string &name);
+
+protected:
+    // Process stores argv and env as python literals, so this converts
+    // them back, e.g., "'./target'" -> "./target", "payload" -> "@payload".
+    static std::string fromPythonLiteral(const std::string &s);
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_EXPLOIT_RENDERER_H
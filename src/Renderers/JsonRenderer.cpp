@@ -0,0 +1,178 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/Plugins/CRAX/Exploit.h>
+#include <s2e/Plugins/CRAX/Expr/Expr.h>
+#include <s2e/Plugins/CRAX/Utils/StringUtil.h>
+#include <s2e/Plugins/CRAX/Utils/VariantOverload.h>
+
+#include "JsonRenderer.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+std::string JsonRenderer::render(const Exploit &exploit) const {
+    const Process &process = exploit.getProcess();
+    std::vector<std::string> symbols;
+    std::vector<std::string> actions;
+    std::string strProcess;
+
+    auto toHex = [](const auto &bytes) {
+        return quote(toHexString(bytes.begin(), bytes.end()));
+    };
+
+    for (const auto &[name, value] : exploit.getSymtab()) {
+        symbols.push_back(format("%s: \"0x%llx\"", quote(name).c_str(), value));
+    }
+
+    if (process.isRemoteMode()) {
+        strProcess = format("{ \"host\": %s, \"port\": %d, \"protocol\": \"%s\" }",
+                            quote(process.getDestAddr()).c_str(),
+                            process.getDestPort(),
+                            process.isTcp() ? "tcp" : "udp");
+    } else {
+        std::vector<std::string> argv;
+        std::vector<std::string> env;
+
+        for (const auto &arg : process.getArgv()) {
+            argv.push_back(quote(fromPythonLiteral(arg)));
+        }
+        for (const auto &[key, value] : process.getEnv()) {
+            env.push_back(quote(fromPythonLiteral(key)) + ": " + quote(fromPythonLiteral(value)));
+        }
+
+        strProcess = format("{ \"argv\": [%s], \"env\": { %s }, \"aslr\": %s }",
+                            join(argv, ", ").c_str(),
+                            join(env, ", ").c_str(),
+                            process.isAslrEnabled() ? "true" : "false");
+    }
+
+    auto visitor = overload {
+        [&actions](const ExploitIR::Comment &action) {
+            if (action.text.size()) {
+                actions.push_back("{ \"op\": \"comment\", \"text\": " + quote(action.text) + " }");
+            }
+        },
+        [&actions](const ExploitIR::Spawn &) {
+            actions.push_back("{ \"op\": \"spawn\" }");
+        },
+        [&actions, &toHex](const ExploitIR::Stage1 &action) {
+            std::string what = action.isSolvedAtExploitTime
+                ? "\"solve\": " + quote(action.ioStates)
+                : "\"bytes\": " + toHex(action.bytes);
+
+            actions.push_back(format("{ \"op\": \"stage1\", %s, \"begin\": %llu, \"end\": %llu }",
+                                     what.c_str(), action.begin, action.end));
+        },
+        [&actions](const ExploitIR::SendStage1 &action) {
+            actions.push_back(format("{ \"op\": \"sendStage1\", \"line\": %s }",
+                                     action.isLineTerminated ? "true" : "false"));
+        },
+        [&actions, &toHex](const ExploitIR::Send &action) {
+            actions.push_back("{ \"op\": \"send\", \"bytes\": " + toHex(action.bytes) + " }");
+        },
+        [&actions](const ExploitIR::Recv &action) {
+            actions.push_back(format("{ \"op\": \"recv\", \"len\": %llu }", action.len));
+        },
+        [&actions, &toHex](const ExploitIR::RecvUntil &action) {
+            actions.push_back("{ \"op\": \"recvuntil\", \"delim\": " + toHex(action.delim) + " }");
+        },
+        [&actions](const ExploitIR::RecvAtMost &action) {
+            actions.push_back(format("{ \"op\": \"recvatmost\", \"len\": %llu }", action.len));
+        },
+        [&actions](const ExploitIR::Drain &) {
+            actions.push_back("{ \"op\": \"drain\" }");
+        },
+        [&actions, &toHex](const ExploitIR::Leak &action) {
+            actions.push_back(format("{ \"op\": \"leak\", \"var\": %s, \"len\": %llu, "
+                                     "\"prefix\": %s, \"offset\": \"0x%llx\" }",
+                                     quote(action.var).c_str(),
+                                     action.len,
+                                     toHex(action.prefix).c_str(),
+                                     action.offset));
+        },
+        [&actions, &toHex](const ExploitIR::Payload &action) {
+            std::vector<std::string> segments;
+
+            for (const ref<Expr> &e : action.exprs) {
+                if (auto bve = dyn_cast<ByteVectorExpr>(e)) {
+                    segments.push_back("{ \"bytes\": " + toHex(bve->getBytes()) + " }");
+                } else if (auto postfix = ExploitIR::toPostfix(e)) {
+                    std::vector<std::string> tokens;
+                    for (const auto &token : *postfix) {
+                        tokens.push_back(quote(token));
+                    }
+                    segments.push_back("{ \"p64\": [" + join(tokens, ", ") + "] }");
+                } else {
+                    actions.push_back("{ \"op\": \"unsupported\", \"reason\": "
+                                      "\"payload expr cannot be converted to postfix\" }");
+                    return;
+                }
+            }
+
+            actions.push_back(format("{ \"op\": \"payload\", \"line\": %s, \"segments\": [%s] }",
+                                     action.isLineTerminated ? "true" : "false",
+                                     join(segments, ", ").c_str()));
+        },
+        [&actions](const ExploitIR::Sleep &action) {
+            actions.push_back(format("{ \"op\": \"sleep\", \"sec\": %llu }", action.sec));
+        },
+        [&actions](const ExploitIR::Shell &) {
+            actions.push_back("{ \"op\": \"shell\" }");
+        }
+    };
+
+    for (const auto &action : exploit.getIR().getActions()) {
+        std::visit(visitor, action);
+    }
+
+    // One action per line, so that exploits can be diffed line by line.
+    std::string ret;
+    ret += "{\n";
+    ret += format("  \"version\": %d,\n", s_version);
+    ret += "  \"symbols\": {\n    " + join(symbols, ",\n    ") + "\n  },\n";
+    ret += "  \"process\": " + strProcess + ",\n";
+    ret += "  \"actions\": [\n    " + join(actions, ",\n    ") + "\n  ]\n";
+    ret += "}\n";
+    return ret;
+}
+
+std::string JsonRenderer::getFilename(const std::string &id) const {
+    return "exploit_" + id + ".json";
+}
+
+std::string JsonRenderer::quote(const std::string &s) {
+    std::string ret = "\"";
+
+    for (auto c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+            ret += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            ret += format("\\u%04x", static_cast<uint8_t>(c));
+        } else {
+            ret += c;
+        }
+    }
+    return ret + '"';
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,80 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_JSON_RENDERER_H
+#define S2E_PLUGINS_CRAX_JSON_RENDERER_H
+
+#include <s2e/Plugins/CRAX/Renderers/ExploitRenderer.h>
+
+namespace s2e::plugins::crax {
+
+// Renders an exploit as JSON (exploit_<id>.json), so that batch tools can
+// consume the IR without parsing python. Integers that may exceed 2^53
+// (addresses, offsets) are hex strings, and byte strings are hex-encoded.
+//
+//   {
+//     "version": 1,
+//     "symbols": { "<name>": "0x...", ... },
+//     "process": { "argv": [...], "env": { ... }, "aslr": true }
+//              | { "host": "...", "port": 1234, "protocol": "tcp" },
+//     "actions": [
+//       { "op": "comment", "text": "..." },
+//       { "op": "spawn" },
+//       { "op": "stage1", "bytes": "<hex>", "begin": 0, "end": 0 },
+//       { "op": "stage1", "solve": "<iostates>", "begin": 0, "end": 0 },
+//       { "op": "sendStage1", "line": false },
+//       { "op": "send", "bytes": "<hex>" },
+//       { "op": "recv", "len": 8 },
+//       { "op": "recvuntil", "delim": "<hex>" },
+//       { "op": "recvatmost", "len": 8 },
+//       { "op": "drain" },
+//       { "op": "leak", "var": "canary", "len": 7, "prefix": "00", "offset": "0x0" },
+//       { "op": "payload", "line": false, "segments": [ { "bytes": "<hex>" },
+//                                                      { "p64": ["target_base", "0x1040", "+"] } ] },
+//       { "op": "sleep", "sec": 1 },
+//       { "op": "unsupported", "reason": "..." },
+//       { "op": "shell" }
+//     ]
+//   }
+//
+// In argv and env, "@payload" refers to the stage 1 payload.
+class JsonRenderer : public ExploitRenderer {
+public:
+    JsonRenderer() = default;
+    virtual ~JsonRenderer() override = default;
+
+    [[nodiscard]]
+    virtual std::string render(const Exploit &exploit) const override;
+
+    [[nodiscard]]
+    virtual std::string getFilename(const std::string &id) const override;
+
+    [[nodiscard]]
+    virtual std::string toString() const override { return "json"; }
+
+    // Quotes and escapes `s` as a JSON string.
+    static std::string quote(const std::string &s);
+
+    static constexpr int s_version = 1;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_JSON_RENDERER_H
@@ -0,0 +1,180 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <s2e/Plugins/CRAX/Exploit.h>
+#include <s2e/Plugins/CRAX/Expr/BinaryExprEval.h>
+#include <s2e/Plugins/CRAX/Utils/StringUtil.h>
+#include <s2e/Plugins/CRAX/Utils/VariantOverload.h>
+
+#include "PwntoolsRenderer.h"
+
+using namespace klee;
+
+namespace s2e::plugins::crax {
+
+std::string PwntoolsRenderer::render(const Exploit &exploit) const {
+    const ELF &elf = exploit.getElf();
+    const ELF &libc = exploit.getLibc();
+    const std::string &elfPrefix = elf.getVarPrefix();
+    const std::string &libcPrefix = libc.getVarPrefix();
+    Script script;
+
+    // Write exploit shebang.
+    script.writeline("#!/usr/bin/env python3");
+
+    // Pwntools stuff.
+    script.writelines({
+        "from pwn import *",
+        "context.update(arch = 'amd64', os = 'linux', log_level = 'info')",
+        "",
+    });
+
+    // A self-contained script doesn't need to parse the ELF files at runtime,
+    // since all the symbols it refers to are declared in its symbol table.
+    if (!exploit.isSelfContained()) {
+        script.writelines({
+            format("%s = ELF('%s', checksec=False)", elfPrefix.c_str(), elf.getFilename().c_str()),
+            format("%s = ELF('%s', checksec=False)", libcPrefix.c_str(), libc.getFilename().c_str()),
+            ""
+        });
+    }
+
+    // Declare symbols and values.
+    for (const auto &[name, value] : exploit.getSymtab()) {
+        script.writeline(format("%s = 0x%llx", name.c_str(), value));
+    }
+
+    script.writeline();
+
+    // Define solve_stage1() function.
+    if (elf.checksec.hasCanary || elf.checksec.hasPIE) {
+        script.writeline("def solve_stage1(canary, elf_base, iostates) -> bytes:");
+        script.setIndentLevel(4);
+        script.writelines({
+            "os.system('./launch-crax.sh -c \"{}\" -e \"{}\" -s \"{}\"'"
+            ".format(hex(canary), hex(elf_base), iostates))",
+            "with open('stage1.bin', 'rb') as f:",
+            "    return f.read()",
+        });
+        script.setIndentLevel(0);
+        script.writeline();
+    }
+
+    // Generate the main function.
+    script.writeline("if __name__ == '__main__':");
+    script.setIndentLevel(4);
+
+    auto visitor = overload {
+        [&script](const ExploitIR::Comment &action) {
+            script.writeline(action.text.size() ? "# " + action.text : "");
+        },
+        [&script, &exploit](const ExploitIR::Spawn &) {
+            script.writeline(exploit.getProcess().toDeclStmt());
+        },
+        [&script, &elfPrefix](const ExploitIR::Stage1 &action) {
+            std::string s;
+
+            if (!action.isSolvedAtExploitTime) {
+                s = toByteString(action.bytes.begin(), action.bytes.end());
+            } else {
+                s = format("solve_stage1(canary, %s_base, '%s')", elfPrefix.c_str(),
+                                                                  action.ioStates.c_str());
+            }
+
+            if (action.begin || action.end) {
+                s += '[';
+                s += action.begin ? std::to_string(action.begin) : "";
+                s += ':';
+                s += action.end ? std::to_string(action.end) : "";
+                s += ']';
+            }
+            script.writeline("payload  = " + s);
+        },
+        [&script](const ExploitIR::SendStage1 &action) {
+            script.writelines({
+                action.isLineTerminated ? "proc.sendline(payload)" : "proc.send(payload)",
+                "time.sleep(0.2)",
+            });
+        },
+        [&script](const ExploitIR::Send &action) {
+            std::string byteString = toByteString(action.bytes.begin(), action.bytes.end());
+            script.writeline(format("proc.send(%s)", byteString.c_str()));
+        },
+        [&script](const ExploitIR::Recv &action) {
+            script.writeline(format("proc.recvn(%llu)", action.len));
+        },
+        [&script](const ExploitIR::RecvUntil &action) {
+            std::string delimStr = toByteString(action.delim.begin(), action.delim.end());
+            script.writeline(format("proc.recvuntil(%s)", delimStr.c_str()));
+        },
+        [&script](const ExploitIR::RecvAtMost &action) {
+            script.writeline(format("proc.recv(%llu)", action.len));
+        },
+        [&script](const ExploitIR::Drain &) {
+            script.writelines({ "proc.recvrepeat(0)", "" });
+        },
+        [&script](const ExploitIR::Leak &action) {
+            const char *var = action.var.c_str();
+            std::string recvStr = format("proc.recvn(%llu)", action.len);
+
+            if (action.prefix.size()) {
+                std::string prefixStr = toByteString(action.prefix.begin(), action.prefix.end());
+                std::string offsetStr = action.offset ? format(" - 0x%llx", action.offset) : "";
+                script.writeline(format("%s = u64(%s + %s)%s", var, prefixStr.c_str(),
+                                                                 recvStr.c_str(),
+                                                                 offsetStr.c_str()));
+            } else {
+                script.writelines({
+                    format("leaked = u64(%s.ljust(8, b'\\x00'))", recvStr.c_str()),
+                    format("%s = leaked - 0x%llx", var, action.offset),
+                });
+            }
+            script.writeline(format("log.info('leaked %s: {}'.format(hex(%s)))", action.what.c_str(), var));
+        },
+        [&script](const ExploitIR::Payload &action) {
+            for (size_t i = 0; i < action.exprs.size(); i++) {
+                std::string s = evaluate<std::string>(action.exprs[i]);
+                script.writeline(format("payload %s %s", i ? "+=" : " =", s.c_str()));
+            }
+            script.writelines({
+                action.isLineTerminated ? "proc.sendline(payload)" : "proc.send(payload)",
+                "time.sleep(0.2)",
+                "",
+            });
+        },
+        [&script](const ExploitIR::Sleep &action) {
+            script.writeline(format("sleep(%llu)", action.sec));
+        },
+        [&script](const ExploitIR::Shell &) {
+            script.writeline("proc.interactive()");
+        }
+    };
+
+    for (const auto &action : exploit.getIR().getActions()) {
+        std::visit(visitor, action);
+    }
+    return script.getContent();
+}
+
+std::string PwntoolsRenderer::getFilename(const std::string &id) const {
+    return "exploit_" + id + ".py";
+}
+
+}  // namespace s2e::plugins::crax
@@ -0,0 +1,46 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_PWNTOOLS_RENDERER_H
+#define S2E_PLUGINS_CRAX_PWNTOOLS_RENDERER_H
+
+#include <s2e/Plugins/CRAX/Renderers/ExploitRenderer.h>
+
+namespace s2e::plugins::crax {
+
+// Renders an exploit as a python3 script (exploit_<id>.py) using pwntools.
+class PwntoolsRenderer : public ExploitRenderer {
+public:
+    PwntoolsRenderer() = default;
+    virtual ~PwntoolsRenderer() override = default;
+
+    [[nodiscard]]
+    virtual std::string render(const Exploit &exploit) const override;
+
+    [[nodiscard]]
+    virtual std::string getFilename(const std::string &id) const override;
+
+    [[nodiscard]]
+    virtual std::string toString() const override { return "pwntools"; }
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_PWNTOOLS_RENDERER_H
@@ -46,6 +46,9 @@ public:
     // and doResolveGadgets() is blocked until the output cache has been fully built.
     void buildCacheAsync(const std::vector<const ELF *> &elfFiles);
 
+    [[nodiscard]]
+    bool hasBuiltCache() const { return m_hasBuiltRopGadgetOutputCache; }
+
     // Look for an exact match of the gadget specified by `gadgetAsm` within `elf`.
     // If found, then the offset of the gadget will be returned, and zero otherwise.
     uint64_t resolveGadget(const ELF &elf,
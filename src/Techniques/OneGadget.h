@@ -34,6 +34,7 @@ public:
     OneGadget();
     virtual ~OneGadget() override = default;
 
+    virtual bool checkRequirements() const override;
     virtual std::string toString() const override { return "OneGadget"; }
 
     virtual std::vector<RopPayload> getRopPayloadList() const override;
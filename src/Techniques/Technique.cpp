@@ -29,12 +29,13 @@
 
 #include <cassert>
 #include <algorithm>
+#include <thread>
 
 #include "Technique.h"
 
 namespace s2e::plugins::crax {
 
-std::map<std::type_index, Technique*> Technique::s_mapper;
+std::vector<Technique *> Technique::s_techniques;
 
 void Technique::initialize() {
     blockUntilRequiredGadgetsPopulated();
@@ -67,33 +68,62 @@ void Technique::resolveRequiredGadgets() {
     }
 }
 
+void Technique::blockUntilRequiredGadgetsPopulated() const {
+    if (m_hasPopulatedRequiredGadgets) {
+        return;
+    }
+
+    const CancellationToken &token = g_crax->getExploitGenerator().getCancellationToken();
+
+    log<WARN>() << toString() << " is still running, please wait...\n";
+    while (!m_hasPopulatedRequiredGadgets) {
+        token.throwIfCancelled();
+        std::this_thread::yield();
+    }
+}
+
+void Technique::cancel(const std::string &reason) const {
+    std::string what = toString() + ": " + reason;
+
+    g_crax->getExploitGenerator().getCancellationToken().cancel(what);
+    throw CancellationToken::CancelledException(what);
+}
+
 std::string Technique::getConfigKey() const {
     return g_crax->getConfigKey() + ".techniquesConfig." + toString();
 }
 
+template <typename T>
+std::unique_ptr<Technique> Technique::make() {
+    assert(s_id<T> == -1 && "The same technique is loaded twice?");
+
+    std::unique_ptr<Technique> ret = std::make_unique<T>();
+
+    s_id<T> = s_techniques.size();
+    s_techniques.push_back(ret.get());
+    return ret;
+}
+
 std::unique_ptr<Technique> Technique::create(const std::string &name) {
     std::unique_ptr<Technique> ret;
 
     if (name == "GotLeakLibc") {
-        ret = std::make_unique<GotLeakLibc>();
+        ret = make<GotLeakLibc>();
     } else if (name == "OneGadget") {
-        ret = std::make_unique<OneGadget>();
+        ret = make<OneGadget>();
     } else if (name == "AdvancedStackPivoting") {
-        ret = std::make_unique<AdvancedStackPivoting>();
+        ret = make<AdvancedStackPivoting>();
     } else if (name == "BasicStackPivoting") {
-        ret = std::make_unique<BasicStackPivoting>();
+        ret = make<BasicStackPivoting>();
     } else if (name == "Ret2csu") {
-        ret = std::make_unique<Ret2csu>();
+        ret = make<Ret2csu>();
     } else if (name == "Ret2syscall") {
-        ret = std::make_unique<Ret2syscall>();
+        ret = make<Ret2syscall>();
     } else if (name == "Ret2stack") {
-        ret = std::make_unique<Ret2stack>();
+        ret = make<Ret2stack>();
     }
 
     assert(ret && "Technique::create() failed, incorrect technique name given in config?");
-
-    auto &technique = *ret;
-    Technique::s_mapper.insert({typeid(technique), &technique});
     return ret;
 }
 
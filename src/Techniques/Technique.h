@@ -26,11 +26,9 @@
 #include <s2e/Plugins/CRAX/Expr/Expr.h>
 
 #include <atomic>
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
-#include <typeindex>
 
 namespace s2e::plugins::crax {
 
@@ -53,24 +51,39 @@ public:
     virtual std::vector<RopPayload> getRopPayloadList() const = 0;
     virtual RopPayload getExtraRopPayload() const = 0;
 
+    // The i-th element is the number of bytes requested by the read()
+    // which consumes the i-th ROP payload in `ropPayloadList` (as returned by
+    // getRopPayloadList()), or 0 if it cannot be determined.
+    // Missing elements are treated as 0.
+    virtual std::vector<uint64_t>
+    getReadLengthList(const std::vector<RopPayload> &/*ropPayloadList*/) const { return {}; }
+
     std::string getConfigKey() const;
 
+    bool hasPopulatedRequiredGadgets() const { return m_hasPopulatedRequiredGadgets; }
+
     static std::unique_ptr<Technique> create(const std::string &name);
-    static std::map<std::type_index, Technique *> s_mapper;
+
+    // Techniques are numbered in the order they're created, and s_id<T> is
+    // the ID of the technique of type T, or -1 if T hasn't been loaded.
+    static std::vector<Technique *> s_techniques;
+
+    template <typename T>
+    static inline int s_id = -1;
 
 protected:
     Technique()
         : m_hasPopulatedRequiredGadgets(true),
           m_requiredGadgets() {}
 
-    [[gnu::always_inline]]
-    inline void blockUntilRequiredGadgetsPopulated() const {
-        if (m_hasPopulatedRequiredGadgets) {
-            return;
-        }
-        log<WARN>() << toString() << " is still running, please wait...\n";
-        while (!m_hasPopulatedRequiredGadgets) {}
-    }
+    // Busy-waits until the background thread (if any) has populated
+    // m_requiredGadgets. The wait can be cancelled by the exploit generator.
+    void blockUntilRequiredGadgetsPopulated() const;
+
+    // Gives up on the current exploit generation attempt. The exploit generator
+    // will catch the exception thrown by this method and move on.
+    [[noreturn]]
+    void cancel(const std::string &reason) const;
 
     // Some techniques determines the required gadgets in a background thread.
     // In such cases, this atomic bool must be set to false, and the
@@ -78,6 +91,10 @@ protected:
     std::atomic<bool> m_hasPopulatedRequiredGadgets;
 
     llvm::SmallVector<std::pair<const ELF *, std::string>, 8> m_requiredGadgets;
+
+private:
+    template <typename T>
+    static std::unique_ptr<Technique> make();
 };
 
 }  // namespace s2e::plugins::crax
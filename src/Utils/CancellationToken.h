@@ -0,0 +1,129 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef S2E_PLUGINS_CRAX_CANCELLATION_TOKEN_H
+#define S2E_PLUGINS_CRAX_CANCELLATION_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace s2e::plugins::crax {
+
+// A CancellationToken is shared by the exploit generator and everything
+// that runs on its behalf (techniques, solver queries, waits on background
+// workers). It is cancelled either explicitly via cancel(), e.g., when a technique
+// finds out that it isn't viable, or implicitly once its deadline expires.
+//
+// Long-running code should poll isCancelled() or call throwIfCancelled()
+// at safe points. The latter throws CancelledException, which is caught
+// by ExploitGenerator::run().
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class CancelledException : public std::exception {
+    public:
+        explicit CancelledException(std::string reason)
+            : std::exception(),
+              m_reason(std::move(reason)) {}
+
+        virtual const char *what() const noexcept override {
+            return m_reason.c_str();
+        }
+
+    private:
+        std::string m_reason;
+    };
+
+
+    CancellationToken()
+        : m_isCancelled(),
+          m_deadline(Clock::time_point::max().time_since_epoch().count()),
+          m_cancelReason(),
+          m_deadlineReason(),
+          m_mutex() {}
+
+    // Clears the cancellation flag and disarms the deadline.
+    void reset() {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_isCancelled = false;
+        m_deadline = Clock::time_point::max().time_since_epoch().count();
+        m_cancelReason.clear();
+        m_deadlineReason.clear();
+    }
+
+    void cancel(const std::string &reason) {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelReason = reason;
+        m_isCancelled = true;
+    }
+
+    // Arms the deadline. The `reason` is reported when the deadline expires.
+    void setDeadline(Clock::time_point deadline, const std::string &reason) {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_deadline = deadline.time_since_epoch().count();
+        m_deadlineReason = reason;
+    }
+
+    [[nodiscard]]
+    Clock::time_point getDeadline() const {
+        return Clock::time_point(Clock::duration(m_deadline.load()));
+    }
+
+    [[nodiscard]]
+    std::string getDeadlineReason() const {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        return m_deadlineReason;
+    }
+
+    [[nodiscard]]
+    bool isCancelled() const {
+        return m_isCancelled ||
+               Clock::now().time_since_epoch().count() >= m_deadline;
+    }
+
+    void throwIfCancelled() const {
+        if (!isCancelled()) {
+            return;
+        }
+
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        throw CancelledException(m_isCancelled ? m_cancelReason : m_deadlineReason);
+    }
+
+private:
+    std::atomic<bool> m_isCancelled;
+
+    // The deadline is stored as the number of ticks since the clock's epoch,
+    // so that it can be polled from other threads without locking.
+    std::atomic<Clock::rep> m_deadline;
+
+    std::string m_cancelReason;
+    std::string m_deadlineReason;
+    mutable std::mutex m_mutex;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_CANCELLATION_TOKEN_H
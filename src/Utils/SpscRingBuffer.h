@@ -0,0 +1,91 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef S2E_PLUGINS_CRAX_SPSC_RING_BUFFER_H
+#define S2E_PLUGINS_CRAX_SPSC_RING_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace s2e::plugins::crax {
+
+// A bounded, lock-free ring buffer for exactly one producer thread
+// and one consumer thread. `N` must be a power of two.
+//
+// The producer only writes m_tail and the consumer only writes m_head,
+// so each side publishes its progress with a release store and observes
+// the other side's with an acquire load.
+template <typename T, size_t N>
+class SpscRingBuffer {
+    static_assert(N && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    SpscRingBuffer() : m_slots(), m_head(), m_tail() {}
+
+    // Producer only. Returns false if the buffer is full,
+    // in which case `value` is left untouched.
+    [[nodiscard]]
+    bool tryPush(T &&value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail - m_head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+
+        m_slots[tail & (N - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the buffer is empty.
+    [[nodiscard]]
+    bool tryPop(T &value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        value = std::move(m_slots[head & (N - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]]
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) ==
+               m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, N> m_slots;
+
+    // Keep the indices on separate cache lines,
+    // since they're written by different threads.
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
+
+}  // namespace s2e::plugins::crax
+
+#endif  // S2E_PLUGINS_CRAX_SPSC_RING_BUFFER_H
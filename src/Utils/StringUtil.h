@@ -101,6 +101,20 @@ std::string toByteString(InputIt first, InputIt last) {
     return ret;
 }
 
+// Given a sequence of bytes, convert them to a hex string, e.g., "4142ff".
+template <typename InputIt>
+std::string toHexString(InputIt first, InputIt last) {
+    static const char *digits = "0123456789abcdef";
+    std::string ret;
+
+    for (auto it = first; it != last; it++) {
+        uint8_t byte = *it;
+        ret += digits[byte >> 4];
+        ret += digits[byte & 0xf];
+    }
+    return ret;
+}
+
 template <typename T>
 std::string streamToString(const T &s) {
     std::stringstream ss;
@@ -0,0 +1,772 @@
+// Copyright 2021-2022 Software Quality Laboratory, NYCU.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// crax-runner: executes the language-neutral exploit description (exploit_<id>.crax)
+// generated by CRAX against a local process or a TCP port, without starting
+// a Python interpreter. See src/Renderers/CraxRenderer.h for the format.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/personality.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Bytes = std::vector<uint8_t>;
+
+constexpr int kSupportedVersion = 1;
+
+enum ExitCode {
+    EXIT_PWNED = 0,
+    EXIT_FAILED = 1,
+    EXIT_ERROR = 2,
+};
+
+struct Options {
+    std::string filename;
+    std::string tcpHost;
+    int tcpPort = 0;
+    int timeoutMs = 5000;
+    int sendDelayMs = 200;
+    int repeat = 1;
+    bool interactive = false;
+    bool verbose = false;
+    std::string marker = "CRAX_RUNNER_";
+};
+
+struct Op {
+    size_t lineno;
+    std::string name;
+    std::vector<std::string> args;
+};
+
+// Thrown when the exploit fails at runtime (e.g., EOF or timeout).
+struct AttemptFailed : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Thrown when the description itself is malformed or unsupported.
+struct BadDescription : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+
+Bytes fromHex(const std::string &s) {
+    auto nibble = [&s](char c) -> uint8_t {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        throw BadDescription("invalid hex string: " + s);
+    };
+
+    if (s.size() % 2) {
+        throw BadDescription("odd-length hex string: " + s);
+    }
+
+    Bytes ret;
+    ret.reserve(s.size() / 2);
+    for (size_t i = 0; i < s.size(); i += 2) {
+        ret.push_back((nibble(s[i]) << 4) | nibble(s[i + 1]));
+    }
+    return ret;
+}
+
+std::string unescape(const std::string &s) {
+    std::string ret;
+
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\\' && i + 3 < s.size() && s[i + 1] == 'x') {
+            Bytes b = fromHex(s.substr(i + 2, 2));
+            ret += static_cast<char>(b[0]);
+            i += 3;
+        } else {
+            ret += s[i];
+        }
+    }
+    return ret;
+}
+
+uint64_t parseInt(const std::string &s) {
+    try {
+        size_t idx = 0;
+        uint64_t ret = std::stoull(s, &idx, 0);
+        if (idx != s.size()) {
+            throw BadDescription("invalid integer: " + s);
+        }
+        return ret;
+    } catch (const std::logic_error &) {
+        throw BadDescription("invalid integer: " + s);
+    }
+}
+
+std::vector<Op> parseDescription(const std::string &filename) {
+    std::ifstream ifs(filename);
+    if (!ifs.is_open()) {
+        throw BadDescription("cannot open " + filename);
+    }
+
+    std::vector<Op> ret;
+    std::string line;
+
+    for (size_t lineno = 1; std::getline(ifs, line); lineno++) {
+        std::istringstream iss(line);
+        Op op { lineno, {}, {} };
+
+        if (!(iss >> op.name) || op.name[0] == '#') {
+            continue;
+        }
+        for (std::string arg; iss >> arg; ) {
+            op.args.push_back(arg);
+        }
+        ret.push_back(std::move(op));
+    }
+
+    if (ret.empty() || ret[0].name != "crax" || ret[0].args.size() != 1) {
+        throw BadDescription(filename + " is not a CRAX exploit description");
+    }
+    if (parseInt(ret[0].args[0]) != kSupportedVersion) {
+        throw BadDescription("unsupported description version: " + ret[0].args[0]);
+    }
+    return ret;
+}
+
+
+// The connection to the target, either a child process or a TCP socket.
+class Target {
+public:
+    Target(const Options &options) : m_options(options) {}
+
+    ~Target() {
+        close();
+    }
+
+    void spawn(const std::vector<std::string> &argv,
+               const std::vector<std::string> &env,
+               bool aslr) {
+        int in[2];
+        int out[2];
+
+        if (pipe(in) == -1 || pipe(out) == -1) {
+            throw AttemptFailed(std::string("pipe: ") + strerror(errno));
+        }
+
+        std::vector<char *> cargv;
+        std::vector<char *> cenv;
+        for (const auto &s : argv) cargv.push_back(const_cast<char *>(s.c_str()));
+        for (const auto &s : env) cenv.push_back(const_cast<char *>(s.c_str()));
+        cargv.push_back(nullptr);
+        cenv.push_back(nullptr);
+
+        m_pid = fork();
+        if (m_pid == -1) {
+            throw AttemptFailed(std::string("fork: ") + strerror(errno));
+        }
+
+        if (m_pid == 0) {
+            dup2(in[0], STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            dup2(out[1], STDERR_FILENO);
+            ::close(in[0]);
+            ::close(in[1]);
+            ::close(out[0]);
+            ::close(out[1]);
+
+            if (!aslr) {
+                personality(ADDR_NO_RANDOMIZE);
+            }
+            execve(cargv[0], cargv.data(), cenv.data());
+            _exit(127);
+        }
+
+        ::close(in[0]);
+        ::close(out[1]);
+        m_writeFd = in[1];
+        m_readFd = out[0];
+    }
+
+    void connect(const std::string &host, int port) {
+        addrinfo hints {};
+        addrinfo *res = nullptr;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res)) {
+            throw AttemptFailed("cannot resolve " + host);
+        }
+
+        int fd = -1;
+        for (addrinfo *p = res; p; p = p->ai_next) {
+            fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+            if (fd == -1) {
+                continue;
+            }
+            if (::connect(fd, p->ai_addr, p->ai_addrlen) == 0) {
+                break;
+            }
+            ::close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+
+        if (fd == -1) {
+            throw AttemptFailed("cannot connect to " + host + ':' + std::to_string(port));
+        }
+        m_readFd = m_writeFd = fd;
+    }
+
+    bool isConnected() const {
+        return m_readFd != -1;
+    }
+
+    void send(const Bytes &bytes) {
+        size_t off = 0;
+        while (off < bytes.size()) {
+            ssize_t n = write(m_writeFd, bytes.data() + off, bytes.size() - off);
+            if (n <= 0) {
+                throw AttemptFailed("send: target closed its input");
+            }
+            off += n;
+        }
+        trace("send", bytes);
+    }
+
+    Bytes recvn(size_t len) {
+        Bytes ret;
+        while (ret.size() < len) {
+            uint8_t byte;
+            if (!recvOne(byte, deadline())) {
+                throw AttemptFailed("recv: got " + std::to_string(ret.size()) +
+                                    " of " + std::to_string(len) + " bytes");
+            }
+            ret.push_back(byte);
+        }
+        trace("recv", ret);
+        return ret;
+    }
+
+    Bytes recvuntil(const Bytes &delim) {
+        Bytes ret;
+        auto until = deadline();
+
+        while (ret.size() < delim.size() ||
+               !std::equal(delim.begin(), delim.end(), ret.end() - delim.size())) {
+            uint8_t byte;
+            if (!recvOne(byte, until)) {
+                throw AttemptFailed("recvuntil: delimiter not found");
+            }
+            ret.push_back(byte);
+        }
+        trace("recv", ret);
+        ret.resize(ret.size() - delim.size());
+        return ret;
+    }
+
+    // Waits for the first byte, then takes whatever else is available (at most `len`).
+    Bytes recvatmost(size_t len) {
+        Bytes ret;
+        uint8_t byte;
+
+        if (len && recvOne(byte, deadline())) {
+            ret.push_back(byte);
+            while (ret.size() < len && recvOne(byte, Clock::now())) {
+                ret.push_back(byte);
+            }
+        }
+        trace("recv", ret);
+        return ret;
+    }
+
+    void drain() {
+        Bytes ret;
+        uint8_t byte;
+        while (recvOne(byte, Clock::now())) {
+            ret.push_back(byte);
+        }
+        trace("drain", ret);
+    }
+
+    // Waits until the target has consumed what we've sent and is blocked again,
+    // which replaces the fixed `time.sleep(0.2)` of the script. This is only
+    // observable for a local process, so a TCP target always gets the full delay.
+    void waitUntilBlocked() {
+        auto until = Clock::now() + std::chrono::milliseconds(m_options.sendDelayMs);
+
+        if (m_pid <= 0) {
+            std::this_thread::sleep_until(until);
+            return;
+        }
+
+        std::string path = "/proc/" + std::to_string(m_pid) + "/stat";
+        while (Clock::now() < until) {
+            int nrUnread = 0;
+            if (ioctl(m_writeFd, FIONREAD, &nrUnread) == 0 && nrUnread == 0) {
+                std::ifstream ifs(path);
+                std::string stat;
+                std::getline(ifs, stat);
+
+                // The state field comes right after "(comm) ".
+                size_t i = stat.rfind(')');
+                if (i == std::string::npos || i + 2 >= stat.size()) {
+                    return;  // exited
+                }
+                char state = stat[i + 2];
+                if (state == 'S' || state == 'Z' || state == 'X') {
+                    return;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    void interact() {
+        pollfd fds[2] = {
+            { STDIN_FILENO, POLLIN, 0 },
+            { m_readFd, POLLIN, 0 },
+        };
+        uint8_t buf[4096];
+
+        while (poll(fds, 2, -1) > 0) {
+            if (fds[0].revents & (POLLIN | POLLHUP)) {
+                ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+                if (n <= 0) break;
+                send(Bytes(buf, buf + n));
+            }
+            if (fds[1].revents & (POLLIN | POLLHUP)) {
+                ssize_t n = read(m_readFd, buf, sizeof(buf));
+                if (n <= 0) break;
+                fwrite(buf, 1, n, stdout);
+                fflush(stdout);
+            }
+        }
+    }
+
+    void close() {
+        if (m_writeFd != -1 && m_writeFd != m_readFd) ::close(m_writeFd);
+        if (m_readFd != -1) ::close(m_readFd);
+        m_readFd = m_writeFd = -1;
+
+        if (m_pid > 0) {
+            kill(m_pid, SIGKILL);
+            waitpid(m_pid, nullptr, 0);
+            m_pid = -1;
+        }
+    }
+
+private:
+    Clock::time_point deadline() const {
+        return Clock::now() + std::chrono::milliseconds(m_options.timeoutMs);
+    }
+
+    bool recvOne(uint8_t &byte, Clock::time_point until) {
+        if (m_bufPos < m_buf.size()) {
+            byte = m_buf[m_bufPos++];
+            return true;
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(until - Clock::now());
+        pollfd pfd { m_readFd, POLLIN, 0 };
+
+        if (poll(&pfd, 1, std::max<int>(0, remaining.count())) <= 0) {
+            return false;
+        }
+
+        m_buf.resize(4096);
+        ssize_t n = read(m_readFd, m_buf.data(), m_buf.size());
+        if (n <= 0) {
+            m_buf.clear();
+            m_bufPos = 0;
+            return false;
+        }
+
+        m_buf.resize(n);
+        m_bufPos = 0;
+        byte = m_buf[m_bufPos++];
+        return true;
+    }
+
+    void trace(const char *what, const Bytes &bytes) const {
+        if (!m_options.verbose || bytes.empty()) {
+            return;
+        }
+        fprintf(stderr, "[%s] %zu bytes:", what, bytes.size());
+        for (size_t i = 0; i < bytes.size() && i < 64; i++) {
+            fprintf(stderr, " %02x", bytes[i]);
+        }
+        fprintf(stderr, bytes.size() > 64 ? " ...\n" : "\n");
+    }
+
+    const Options &m_options;
+    pid_t m_pid = -1;
+    int m_readFd = -1;
+    int m_writeFd = -1;
+    Bytes m_buf;
+    size_t m_bufPos = 0;
+};
+
+
+class Runner {
+public:
+    Runner(const Options &options, const std::vector<Op> &ops)
+        : m_options(options),
+          m_ops(ops) {}
+
+    // Returns true if we've got a shell.
+    bool run() {
+        Target target(m_options);
+
+        m_vars.clear();
+        m_stage1.clear();
+        m_payload.clear();
+        m_argv.clear();
+        m_env.clear();
+        m_aslr = true;
+
+        for (const Op &op : m_ops) {
+            if (execute(target, op)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    void expectArgs(const Op &op, size_t n) const {
+        if (op.args.size() != n) {
+            throw BadDescription(format(op, "expects %zu operand(s)", n));
+        }
+    }
+
+    static std::string format(const Op &op, const char *fmt, size_t n = 0) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), fmt, n);
+        return "line " + std::to_string(op.lineno) + ": " + op.name + ": " + buf;
+    }
+
+    std::string resolveString(const std::string &s) const {
+        if (s == "@payload") {
+            return std::string(m_stage1.begin(), m_stage1.end());
+        }
+        return unescape(s);
+    }
+
+    uint64_t getVar(const Op &op, const std::string &name) const {
+        auto it = m_vars.find(name);
+        if (it == m_vars.end()) {
+            throw BadDescription(format(op, "undefined variable") + " " + name);
+        }
+        return it->second;
+    }
+
+    uint64_t evaluatePostfix(const Op &op) const {
+        std::vector<uint64_t> stack;
+
+        for (const auto &token : op.args) {
+            if (token == "+" || token == "-" || token == "*") {
+                if (stack.size() < 2) {
+                    throw BadDescription(format(op, "malformed postfix expr"));
+                }
+                uint64_t rhs = stack.back();
+                stack.pop_back();
+                uint64_t &lhs = stack.back();
+                lhs = (token == "+") ? lhs + rhs : (token == "-") ? lhs - rhs : lhs * rhs;
+            } else if (isdigit(static_cast<unsigned char>(token[0]))) {
+                stack.push_back(parseInt(token));
+            } else {
+                stack.push_back(getVar(op, token));
+            }
+        }
+
+        if (stack.size() != 1) {
+            throw BadDescription(format(op, "malformed postfix expr"));
+        }
+        return stack.back();
+    }
+
+    static uint64_t u64(Bytes bytes) {
+        bytes.resize(8, 0);
+        uint64_t ret = 0;
+        for (int i = 7; i >= 0; i--) {
+            ret = (ret << 8) | bytes[i];
+        }
+        return ret;
+    }
+
+    static void appendP64(Bytes &bytes, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            bytes.push_back((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    // Returns true if the exploit has succeeded.
+    bool execute(Target &target, const Op &op) {
+        const auto &args = op.args;
+
+        if (op.name == "crax") {
+            return false;
+        } else if (op.name == "set") {
+            expectArgs(op, 2);
+            m_vars[args[0]] = parseInt(args[1]);
+        } else if (op.name == "stage1") {
+            expectArgs(op, 1);
+            m_stage1 = fromHex(args[0]);
+        } else if (op.name == "argv") {
+            m_argv.clear();
+            for (const auto &arg : args) {
+                m_argv.push_back(resolveString(arg));
+            }
+        } else if (op.name == "env") {
+            expectArgs(op, 2);
+            m_env.push_back(resolveString(args[0]) + '=' + resolveString(args[1]));
+        } else if (op.name == "aslr") {
+            expectArgs(op, 1);
+            m_aslr = parseInt(args[0]);
+        } else if (op.name == "spawn" || op.name == "connect") {
+            if (m_options.tcpPort) {
+                target.connect(m_options.tcpHost, m_options.tcpPort);
+            } else if (op.name == "connect") {
+                expectArgs(op, 2);
+                target.connect(unescape(args[0]), parseInt(args[1]));
+            } else if (m_argv.empty()) {
+                throw BadDescription(format(op, "argv is empty"));
+            } else {
+                target.spawn(m_argv, m_env, m_aslr);
+            }
+        } else if (!target.isConnected()) {
+            throw BadDescription(format(op, "the target hasn't been started yet"));
+        } else if (op.name == "send") {
+            expectArgs(op, 1);
+            target.send(args[0] == "@payload" ? m_stage1 : fromHex(args[0]));
+            target.waitUntilBlocked();
+        } else if (op.name == "push") {
+            expectArgs(op, 1);
+            Bytes bytes = fromHex(args[0]);
+            m_payload.insert(m_payload.end(), bytes.begin(), bytes.end());
+        } else if (op.name == "push64") {
+            appendP64(m_payload, evaluatePostfix(op));
+        } else if (op.name == "flush" || op.name == "flushline") {
+            if (op.name == "flushline") {
+                m_payload.push_back('\n');
+            }
+            target.send(m_payload);
+            target.waitUntilBlocked();
+            m_payload.clear();
+        } else if (op.name == "recv") {
+            expectArgs(op, 1);
+            target.recvn(parseInt(args[0]));
+        } else if (op.name == "recvuntil") {
+            expectArgs(op, 1);
+            target.recvuntil(fromHex(args[0]));
+        } else if (op.name == "recvatmost") {
+            expectArgs(op, 1);
+            target.recvatmost(parseInt(args[0]));
+        } else if (op.name == "drain") {
+            target.drain();
+        } else if (op.name == "leak") {
+            expectArgs(op, 4);
+            Bytes bytes = (args[2] == "-") ? Bytes {} : fromHex(args[2]);
+            Bytes leaked = target.recvn(parseInt(args[1]));
+            bytes.insert(bytes.end(), leaked.begin(), leaked.end());
+            m_vars[args[0]] = u64(bytes) - parseInt(args[3]);
+            log(args[0], m_vars[args[0]]);
+        } else if (op.name == "sleep") {
+            expectArgs(op, 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(parseInt(args[0])));
+        } else if (op.name == "unsupported") {
+            std::string reason;
+            for (const auto &arg : args) {
+                reason += ' ' + unescape(arg);
+            }
+            throw BadDescription("unsupported:" + reason);
+        } else if (op.name == "shell") {
+            return checkShell(target);
+        } else {
+            throw BadDescription(format(op, "unknown operation"));
+        }
+        return false;
+    }
+
+    bool checkShell(Target &target) {
+        if (m_options.interactive) {
+            target.interact();
+            return true;
+        }
+
+        // The shell has to evaluate the arithmetic, so the expected output never
+        // shows up just because our input is echoed back (see verify-exploits.py).
+        std::string cmd = "echo " + m_options.marker + "$((1300+37))\n";
+        std::string expected = m_options.marker + "1337";
+        target.send(Bytes(cmd.begin(), cmd.end()));
+
+        try {
+            target.recvuntil(Bytes(expected.begin(), expected.end()));
+            return true;
+        } catch (const AttemptFailed &) {
+            return false;
+        }
+    }
+
+    void log(const std::string &var, uint64_t value) const {
+        if (m_options.verbose) {
+            fprintf(stderr, "[leak] %s = 0x%llx\n", var.c_str(),
+                    static_cast<unsigned long long>(value));
+        }
+    }
+
+    const Options &m_options;
+    const std::vector<Op> &m_ops;
+
+    std::map<std::string, uint64_t> m_vars;
+    Bytes m_stage1;
+    Bytes m_payload;
+    std::vector<std::string> m_argv;
+    std::vector<std::string> m_env;
+    bool m_aslr = true;
+};
+
+
+void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [option]... <exploit_N.crax>\n"
+            "-t, --tcp <host:port>   - Connect to a TCP port instead of spawning the target.\n"
+            "-T, --timeout <ms>      - Timeout of each receive (default: 5000).\n"
+            "-d, --send-delay <ms>   - Max time to wait for the target to consume a send (default: 200).\n"
+            "-n, --repeat <n>        - Run n attempts and report the success rate.\n"
+            "-m, --marker <str>      - The prefix of the marker echoed by the shell (default: CRAX_RUNNER_).\n"
+            "-i, --interactive       - Hand the shell over to the user.\n"
+            "-v, --verbose           - Trace the bytes sent and received.\n"
+            "\n"
+            "exit status: 0 if pwned, 1 if the exploit failed, 2 on errors.\n",
+            prog);
+}
+
+Options parseOptions(int argc, char **argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                exit(EXIT_ERROR);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            exit(EXIT_PWNED);
+        } else if (arg == "-t" || arg == "--tcp") {
+            std::string s = next();
+            size_t colon = s.rfind(':');
+            if (colon == std::string::npos) {
+                usage(argv[0]);
+                exit(EXIT_ERROR);
+            }
+            options.tcpHost = s.substr(0, colon);
+            options.tcpPort = std::atoi(s.c_str() + colon + 1);
+        } else if (arg == "-T" || arg == "--timeout") {
+            options.timeoutMs = std::atoi(next().c_str());
+        } else if (arg == "-d" || arg == "--send-delay") {
+            options.sendDelayMs = std::atoi(next().c_str());
+        } else if (arg == "-n" || arg == "--repeat") {
+            options.repeat = std::max(1, std::atoi(next().c_str()));
+        } else if (arg == "-m" || arg == "--marker") {
+            options.marker = next();
+        } else if (arg == "-i" || arg == "--interactive") {
+            options.interactive = true;
+        } else if (arg == "-v" || arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg[0] == '-' || options.filename.size()) {
+            usage(argv[0]);
+            exit(EXIT_ERROR);
+        } else {
+            options.filename = arg;
+        }
+    }
+
+    if (options.filename.empty()) {
+        usage(argv[0]);
+        exit(EXIT_ERROR);
+    }
+    return options;
+}
+
+}  // namespace
+
+
+int main(int argc, char **argv) {
+    Options options = parseOptions(argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        std::vector<Op> ops = parseDescription(options.filename);
+        Runner runner(options, ops);
+        int nrPwned = 0;
+        double totalMs = 0;
+
+        for (int i = 0; i < options.repeat; i++) {
+            auto begin = Clock::now();
+            bool pwned = false;
+
+            try {
+                pwned = runner.run();
+            } catch (const AttemptFailed &e) {
+                if (options.verbose) {
+                    fprintf(stderr, "[-] attempt %d: %s\n", i, e.what());
+                }
+            }
+
+            totalMs += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            nrPwned += pwned;
+        }
+
+        if (options.repeat > 1) {
+            printf("%d/%d attempts succeeded, %.2f ms per attempt\n",
+                   nrPwned, options.repeat, totalMs / options.repeat);
+        }
+        return nrPwned ? EXIT_PWNED : EXIT_FAILED;
+
+    } catch (const BadDescription &e) {
+        fprintf(stderr, "crax-runner: %s\n", e.what());
+        return EXIT_ERROR;
+    }
+}